@@ -734,6 +734,15 @@ ni_do_ifstatus(int argc, char **argv)
 		goto cleanup;
 	}
 
+	/* Refresh the requested devices only, unless all are requested */
+	for (c = optind; c < argc; ++c) {
+		if (ni_string_eq(argv[c], "all")) {
+			ni_string_array_destroy(&fsm->refresh_ifnames);
+			break;
+		}
+		ni_string_array_append(&fsm->refresh_ifnames, argv[c]);
+	}
+
 	if (!ni_fsm_refresh_state(fsm)) {
 		/* Severe error we always explicitly return */
 		status = NI_WICKED_ST_ERROR;
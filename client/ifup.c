@@ -214,21 +214,20 @@ error:
 	return NULL;
 }
 
-static ni_bool_t
-ni_ifup_start_policy(ni_ifworker_t *w)
+static xml_node_t *
+ni_ifup_generate_policy(ni_ifworker_t *w)
 {
-	xml_node_t *match, *policy = NULL;
-	ni_bool_t rv = FALSE;
+	xml_node_t *match, *policy;
 	char *pname;
 
 	if (!w || !w->config.node)
-		return rv;
+		return NULL;
 
 	ni_debug_application("%s: hiring nanny", w->name);
 
 	match = __ni_ifup_generate_match(NI_NANNY_IFPOLICY_MATCH, w);
 	if (!match)
-		goto error;
+		return NULL;
 
 	pname  = ni_ifpolicy_name_from_ifname(w->name);
 	ni_debug_application("%s: converting config into policy '%s'",
@@ -238,35 +237,38 @@ ni_ifup_start_policy(ni_ifworker_t *w)
 			pname, w->config.meta.origin);
 	ni_string_free(&pname);
 	xml_node_free(match);
-	if (!policy)
-		goto error;
+	return policy;
+}
 
+static ni_bool_t
+ni_ifup_start_policy(ni_ifworker_t *w, xml_node_t *policy)
+{
 	ni_debug_application("%s: adding policy %s to nanny", w->name,
 		xml_node_get_attr(policy, NI_NANNY_IFPOLICY_NAME));
 
-	if (ni_nanny_addpolicy_node(policy, w->config.meta.origin) <= 0)
-		goto error;
+	if (ni_nanny_addpolicy_node(policy, w->config.meta.origin) <= 0) {
+		ni_ifworker_fail(w, "unable to apply configuration to nanny");
+		return FALSE;
+	}
 
 	ni_debug_application("%s: nanny hired!", w->name);
 	ni_ifworker_success(w);
-
-	rv = TRUE;
-
-error:
-	if (!rv)
-		ni_ifworker_fail(w, "unable to apply configuration to nanny");
-	xml_node_free(policy);
-	return rv;
+	return TRUE;
 }
 
 ni_bool_t
 ni_ifup_hire_nanny(ni_ifworker_array_t *array, ni_bool_t set_persistent)
 {
-	unsigned int i;
-	ni_bool_t rv = TRUE;
+	ni_ifworker_array_t hired = NI_IFWORKER_ARRAY_INIT;
+	ni_string_array_t failed = NI_STRING_ARRAY_INIT;
 	ni_string_array_t names = NI_STRING_ARRAY_INIT;
+	xml_node_t *policies, *policy;
+	ni_bool_t batch = FALSE;
+	ni_bool_t rv = TRUE;
+	unsigned int i;
 
-	/* Send policies to nanny */
+	/* Convert the configs into policies */
+	policies = xml_node_new("policies", NULL);
 	for (i = 0; i < array->count; i++) {
 		ni_ifworker_t *w = array->data[i];
 
@@ -276,20 +278,52 @@ ni_ifup_hire_nanny(ni_ifworker_array_t *array, ni_bool_t set_persistent)
 		if (set_persistent)
 			ni_client_state_set_persistent(w->config.node);
 
-		if (!ni_ifup_start_policy(w))
+		if (!(policy = ni_ifup_generate_policy(w))) {
+			ni_ifworker_fail(w, "unable to apply configuration to nanny");
 			rv = FALSE;
-		else {
-			ni_info("%s: configuration applied to nanny", w->name);
-			ni_string_array_append(&names, w->name);
+			continue;
 		}
+		xml_node_add_child(policies, policy);
+		ni_ifworker_array_append(&hired, w);
 	}
 
-	/* Recheck policies on modified devices */
 	if (0 == array->count)
 		ni_note("ifup: no matching interfaces");
-	else
+
+	/*
+	 * Send all policies to nanny at once; nanny rechecks them itself.
+	 * Add the policies nanny failed to apply one by one to get their
+	 * errors and recheck them; all of them when the call fails, e.g.
+	 * with a nanny not providing createPolicies.
+	 */
+	if (hired.count)
+		batch = ni_nanny_call_add_policies(policies, &failed) >= 0;
+
+	for (i = 0, policy = policies->children; policy && i < hired.count;
+			policy = policy->next, i++) {
+		ni_ifworker_t *w = hired.data[i];
+
+		if (batch && ni_string_array_index(&failed,
+					ni_ifpolicy_get_name(policy)) < 0) {
+			ni_debug_application("%s: nanny hired!", w->name);
+			ni_ifworker_success(w);
+			ni_info("%s: configuration applied to nanny", w->name);
+		} else
+		if (!ni_ifup_start_policy(w, policy)) {
+			rv = FALSE;
+		} else {
+			ni_info("%s: configuration applied to nanny", w->name);
+			ni_string_array_append(&names, w->name);
+		}
+	}
+
+	/* Recheck policies on modified devices added one by one */
+	if ((batch && names.count) || (!batch && array->count))
 		ni_nanny_call_recheck(&names);
 
+	xml_node_free(policies);
+	ni_ifworker_array_destroy(&hired);
+	ni_string_array_destroy(&failed);
 	ni_string_array_destroy(&names);
 	return rv;
 }
@@ -528,73 +528,133 @@ __dump_fake_xml(const ni_dbus_variant_t *variant, unsigned int indent, const cha
 	}
 }
 
+/*
+ * Step into the next entry of a dbus dict and return its key;
+ * the entry iterator is left pointing at the value.
+ */
 static ni_bool_t
-__dump_object_xml(const char *object_path, const ni_dbus_variant_t *variant,
-	ni_xs_scope_t *schema, xml_node_t *parent, const ni_string_array_t *filter)
+__dump_dict_entry(DBusMessageIter *iter_dict, DBusMessageIter *iter_entry, const char **key)
 {
-	xml_node_t *object_node;
-	ni_dbus_dict_entry_t *entry;
-	unsigned int index;
-	const char *ifname, *interface_name;
+	int type;
+
+	if (dbus_message_iter_get_arg_type(iter_dict) != DBUS_TYPE_DICT_ENTRY)
+		return FALSE;
+
+	dbus_message_iter_recurse(iter_dict, iter_entry);
+	dbus_message_iter_next(iter_dict);
+
+	type = dbus_message_iter_get_arg_type(iter_entry);
+	if (type != DBUS_TYPE_STRING && type != DBUS_TYPE_OBJECT_PATH)
+		return FALSE;
+
+	dbus_message_iter_get_basic(iter_entry, key);
+	return dbus_message_iter_next(iter_entry);
+}
 
-	if (!ni_dbus_variant_is_dict(variant)) {
+static ni_bool_t
+__dump_dict_open(DBusMessageIter *iter, DBusMessageIter *iter_dict)
+{
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY
+	 || dbus_message_iter_get_element_type(iter) != DBUS_TYPE_DICT_ENTRY) {
 		ni_error("%s: dbus data is not a dict", __func__);
 		return FALSE;
 	}
 
-	object_node = xml_node_new("object", NULL);
+	dbus_message_iter_recurse(iter, iter_dict);
+	return TRUE;
+}
+
+static ni_bool_t
+__dump_object_xml(const char *object_path, DBusMessageIter *iter,
+	ni_xs_scope_t *schema, xml_node_t *parent, const ni_string_array_t *filter)
+{
+	DBusMessageIter iter_dict, iter_entry;
+	xml_node_t *object_node, *node, *name;
+	const char *interface_name;
+
+	if (!__dump_dict_open(iter, &iter_dict))
+		return FALSE;
+
+	object_node = xml_node_new("object", parent);
 	xml_node_add_attr(object_node, "path", object_path);
 
 	if (filter && !filter->count)
 		filter = NULL;
 
-	for (entry = variant->dict_array_value, index = 0; index < variant->array.len; ++index, ++entry) {
-		interface_name = entry->key;
-		if (filter
-		 && ni_string_eq(interface_name, NI_OBJECTMODEL_NETIF_INTERFACE)
-		 && ni_dbus_dict_get_string(&entry->datum, "name", &ifname)
-		 && ni_string_array_index(filter, ifname) == -1) {
-			xml_node_free(object_node);
-			return TRUE;
+	while (dbus_message_iter_get_arg_type(&iter_dict) != DBUS_TYPE_INVALID) {
+		if (!__dump_dict_entry(&iter_dict, &iter_entry, &interface_name)) {
+			ni_error("%s: bad dict entry in dbus data", __func__);
+			xml_node_delete_child_node(parent, object_node);
+			return FALSE;
 		}
 
 		/* Ignore well-known interfaces that never have properties */
 		if (!ni_string_startswith(interface_name, NI_OBJECTMODEL_NAMESPACE))
 			continue;
 
-		ni_dbus_xml_deserialize_properties(schema, interface_name, &entry->datum, object_node);
+		node = ni_dbus_xml_deserialize_properties_iter(schema, interface_name,
+						&iter_entry, object_node);
+		if (filter && node
+		 && ni_string_eq(interface_name, NI_OBJECTMODEL_NETIF_INTERFACE)
+		 && (name = xml_node_get_child(node, "name")) && name->cdata
+		 && ni_string_array_index(filter, name->cdata) == -1) {
+			xml_node_delete_child_node(parent, object_node);
+			return TRUE;
+		}
 	}
 
-	if (object_node->children)
-		xml_node_add_child(parent, object_node);
-	else
-		xml_node_free(object_node);
+	if (!object_node->children)
+		xml_node_delete_child_node(parent, object_node);
 	return TRUE;
 }
 
+/*
+ * Build the xml straight from the GetManagedObjects reply message;
+ * this avoids to decode the whole object tree into variants first.
+ * The tree is only printed, so it is allocated from an arena.
+ */
 static xml_node_t *
-__dump_schema_xml(const ni_dbus_variant_t *variant, ni_xs_scope_t *schema, const ni_string_array_t *filter)
+__dump_schema_xml(ni_dbus_message_t *reply, ni_xs_scope_t *schema, const ni_string_array_t *filter)
 {
-	xml_node_t *root = xml_node_new(NULL, NULL);
-	ni_dbus_dict_entry_t *entry;
-	unsigned int index;
+	xml_node_t *root = xml_node_new_arena(NULL);
+	DBusMessageIter iter, iter_dict, iter_entry;
+	const char *object_path;
 
-	if (!ni_dbus_variant_is_dict(variant)) {
-		ni_error("%s: dbus data is not a dict", __func__);
+	dbus_message_iter_init(reply, &iter);
+	if (!__dump_dict_open(&iter, &iter_dict)) {
 		xml_node_free(root);
 		return NULL;
 	}
 
-	for (entry = variant->dict_array_value, index = 0; index < variant->array.len; ++index, ++entry) {
-		if (!__dump_object_xml(entry->key, &entry->datum, schema, root, filter)) {
+	while (dbus_message_iter_get_arg_type(&iter_dict) != DBUS_TYPE_INVALID) {
+		if (!__dump_dict_entry(&iter_dict, &iter_entry, &object_path)
+		 || !__dump_object_xml(object_path, &iter_entry, schema, root, filter)) {
 			xml_node_free(root);
 			return NULL;
 		}
 	}
 
+	xml_node_arena_seal(root);
 	return root;
 }
 
+static ni_dbus_message_t *
+__get_managed_objects(ni_dbus_object_t *list_object, DBusError *error)
+{
+	ni_dbus_client_t *client = ni_dbus_object_get_client(list_object);
+	ni_dbus_message_t *call, *reply = NULL;
+	ni_dbus_object_t *objmgr;
+
+	objmgr = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class,
+			list_object->path, "org.freedesktop.DBus.ObjectManager", NULL);
+	if ((call = ni_dbus_object_call_new(objmgr, "GetManagedObjects", 0)) != NULL) {
+		reply = ni_dbus_client_call(client, call, error);
+		dbus_message_unref(call);
+	}
+	ni_dbus_object_free(objmgr);
+	return reply;
+}
+
 int
 do_show_xml(int argc, char **argv)
 {
@@ -615,6 +675,7 @@ do_show_xml(int argc, char **argv)
 	};
 	ni_dbus_object_t *list_object, *object;
 	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_dbus_message_t *reply = NULL;
 	DBusError error = DBUS_ERROR_INIT;
 	int opt_raw = FALSE;
 #ifdef MODEM
@@ -683,25 +744,31 @@ do_show_xml(int argc, char **argv)
 	}
 #endif
 
-	if (!ni_dbus_object_call_variant(list_object,
-			"org.freedesktop.DBus.ObjectManager", "GetManagedObjects",
-			0, NULL,
-			1, &result, &error)) {
-		ni_error("GetManagedObject call failed");
-		goto out;
-	}
-
 	if (opt_raw) {
 		static const char *dict_element_tags[] = {
 			"object", "interface", NULL
 		};
 
+		if (!ni_dbus_object_call_variant(list_object,
+				"org.freedesktop.DBus.ObjectManager", "GetManagedObjects",
+				0, NULL,
+				1, &result, &error)) {
+			ni_error("GetManagedObject call failed");
+			goto out;
+		}
+
 		__dump_fake_xml(&result, 0, dict_element_tags);
 	} else {
-		ni_xs_scope_t *schema = ni_objectmodel_init(NULL);
+		ni_xs_scope_t *schema;
 		xml_node_t *tree;
 
-		tree = __dump_schema_xml(&result, schema, &ifnames);
+		if (!(reply = __get_managed_objects(list_object, &error))) {
+			ni_error("GetManagedObject call failed");
+			goto out;
+		}
+
+		schema = ni_objectmodel_init(NULL);
+		tree = __dump_schema_xml(reply, schema, &ifnames);
 		if (tree == NULL) {
 			ni_error("unable to represent properties as xml");
 			goto out;
@@ -711,9 +778,19 @@ do_show_xml(int argc, char **argv)
 		xml_node_free(tree);
 	}
 
+	{
+		const ni_dbus_decode_stats_t *stats = ni_dbus_message_decode_stats();
+
+		ni_debug_dbus("decoded %lu variants; copied %lu values (%lu bytes), "
+				"borrowed %lu values (%lu bytes)",
+				stats->variants, stats->copied, stats->copied_bytes,
+				stats->borrowed, stats->borrowed_bytes);
+	}
 	rv = 0;
 
 out:
+	if (reply)
+		dbus_message_unref(reply);
 	ni_dbus_variant_destroy(&result);
 	return rv;
 }
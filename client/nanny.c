@@ -446,6 +446,84 @@ ni_nanny_call_add_policy(const char *name, xml_node_t *node)
 	return rv == 0;
 }
 
+/*
+ * Create or update all policies given as children of the list node
+ * in one call; nanny rechecks them as well. The names of the policies
+ * nanny failed to apply are appended to the failed array.
+ *
+ * return value:
+ *   <0 - error
+ *    n - number of policies applied
+ */
+int
+ni_nanny_call_add_policies(const xml_node_t *list, ni_string_array_t *failed)
+{
+	ni_dbus_variant_t call_resp[2];
+	ni_dbus_variant_t call_argv[1];
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_object_t *root_object = NULL;
+	const xml_node_t *pnode;
+	char *policy_xml;
+	int rv = -NI_ERROR_DBUS_CALL_FAILED;
+	unsigned int i;
+
+	if (!list || !ni_nanny_create_client(&root_object) || !root_object) {
+		ni_debug_application("Unable to create nanny client to add policies");
+		return rv;
+	}
+
+	memset(call_argv, 0, sizeof(call_argv));
+	memset(call_resp, 0, sizeof(call_resp));
+	ni_dbus_variant_init_string_array(&call_argv[0]);
+	for (pnode = list->children; pnode; pnode = pnode->next) {
+		if ((policy_xml = xml_node_sprint(pnode)) == NULL) {
+			ni_debug_application("Unable to format nanny policy %s",
+					ni_ifpolicy_get_name(pnode));
+			goto cleanup;
+		}
+		ni_dbus_variant_append_string_array(&call_argv[0], policy_xml);
+		ni_string_free(&policy_xml);
+	}
+
+	ni_debug_application("Calling %s.createPolicies()", ni_dbus_object_get_path(root_object));
+	if (!ni_dbus_object_call_variant(root_object,
+					NI_OBJECTMODEL_NANNY_INTERFACE, "createPolicies",
+					1, call_argv, 2, call_resp, &error)) {
+		if (dbus_error_is_set(&error)) {
+			ni_debug_application("Call to %s.createPolicies() failed: %s: %s",
+					ni_dbus_object_get_path(root_object),
+					error.name, error.message);
+		} else {
+			ni_debug_application("Call to %s.createPolicies() failed.",
+					ni_dbus_object_get_path(root_object));
+		}
+		dbus_error_free(&error);
+		goto cleanup;
+	}
+
+	if (!ni_dbus_variant_is_array_of(&call_resp[0], DBUS_TYPE_OBJECT_PATH_AS_STRING)
+	||  !ni_dbus_variant_is_string_array(&call_resp[1])) {
+		ni_debug_application("Call to %s.createPolicies() returned an invalid reply",
+				ni_dbus_object_get_path(root_object));
+		goto cleanup;
+	}
+
+	rv = call_resp[0].array.len;
+	for (i = 0; i < call_resp[1].array.len; ++i) {
+		const char *name = call_resp[1].string_array_value[i];
+
+		ni_debug_application("Nanny failed to apply policy %s", name);
+		if (failed)
+			ni_string_array_append(failed, name);
+	}
+
+cleanup:
+	ni_dbus_variant_destroy(&call_argv[0]);
+	ni_dbus_variant_destroy(&call_resp[0]);
+	ni_dbus_variant_destroy(&call_resp[1]);
+	return rv;
+}
+
 ni_bool_t
 ni_nanny_call_del_policy(const char *name)
 {
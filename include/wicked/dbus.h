@@ -20,6 +20,7 @@ typedef struct ni_dbus_class	ni_dbus_class_t;
 typedef struct ni_dbus_server_object ni_dbus_server_object_t;
 typedef struct ni_dbus_client_object ni_dbus_client_object_t;
 typedef struct ni_dbus_dict_entry ni_dbus_dict_entry_t;
+typedef struct ni_dbus_dict_index ni_dbus_dict_index_t;
 typedef struct ni_dbus_method	ni_dbus_method_t;
 typedef struct ni_dbus_property	ni_dbus_property_t;
 typedef struct ni_dbus_variant	ni_dbus_variant_t;
@@ -59,8 +60,22 @@ struct ni_dbus_variant {
 	};
 
 	ni_dbus_message_t *	__message;
+	ni_dbus_dict_index_t *	__dict_index;	/* see ni_dbus_dict_get */
+	dbus_bool_t		__borrowed;	/* value points into a message */
 };
 
+/*
+ * Counters of the data decoded from dbus messages into variants;
+ * strings and byte arrays are either copied or borrowed.
+ */
+typedef struct ni_dbus_decode_stats {
+	unsigned long		variants;
+	unsigned long		copied;
+	unsigned long		copied_bytes;
+	unsigned long		borrowed;
+	unsigned long		borrowed_bytes;
+} ni_dbus_decode_stats_t;
+
 #define NI_DBUS_VARIANT_MAGIC	0x1234babe
 #define NI_DBUS_VARIANT_INIT	{ .type = DBUS_TYPE_INVALID, .__magic = NI_DBUS_VARIANT_MAGIC }
 
@@ -127,6 +142,7 @@ struct ni_dbus_class {
 	void			(*initialize)(ni_dbus_object_t *);
 	void			(*destroy)(ni_dbus_object_t *);
 	dbus_bool_t		(*refresh)(ni_dbus_object_t *);
+	ni_bool_t		(*match)(const ni_dbus_object_t *, const ni_dbus_variant_t *);
 };
 
 extern const ni_dbus_class_t	ni_dbus_anonymous_class;
@@ -165,6 +181,7 @@ extern ni_dbus_object_t *	ni_dbus_server_find_object_by_handle(ni_dbus_server_t
 extern dbus_bool_t		ni_dbus_server_send_signal(ni_dbus_server_t *server, ni_dbus_object_t *object,
 					const char *interface, const char *signal_name,
 					unsigned int nargs, const ni_dbus_variant_t *args);
+extern void			ni_dbus_server_object_modified(ni_dbus_object_t *);
 
 extern dbus_bool_t		ni_dbus_class_is_subclass(const ni_dbus_class_t *sub, const ni_dbus_class_t *super);
 
@@ -360,6 +377,8 @@ extern ni_dbus_object_t *	ni_dbus_client_object_new_child(ni_dbus_object_t *pare
 					const char *interface,
 					void *local_data);
 extern dbus_bool_t		ni_dbus_object_refresh_children(ni_dbus_object_t *);
+extern dbus_bool_t		ni_dbus_object_refresh_changed_children(ni_dbus_object_t *,
+					const ni_string_array_t *);
 extern ni_dbus_object_t *	ni_dbus_object_find_child(ni_dbus_object_t *parent, const char *name);
 extern dbus_bool_t		ni_dbus_object_call_variant(const ni_dbus_object_t *,
 					const char *interface, const char *method,
@@ -372,12 +391,20 @@ extern int			ni_dbus_object_call_simple(const ni_dbus_object_t *,
 					int res_type, void *res_ptr);
 extern int			ni_dbus_object_call_async(ni_dbus_object_t *obj,
 					ni_dbus_async_callback_t *callback, const char *method, ...);
+extern int			ni_dbus_object_call_variant_async(ni_dbus_object_t *,
+					const char *interface, const char *method,
+					unsigned int nargs, const ni_dbus_variant_t *args,
+					ni_dbus_async_callback_t *callback, dbus_uint32_t *serial);
 
 extern ni_dbus_message_t *	ni_dbus_object_call_new(const ni_dbus_object_t *, const char *method, ...);
 extern ni_dbus_message_t *	ni_dbus_object_call_new_va(const ni_dbus_object_t *obj,
 					const char *method, va_list *app);
 
 extern dbus_bool_t		ni_dbus_object_get_managed_objects(ni_dbus_object_t *, DBusError *, ni_bool_t purge);
+extern dbus_bool_t		ni_dbus_object_get_managed_objects_since(ni_dbus_object_t *,
+					const ni_string_array_t *, DBusError *);
+extern dbus_bool_t		ni_dbus_object_get_managed_objects_filtered(ni_dbus_object_t *,
+					const ni_dbus_variant_t *, DBusError *);
 extern dbus_bool_t		ni_dbus_object_refresh_properties(ni_dbus_object_t *, const ni_dbus_service_t *, DBusError *);
 extern dbus_bool_t		ni_dbus_object_send_property(ni_dbus_object_t *proxy,
 					const char *service_name,
@@ -391,6 +418,7 @@ extern dbus_bool_t		ni_dbus_object_send_property_string(ni_dbus_object_t *proxy,
 					DBusError *error);
 
 extern int			ni_dbus_message_get_args(ni_dbus_message_t *, ...);
+extern const ni_dbus_decode_stats_t *ni_dbus_message_decode_stats(void);
 extern int			ni_dbus_message_get_args_variants(ni_dbus_message_t *msg,
 					ni_dbus_variant_t *argv, unsigned int max_args);
 extern dbus_bool_t		ni_dbus_message_serialize_variants(ni_dbus_message_t *msg,
@@ -432,6 +460,8 @@ extern xml_node_t *		ni_dbus_xml_deserialize_arguments(const ni_dbus_method_t *m
 						ni_tempstate_t *);
 extern xml_node_t *		ni_dbus_xml_deserialize_properties(ni_xs_scope_t *, const char *,
 						ni_dbus_variant_t *, xml_node_t *);
+extern xml_node_t *		ni_dbus_xml_deserialize_properties_iter(ni_xs_scope_t *, const char *,
+						DBusMessageIter *, xml_node_t *);
 extern int			ni_dbus_xml_serialize_properties(ni_xs_scope_t *, ni_dbus_variant_t *, xml_node_t *);
 
 extern int			ni_dbus_xml_get_method_metadata(const ni_dbus_method_t *method,
@@ -187,6 +187,8 @@ struct ni_ifworker {
 
 		ni_fsm_require_t *check_state_req_list;
 
+		ni_ifworker_array_t dependents;	/* deferred until we change state */
+		ni_bool_t	scheduled;	/* requeued via dependents */
 	} fsm;
 	unsigned int		extra_waittime;
 
@@ -238,6 +240,8 @@ struct ni_fsm_event {
 	unsigned int		ifindex;
 };
 
+#define NI_FSM_POLICY_INDEX_SIZE	256
+
 struct ni_fsm {
 	ni_ifworker_array_t	pending;
 	ni_ifworker_array_t	workers;
@@ -255,8 +259,10 @@ struct ni_fsm {
 	} process_event;
 
 	ni_fsm_policy_t *	policies;
+	ni_fsm_policy_t *	policy_index[NI_FSM_POLICY_INDEX_SIZE];	/* by name */
 
 	ni_dbus_object_t *	client_root_object;
+	ni_string_array_t	refresh_ifnames;	/* refresh these devices only */
 };
 
 typedef struct ni_ifmatcher {
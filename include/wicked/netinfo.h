@@ -150,6 +150,7 @@ extern void		ni_server_deactivate_interface_uevents(void);
 extern ni_bool_t	ni_server_disabled_uevents(void);
 extern ni_bool_t	ni_server_listens_uevents(void);
 extern void		ni_server_listen_other_events(void (*handler)(ni_event_t));
+extern void		ni_server_listen_interface_changes(void (*handler)(ni_netdev_t *));
 extern ni_dbus_server_t *ni_server_listen_dbus(const char *bus_name);
 extern ni_xs_scope_t *	ni_server_dbus_xml_schema(void);
 extern const char *	ni_config_piddir(void);
@@ -91,13 +91,17 @@ typedef struct ni_route_array	ni_route_array_t;
 struct ni_route_array {
 	unsigned int		count;
 	ni_route_t **		data;
+	unsigned int		gen;	/* bumped by every modification */
 };
 
+typedef struct ni_route_index	ni_route_index_t;
+
 struct ni_route_table {
 	ni_route_table_t *	next;
 
 	unsigned int		tid;
 	ni_route_array_t	routes;
+	ni_route_index_t *	index;
 };
 
 enum {
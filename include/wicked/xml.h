@@ -50,10 +50,15 @@ struct xml_location {
 	unsigned int		line;
 };
 
+typedef struct xml_arena	xml_arena_t;
+
 struct xml_node {
 	struct xml_node *	next;
 	uint16_t		refcount;
-	uint16_t		final : 1;
+	uint16_t		final : 1,
+				shared_name : 1,
+				shared_cdata : 1,
+				shared_attrs : 1;
 
 	char *			name;
 	struct xml_node *	parent;
@@ -65,6 +70,10 @@ struct xml_node {
 	struct xml_node *	children;
 
 	xml_location_t *	location;
+
+	/* Set when the node has been allocated from an arena; the
+	 * shared_* bits mark strings that are owned by the arena. */
+	xml_arena_t *		arena;
 };
 
 typedef struct xml_node_array	xml_node_array_t;
@@ -86,12 +95,15 @@ extern int		xml_document_uuid(const xml_document_t *, unsigned int, const ni_uui
 extern const char *	xml_document_dtd(const xml_document_t *);
 
 extern xml_document_t *	xml_document_new();
+extern xml_document_t *	xml_document_new_arena(void);
 extern xml_node_t *	xml_document_root(xml_document_t *);
 extern void		xml_document_set_root(xml_document_t *, xml_node_t *);
 extern xml_node_t *	xml_document_take_root(xml_document_t *);
 extern void		xml_document_free(xml_document_t *);
 
 extern xml_node_t *	xml_node_new(const char *ident, xml_node_t *);
+extern xml_node_t *	xml_node_new_arena(const char *ident);
+extern void		xml_node_arena_seal(xml_node_t *);
 extern xml_node_t *	xml_node_new_element(const char *ident, xml_node_t *, const char *cdata);
 extern xml_node_t *	xml_node_new_element_int(const char *ident, xml_node_t *, int);
 extern xml_node_t *	xml_node_new_element_int64(const char *ident, xml_node_t *, int64_t);
@@ -110,6 +122,7 @@ extern int		xml_node_content_uuid(const xml_node_t *, unsigned int, const ni_uui
 extern int		xml_node_print_fn(const xml_node_t *, void (*)(const char *, void *), void *);
 extern int		xml_node_print_debug(const xml_node_t *, unsigned int facility);
 extern xml_node_t *	xml_node_scan(FILE *fp, const char *location);
+extern void		xml_node_set_name(xml_node_t *, const char *);
 extern void		xml_node_set_cdata(xml_node_t *, const char *);
 extern void		xml_node_set_int(xml_node_t *, int);
 extern void		xml_node_set_int64(xml_node_t *, int64_t);
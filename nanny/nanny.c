@@ -1044,18 +1044,146 @@ ni_objectmodel_nanny_set_secret(ni_dbus_object_t *object, const ni_dbus_method_t
 	return TRUE;
 }
 
+/*
+ * Map of the netdev workers by their policy name.
+ * Rechecking many policies would otherwise encode the names of
+ * all workers again for each policy.
+ */
+typedef struct ni_nanny_worker_map_entry {
+	char *				pname;
+	unsigned int			index;
+	ni_ifworker_t *			worker;
+} ni_nanny_worker_map_entry_t;
+
+typedef struct ni_nanny_worker_map {
+	unsigned int			count;
+	unsigned int			size;
+	ni_nanny_worker_map_entry_t *	data;
+} ni_nanny_worker_map_t;
+
+static int
+ni_nanny_worker_map_entry_cmp(const void *a, const void *b)
+{
+	const ni_nanny_worker_map_entry_t *ea = a;
+	const ni_nanny_worker_map_entry_t *eb = b;
+	int rv;
+
+	if ((rv = strcmp(ea->pname, eb->pname)))
+		return rv;
+	return ea->index < eb->index ? -1 : ea->index > eb->index;
+}
+
+/* first entry with a policy name not smaller than pname */
+static unsigned int
+ni_nanny_worker_map_lower_bound(const ni_nanny_worker_map_t *map, const char *pname)
+{
+	unsigned int lo = 0, hi = map->count;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (strcmp(map->data[mid].pname, pname) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void
+ni_nanny_worker_map_insert(ni_nanny_worker_map_t *map, ni_ifworker_t *w, unsigned int index)
+{
+	ni_nanny_worker_map_entry_t entry;
+	unsigned int pos;
+
+	if (!(entry.pname = ni_ifpolicy_name_from_ifname(w->name)))
+		return;
+	entry.index = index;
+	entry.worker = w;
+
+	if (map->count == map->size) {
+		map->size = map->size ? 2 * map->size : 16;
+		map->data = xrealloc(map->data, map->size * sizeof(map->data[0]));
+	}
+
+	pos = ni_nanny_worker_map_lower_bound(map, entry.pname);
+	while (pos < map->count && ni_nanny_worker_map_entry_cmp(&map->data[pos], &entry) < 0)
+		pos++;
+	memmove(&map->data[pos + 1], &map->data[pos],
+			(map->count - pos) * sizeof(map->data[0]));
+	map->data[pos] = entry;
+	map->count++;
+}
+
+static void
+ni_nanny_worker_map_init(ni_nanny_worker_map_t *map, const ni_fsm_t *fsm)
+{
+	unsigned int i;
+
+	memset(map, 0, sizeof(*map));
+	map->size = fsm->workers.count;
+	map->data = xcalloc(map->size + 1, sizeof(map->data[0]));
+
+	for (i = 0; i < fsm->workers.count; ++i) {
+		ni_nanny_worker_map_entry_t *entry = &map->data[map->count];
+		ni_ifworker_t *w = fsm->workers.data[i];
+
+		if (!w || w->type != NI_IFWORKER_TYPE_NETDEV)
+			continue;
+		if (!(entry->pname = ni_ifpolicy_name_from_ifname(w->name)))
+			continue;
+		entry->index = i;
+		entry->worker = w;
+		map->count++;
+	}
+
+	qsort(map->data, map->count, sizeof(map->data[0]), ni_nanny_worker_map_entry_cmp);
+}
+
+static void
+ni_nanny_worker_map_destroy(ni_nanny_worker_map_t *map)
+{
+	unsigned int i;
+
+	for (i = 0; i < map->count; ++i)
+		ni_string_free(&map->data[i].pname);
+	free(map->data);
+	memset(map, 0, sizeof(*map));
+}
+
+/*
+ * Same as ni_fsm_ifworker_by_policy_name(), i.e. returns the first
+ * worker in fsm->workers using the given policy name.
+ */
+static ni_ifworker_t *
+ni_nanny_worker_map_find(const ni_nanny_worker_map_t *map, const char *pname)
+{
+	unsigned int pos;
+
+	if (!pname)
+		return NULL;
+
+	pos = ni_nanny_worker_map_lower_bound(map, pname);
+	if (pos < map->count && ni_string_eq(map->data[pos].pname, pname))
+		return map->data[pos].worker;
+	return NULL;
+}
+
 static ni_bool_t
-ni_nanny_recheck_policy(ni_nanny_t *mgr, ni_fsm_policy_t *policy)
+ni_nanny_recheck_policy(ni_nanny_t *mgr, ni_fsm_policy_t *policy, ni_nanny_worker_map_t *map)
 {
+	const char *pname = ni_fsm_policy_name(policy);
 	ni_managed_device_t *mdev;
 	xml_node_t *config;
 	ni_ifworker_t *w;
+	unsigned int i, nworkers;
 
-	w = ni_fsm_ifworker_by_policy_name(mgr->fsm, NI_IFWORKER_TYPE_NETDEV,
-							ni_fsm_policy_name(policy));
+	w = ni_nanny_worker_map_find(map, pname);
 	if (w == NULL || !w->config.node) {
 		const char *origin = ni_fsm_policy_get_origin(policy);
 
+		nworkers = mgr->fsm->workers.count;
+
 		config = xml_node_new(NI_CLIENT_IFCONFIG, NULL);
 		config = ni_fsm_policy_transform_document(config, &policy, 1);
 		if (!config) {
@@ -1070,13 +1198,19 @@ ni_nanny_recheck_policy(ni_nanny_t *mgr, ni_fsm_policy_t *policy)
 			return FALSE;
 		}
 		xml_node_free(config);
-	}
-	if (w == NULL) {
-		w = ni_fsm_ifworker_by_policy_name(mgr->fsm, NI_IFWORKER_TYPE_NETDEV,
-							ni_fsm_policy_name(policy));
+
+		/* no worker used the policy name before, so it is a new one */
+		for (i = nworkers; i < mgr->fsm->workers.count; ++i) {
+			ni_ifworker_t *nw = mgr->fsm->workers.data[i];
+
+			if (nw && nw->type == NI_IFWORKER_TYPE_NETDEV)
+				ni_nanny_worker_map_insert(map, nw, i);
+		}
 		if (w == NULL)
-			return FALSE;
+			w = ni_nanny_worker_map_find(map, pname);
 	}
+	if (w == NULL)
+		return FALSE;
 
 	ni_debug_application("Scheduled recheck for %s", w->name);
 	ni_nanny_schedule_recheck(&mgr->recheck, w);
@@ -1098,7 +1232,9 @@ ni_nanny_recheck_policies(ni_nanny_t *mgr, const ni_string_array_t *ifnames)
 {
 	ni_fsm_policy_t *policy = NULL;
 	unsigned int i, count = 0;
+	ni_nanny_worker_map_t map;
 
+	ni_nanny_worker_map_init(&map, mgr->fsm);
 	if (!ifnames || ifnames->count == 0) {
 		ni_managed_policy_t *mpolicy;
 
@@ -1106,7 +1242,7 @@ ni_nanny_recheck_policies(ni_nanny_t *mgr, const ni_string_array_t *ifnames)
 			if (!(policy = mpolicy->fsm_policy)) /* huh? */
 				continue;
 
-			if (ni_nanny_recheck_policy(mgr, policy))
+			if (ni_nanny_recheck_policy(mgr, policy, &map))
 				count++;
 		}
 	} else {
@@ -1122,10 +1258,11 @@ ni_nanny_recheck_policies(ni_nanny_t *mgr, const ni_string_array_t *ifnames)
 			}
 			ni_string_free(&name);
 
-			if (ni_nanny_recheck_policy(mgr, policy))
+			if (ni_nanny_recheck_policy(mgr, policy, &map))
 				count++;
 		}
 	}
+	ni_nanny_worker_map_destroy(&map);
 
 	if (count)
 		ni_fsm_build_hierarchy(mgr->fsm, FALSE);
@@ -1170,9 +1307,156 @@ ni_objectmodel_nanny_recheck(ni_dbus_object_t *object, const ni_dbus_method_t *m
 	return TRUE;
 }
 
+/*
+ * Apply one policy document of a Nanny.createPolicies() batch,
+ * creating the policy or updating it when it already exists.
+ */
+static ni_fsm_policy_t *
+ni_nanny_apply_policy(ni_nanny_t *mgr, xml_document_t *doc, uid_t caller_uid, char **path)
+{
+	xml_node_t *pnode = xml_document_root(doc)->children;
+	const char *pname = ni_ifpolicy_get_name(pnode);
+	ni_dbus_object_t *policy_object = NULL;
+	ni_managed_policy_t *mpolicy;
+	ni_fsm_policy_t *policy;
+
+	if ((policy = ni_fsm_policy_by_name(mgr->fsm, pname))) {
+		if (!(mpolicy = ni_nanny_get_policy(mgr, policy))) {
+			ni_error("%s: Unable to find managed policy", pname);
+			return NULL;
+		}
+		if (caller_uid != 0 && caller_uid != mpolicy->owner) {
+			ni_error("%s: Not permitted to update policy", pname);
+			return NULL;
+		}
+		if (!ni_fsm_policy_update(policy, pnode)) {
+			ni_error("%s: Incorrect/incomplete policy update", pname);
+			return NULL;
+		}
+		mpolicy->owner = caller_uid;
+		mpolicy->seqno++;
+
+		if (!ni_managed_policy_save(mpolicy))
+			ni_warn("Unable to save updated managed nanny policy %s", pname);
+
+		ni_string_printf(path, NI_OBJECTMODEL_MANAGED_POLICY_LIST_PATH "/%s", pname);
+		return policy;
+	}
+
+	if (ni_nanny_create_policy(&policy_object, mgr, doc, FALSE) <= 0)
+		return NULL;
+
+	if (!ni_objectmodel_managed_policy_save(policy_object)) {
+		ni_warn("Unable to save created managed nanny policy %s",
+			ni_dbus_object_get_path(policy_object));
+	}
+
+	ni_string_dup(path, ni_dbus_object_get_path(policy_object));
+	return ni_fsm_policy_by_name(mgr->fsm, pname);
+}
+
+/*
+ * Nanny.createPolicies(as)
+ *
+ * Create or update a batch of policies and recheck them in one go,
+ * building the device hierarchy once for the whole batch instead of
+ * once per createPolicy/recheck round trip.
+ * All documents are parsed and checked before any of them is applied;
+ * returns the object paths of the policies applied and the names of the
+ * policies failed to apply, so the caller can retry or report just them.
+ */
+static dbus_bool_t
+ni_objectmodel_nanny_create_policies(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+					unsigned int argc, const ni_dbus_variant_t *argv,
+					uid_t caller_uid,
+					ni_dbus_message_t *reply, DBusError *error)
+{
+	xml_document_array_t docs = XML_DOCUMENT_ARRAY_INIT;
+	ni_dbus_variant_t result[2];
+	ni_nanny_worker_map_t map;
+	ni_fsm_policy_t **policies;
+	unsigned int i, count = 0, rechecked = 0;
+	ni_nanny_t *mgr;
+	dbus_bool_t rv;
+
+	if ((mgr = ni_objectmodel_nanny_unwrap(object, error)) == NULL || mgr->fsm == NULL)
+		return FALSE;
+
+	if (caller_uid != 0) {
+		dbus_set_error_const(error, NI_DBUS_ERROR_PERMISSION_DENIED, NULL);
+		return FALSE;
+	}
+
+	if (argc != 1 || !ni_dbus_variant_is_string_array(&argv[0]))
+		return ni_dbus_error_invalid_args(error, ni_dbus_object_get_path(object), method->name);
+
+	for (i = 0; i < argv[0].array.len; ++i) {
+		const char *doc_string = argv[0].string_array_value[i];
+		xml_document_t *doc = NULL;
+		xml_node_t *pnode = NULL;
+
+		if (!ni_string_empty(doc_string))
+			doc = xml_document_from_string(doc_string, NULL);
+		if (doc && !xml_document_is_empty(doc))
+			pnode = xml_document_root(doc)->children;
+
+		if (!pnode || pnode->next || !ni_ifconfig_is_policy(pnode)
+		||  !ni_ifpolicy_name_is_valid(ni_ifpolicy_get_name(pnode))) {
+			dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
+				"Policy creation failed in call to %s.%s: invalid policy document #%u",
+				ni_dbus_object_get_path(object), method->name, i);
+			xml_document_free(doc);
+			xml_document_array_destroy(&docs);
+			return FALSE;
+		}
+
+		if (ni_ifconfig_migrate(pnode))
+			ni_debug_nanny("Migrated policy \"%s\" to current schema",
+					ni_ifpolicy_get_name(pnode));
+		xml_document_array_append(&docs, doc);
+	}
+
+	policies = xcalloc(docs.count + 1, sizeof(policies[0]));
+	memset(result, 0, sizeof(result));
+	ni_dbus_variant_init_object_path_array(&result[0]);
+	ni_dbus_variant_init_string_array(&result[1]);
+	for (i = 0; i < docs.count; ++i) {
+		xml_node_t *pnode = xml_document_root(docs.data[i])->children;
+		ni_fsm_policy_t *policy;
+		char *path = NULL;
+
+		if (!(policy = ni_nanny_apply_policy(mgr, docs.data[i], caller_uid, &path))) {
+			ni_dbus_variant_append_string_array(&result[1], ni_ifpolicy_get_name(pnode));
+			continue;
+		}
+
+		ni_dbus_variant_append_object_path_array(&result[0], path);
+		ni_string_free(&path);
+		policies[count++] = policy;
+	}
+	xml_document_array_destroy(&docs);
+
+	ni_nanny_worker_map_init(&map, mgr->fsm);
+	for (i = 0; i < count; ++i) {
+		if (ni_nanny_recheck_policy(mgr, policies[i], &map))
+			rechecked++;
+	}
+	ni_nanny_worker_map_destroy(&map);
+	free(policies);
+
+	if (rechecked)
+		ni_fsm_build_hierarchy(mgr->fsm, FALSE);
+
+	rv = ni_dbus_message_serialize_variants(reply, 2, result, error);
+	ni_dbus_variant_destroy(&result[0]);
+	ni_dbus_variant_destroy(&result[1]);
+	return rv;
+}
+
 static ni_dbus_method_t		ni_objectmodel_nanny_methods[] = {
 	{ "getDevice",		"s",		.handler = ni_objectmodel_nanny_get_device	 },
 	{ "createPolicy",	"s",		.handler_ex = ni_objectmodel_nanny_create_policy },
+	{ "createPolicies",	"as",		.handler_ex = ni_objectmodel_nanny_create_policies },
 	{ "deletePolicy",	"s",		.handler_ex = ni_objectmodel_nanny_delete_policy },
 	{ "addSecret",		"a{sv}ss",	.handler_ex = ni_objectmodel_nanny_set_secret	 },
 	{ "recheck",		"as",		.handler_ex = ni_objectmodel_nanny_recheck	 },
@@ -158,6 +158,7 @@ extern ni_dbus_object_t *	ni_managed_policy_register(ni_nanny_t *, ni_fsm_policy
 extern ni_managed_policy_t *	ni_managed_policy_new(ni_nanny_t *, ni_fsm_policy_t *);
 extern ni_managed_policy_t *	ni_managed_policy_ref(ni_managed_policy_t *);
 extern void			ni_managed_policy_free(ni_managed_policy_t *);
+extern ni_bool_t		ni_managed_policy_save(const ni_managed_policy_t *);
 
 extern const char *		ni_managed_state_to_string(ni_managed_state_t);
 
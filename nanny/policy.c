@@ -96,7 +96,7 @@ failure:
 	return FALSE;
 }
 
-static ni_bool_t
+ni_bool_t
 ni_managed_policy_save(const ni_managed_policy_t *mpolicy)
 {
 	const xml_node_t *node;
@@ -93,6 +93,7 @@ static void		handle_interface_event(ni_netdev_t *, ni_event_t);
 static void		handle_interface_addr_events(ni_netdev_t *, ni_event_t, const ni_address_t *);
 static void		handle_interface_prefix_events(ni_netdev_t *, ni_event_t, const ni_ipv6_ra_pinfo_t *);
 static void		handle_interface_nduseropt_events(ni_netdev_t *, ni_event_t);
+static void		handle_interface_modified(ni_netdev_t *);
 static void		handle_rfkill_event(ni_rfkill_type_t, ni_bool_t, void *);
 static void		handle_other_event(ni_event_t);
 #ifdef MODEM
@@ -254,6 +255,7 @@ run_interface_server(void)
 		ni_fatal("unable to initialize netlink prefix listener");
 	if (ni_server_enable_interface_nduseropt_events(handle_interface_nduseropt_events) < 0)
 		ni_fatal("unable to initialize netlink nduseropt listener");
+	ni_server_listen_interface_changes(handle_interface_modified);
 
 	if (ni_udev_is_active() && ni_udev_net_subsystem_available()) {
 		if (ni_server_enable_interface_uevents() < 0)
@@ -453,6 +455,18 @@ handle_interface_event(ni_netdev_t *dev, ni_event_t event)
 	}
 }
 
+/*
+ * Most device changes (addresses, routes, link details refreshed on
+ * a method call of another device, ...) don't emit any signal, but
+ * change the interface properties the clients refresh.
+ */
+static void
+handle_interface_modified(ni_netdev_t *dev)
+{
+	if (dbus_server)
+		ni_dbus_server_object_modified(ni_objectmodel_get_netif_object(dbus_server, dev));
+}
+
 static void
 handle_interface_addr_events(ni_netdev_t *dev, ni_event_t event, const ni_address_t *ap)
 {
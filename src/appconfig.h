@@ -72,8 +72,17 @@ typedef struct ni_config_rtnl_event {
 	 */
 	unsigned int	recv_buff_length;
 	unsigned int	mesg_buff_length;
+	unsigned int	coalesce_window;	/* msec */
 } ni_config_rtnl_event_t;
 
+typedef struct ni_config_route_filter {
+	/*
+	 * routes not tracked in the interface route tables
+	 */
+	ni_uint_array_t	ignore_tables;
+	ni_uint_array_t	ignore_protocols;
+} ni_config_route_filter_t;
+
 typedef enum {
 	NI_CONFIG_BONDING_CTL_NETLINK = 0,
 	NI_CONFIG_BONDING_CTL_SYSFS,
@@ -95,6 +104,20 @@ typedef struct ni_config_teamd {
 	ni_config_teamd_ctl_t	ctl;
 } ni_config_teamd_t;
 
+typedef enum {
+	NI_CONFIG_SOCKET_LOOP_EPOLL = 0,
+	NI_CONFIG_SOCKET_LOOP_POLL,
+} ni_config_socket_loop_backend_t;
+
+typedef struct ni_config_socket_loop {
+	ni_config_socket_loop_backend_t	backend;
+	ni_bool_t		edge_triggered;
+} ni_config_socket_loop_t;
+
+typedef struct ni_config_fsm {
+	unsigned int		max_async_calls;
+} ni_config_fsm_t;
+
 typedef enum {
 	NI_CONFIG_DHCP4_ROUTES_CSR,
 	NI_CONFIG_DHCP4_ROUTES_MSCSR,
@@ -194,9 +217,13 @@ typedef struct ni_config {
 	char *			dbus_type;
 
 	ni_config_rtnl_event_t	rtnl_event;
+	ni_config_route_filter_t route_filter;
 
 	ni_config_bonding_t	bonding;
 	ni_config_teamd_t	teamd;
+
+	ni_config_socket_loop_t	socket_loop;
+	ni_config_fsm_t		fsm;
 } ni_config_t;
 
 extern ni_config_t *	ni_config_new();
@@ -211,6 +238,8 @@ extern ni_bool_t	ni_config_use_nanny(void);
 extern const ni_config_dhcp4_t *	ni_config_dhcp4_find_device(const char *);
 extern const ni_config_dhcp6_t *	ni_config_dhcp6_find_device(const char *);
 
+extern ni_bool_t	ni_config_route_filter_ignored(unsigned int, unsigned int);
+
 extern ni_config_bonding_ctl_t	ni_config_bonding_ctl(void);
 
 extern ni_bool_t	ni_config_teamd_enable(ni_config_teamd_ctl_t);
@@ -219,6 +248,11 @@ extern ni_bool_t	ni_config_teamd_enabled(void);
 extern ni_config_teamd_ctl_t	ni_config_teamd_ctl(void);
 extern const char *	ni_config_teamd_ctl_type_to_name(ni_config_teamd_ctl_t);
 
+extern ni_config_socket_loop_backend_t	ni_config_socket_loop_backend(void);
+extern ni_bool_t	ni_config_socket_loop_edge_triggered(void);
+
+extern unsigned int	ni_config_fsm_max_async_calls(void);
+
 extern ni_extension_t *	ni_extension_list_find(ni_extension_t *, const char *);
 extern void		ni_extension_list_destroy(ni_extension_t **);
 extern ni_extension_t *	ni_extension_new(ni_extension_t **, const char *);
@@ -243,6 +277,7 @@ typedef struct ni_global {
 	void			(*interface_addr_event)(ni_netdev_t *, ni_event_t, const ni_address_t *);
 	void			(*interface_prefix_event)(ni_netdev_t *, ni_event_t, const ni_ipv6_ra_pinfo_t *);
 	void			(*interface_nduseropt_event)(ni_netdev_t *, ni_event_t);
+	void			(*interface_modified)(ni_netdev_t *);
 	void			(*route_event)(ni_netconfig_t *, ni_event_t, const ni_route_t *);
 	void			(*rule_event)(ni_netconfig_t *, ni_event_t, const ni_rule_t *);
 	void			(*other_event)(ni_event_t);
@@ -52,26 +52,57 @@ void
 ni_arp_socket_close(ni_arp_socket_t *arph)
 {
 	ni_capture_free(arph->capture);
+	free(arph->filter.addrs);
 	free(arph);
 }
 
+/*
+ * Let the kernel pass only ARP packets about the given addresses to
+ * the socket instead of all ARP traffic on the link. An empty set
+ * drops all packets, e.g. while the socket is used to send only.
+ */
+int
+ni_arp_socket_set_filter(ni_arp_socket_t *arph, const struct in_addr *addrs, unsigned int count)
+{
+	unsigned int hwlen;
+
+	if (!arph || !arph->capture || (count && !addrs))
+		return -1;
+
+	if (arph->filter.installed && arph->filter.count == count &&
+	    (!count || !memcmp(arph->filter.addrs, addrs, count * sizeof(addrs[0]))))
+		return 0;
+
+	hwlen = ni_link_address_length(arph->dev_info.hwaddr.type);
+	if (ni_capture_set_arp_filter(arph->capture, hwlen, addrs, count) < 0)
+		return -1;
+
+	arph->filter.installed = TRUE;
+	arph->filter.count = count;
+	arph->filter.addrs = xrealloc(arph->filter.addrs, (count + 1) * sizeof(addrs[0]));
+	if (count)
+		memcpy(arph->filter.addrs, addrs, count * sizeof(addrs[0]));
+	return 0;
+}
+
 /*
  * This callback is invoked from the socket code when we
- * detect an incoming ARP packet on the raw socket.
+ * detect incoming ARP packets on the raw socket.
  */
 static void
-ni_arp_socket_recv(ni_socket_t *sock)
+ni_arp_socket_process(ni_capture_t *capture, ni_buffer_t *buf, ni_sockaddr_t *from)
 {
-	ni_capture_t *capture = sock->user_data;
-	ni_buffer_t buf;
+	ni_arp_socket_t *arph = ni_capture_get_user_data(capture);
+	ni_arp_packet_t packet;
 
-	if (ni_capture_recv(capture, &buf, NULL, "arp") >= 0) {
-		ni_arp_socket_t *arph = ni_capture_get_user_data(capture);
-		ni_arp_packet_t packet;
+	if (ni_arp_parse(arph, buf, &packet) >= 0)
+		arph->callback(arph, &packet, arph->user_data);
+}
 
-		if (ni_arp_parse(arph, &buf, &packet) >= 0)
-			arph->callback(arph, &packet, arph->user_data);
-	}
+static void
+ni_arp_socket_recv(ni_socket_t *sock)
+{
+	ni_capture_recv_batch(sock->user_data, ni_arp_socket_process, "arp");
 }
 
 int
@@ -342,6 +373,26 @@ ni_arp_verify_process(ni_arp_socket_t *sock, const ni_arp_packet_t *pkt, void *u
 			hwaddr ? " (in use by " : "", hwaddr ? hwaddr : "", hwaddr ? ")" : "");
 }
 
+/*
+ * Receive only the ARP packets about the addresses still verified.
+ */
+static void
+ni_arp_verify_set_filter(ni_arp_socket_t *sock, const ni_arp_verify_t *vfy)
+{
+	struct in_addr *addrs;
+	unsigned int i, count = 0;
+
+	addrs = xcalloc(vfy->ipaddrs.count + 1, sizeof(addrs[0]));
+	for (i = 0; i < vfy->ipaddrs.count; ++i) {
+		const ni_address_t *ap = vfy->ipaddrs.data[i];
+
+		if (!ni_address_is_duplicate(ap))
+			addrs[count++] = ap->local_addr.sin.sin_addr;
+	}
+	ni_arp_socket_set_filter(sock, addrs, count);
+	free(addrs);
+}
+
 ni_bool_t
 ni_arp_verify_send(ni_arp_socket_t *sock, ni_arp_verify_t *vfy, unsigned int *timeout)
 {
@@ -362,6 +413,8 @@ ni_arp_verify_send(ni_arp_socket_t *sock, ni_arp_verify_t *vfy, unsigned int *ti
 		vfy->started = now;
 		vfy->nprobes--;
 
+		ni_arp_verify_set_filter(sock, vfy);
+
 		for (count = 0, i = 0; i < vfy->ipaddrs.count; ++i) {
 			ap = vfy->ipaddrs.data[i];
 
@@ -392,6 +445,8 @@ ni_arp_verify_send(ni_arp_socket_t *sock, ni_arp_verify_t *vfy, unsigned int *ti
 			ni_address_set_tentative(ap, FALSE);
 	}
 
+	/* verification done -- no more replies to process */
+	ni_arp_socket_set_filter(sock, NULL, 0);
 	return FALSE;
 }
 
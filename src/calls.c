@@ -374,6 +374,30 @@ ni_call_device_method_common(ni_dbus_object_t *object,
 	return rv;
 }
 
+/*
+ * Query the xml schema whether the call expects an argument or not.
+ * All calls that end up here always take at most one argument, which
+ * would be a dict built from the xml node passed in by the caller.
+ */
+static int
+ni_call_common_xml_args(const ni_dbus_service_t *service, const ni_dbus_method_t *method,
+			xml_node_t *config, ni_dbus_variant_t *argv, int *argc)
+{
+	memset(argv, 0, sizeof(argv[0]));
+	*argc = 0;
+
+	if (ni_dbus_xml_method_num_args(method)) {
+		ni_dbus_variant_t *dict = &argv[(*argc)++];
+
+		ni_dbus_variant_init_dict(dict);
+		if (config && !ni_dbus_xml_serialize_arg(method, 0, dict, config)) {
+			ni_error("%s.%s: error serializing argument", service->name, method->name);
+			return -NI_ERROR_CANNOT_MARSHAL;
+		}
+	}
+	return 0;
+}
+
 int
 ni_call_common_xml(ni_dbus_object_t *object, const ni_dbus_service_t *service, const ni_dbus_method_t *method,
 			xml_node_t *config, ni_objectmodel_callback_info_t **callback_list,
@@ -384,22 +408,8 @@ ni_call_common_xml(ni_dbus_object_t *object, const ni_dbus_service_t *service, c
 	int rv, argc;
 
 retry_operation:
-	memset(argv, 0, sizeof(argv));
-	argc = 0;
-
-	/* Query the xml schema whether the call expects an argument or not.
-	 * All calls that end up here always take at most one argument, which
-	 * would be a dict built from the xml node passed in by the caller. */
-	if (ni_dbus_xml_method_num_args(method)) {
-		ni_dbus_variant_t *dict = &argv[argc++];
-
-		ni_dbus_variant_init_dict(dict);
-		if (config && !ni_dbus_xml_serialize_arg(method, 0, dict, config)) {
-			ni_error("%s.%s: error serializing argument", service->name, method->name);
-			rv = -NI_ERROR_CANNOT_MARSHAL;
-			goto out;
-		}
-	}
+	if ((rv = ni_call_common_xml_args(service, method, config, argv, &argc)) < 0)
+		goto out;
 
 	rv = ni_call_device_method_common(object, service, method, argc, argv, callback_list, &error_context);
 
@@ -424,6 +434,62 @@ out:
 	return rv;
 }
 
+/*
+ * Asynchronous variant of ni_call_common_xml. The reply is passed to the
+ * callback and has to be evaluated using ni_call_common_async_result.
+ * As there is no error handler, callers have to retry calls failing with
+ * an error that needs user interaction (e.g. missing auth info) using
+ * the synchronous ni_call_common_xml.
+ */
+int
+ni_call_common_xml_async(ni_dbus_object_t *object, const ni_dbus_service_t *service,
+			const ni_dbus_method_t *method, xml_node_t *config,
+			ni_dbus_async_callback_t *callback, dbus_uint32_t *serial)
+{
+	ni_dbus_variant_t argv[1];
+	int rv, argc;
+
+	if ((rv = ni_call_common_xml_args(service, method, config, argv, &argc)) == 0) {
+		rv = ni_dbus_object_call_variant_async(object, service->name, method->name,
+				argc, argv, callback, serial);
+	}
+
+	while (argc--)
+		ni_dbus_variant_destroy(&argv[argc]);
+	return rv;
+}
+
+int
+ni_call_common_async_result(ni_dbus_message_t *reply, const ni_dbus_service_t *service,
+			const ni_dbus_method_t *method, ni_objectmodel_callback_info_t **callback_list)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	int rv = 0;
+
+	if (reply == NULL) {
+		ni_error("%s.%s() failed: no reply", service->name, method->name);
+		return -NI_ERROR_DBUS_CALL_FAILED;
+	}
+
+	if (dbus_set_error_from_message(&error, reply)) {
+		rv = ni_dbus_get_error(&error, NULL);
+		if (rv != -NI_ERROR_AUTH_INFO_MISSING)
+			ni_dbus_print_error(&error, "%s.%s() failed", service->name, method->name);
+	} else
+	if (ni_dbus_message_get_args_variants(reply, &result, 1) < 0) {
+		ni_error("%s.%s(): unable to parse response", service->name, method->name);
+		rv = -NI_ERROR_DBUS_CALL_FAILED;
+	} else
+	if (callback_list) {
+		*callback_list = ni_objectmodel_callback_info_from_dict(&result);
+	}
+
+	ni_dbus_variant_destroy(&result);
+	dbus_error_free(&error);
+	return rv;
+}
+
 static int
 ni_get_device_method(ni_dbus_object_t *object, const char *method_name, const ni_dbus_service_t **service_ret, const ni_dbus_method_t **method_ret)
 {
@@ -50,6 +50,14 @@
 #define MTU_MAX			1500
 #define DHCP_CLIENT_PORT	68
 
+/*
+ * Receive batching: every socket wakeup drains up to
+ * NI_CAPTURE_RECV_ROUNDS batches of NI_CAPTURE_RECV_BATCH
+ * packets, before we return to the main loop again.
+ */
+#define NI_CAPTURE_RECV_BATCH	16
+#define NI_CAPTURE_RECV_ROUNDS	4
+
 #ifndef ETHERTYPE_LLDP
 # define ETHERTYPE_LLDP		0x88CC
 #endif
@@ -70,6 +78,14 @@ struct tpacket_auxdata {
 };
 #endif
 
+/* in case the libc does not provide recvmmsg */
+#if !defined(HAVE_RECVMMSG)
+struct mmsghdr {
+	struct msghdr	msg_hdr;
+	unsigned int	msg_len;
+};
+#endif
+
 /*
  * Credit where credit is due :)
  * The below BPF filter is taken from ISC DHCP
@@ -110,6 +126,23 @@ typedef union ni_packetaddr {
 	struct sockaddr_ll	sll;
 } ni_packetaddr_t;
 
+/*
+ * Per packet receive slot of a batch
+ */
+#if defined(PACKET_AUXDATA)
+/* use 2 times bigger buffer to catch possible additions... */
+# define NI_CAPTURE_CBUF_SIZE	(CMSG_SPACE(sizeof(struct tpacket_auxdata)*2) + \
+				 CMSG_SPACE(sizeof(uint32_t)))
+#else
+# define NI_CAPTURE_CBUF_SIZE	CMSG_SPACE(sizeof(uint32_t))
+#endif
+
+typedef struct ni_capture_rslot {
+	ni_sockaddr_t		from;
+	struct iovec		iov;
+	unsigned char		cbuf[NI_CAPTURE_CBUF_SIZE];
+} ni_capture_rslot_t;
+
 /*
  * Platform specific
  */
@@ -120,33 +153,70 @@ struct ni_capture {
 
 	char *			ifname;
 
-	void *			buffer;
+	void *			buffer;		/* batch * mtu bytes */
 	size_t			mtu;
 
+	struct {
+		struct mmsghdr		msgs[NI_CAPTURE_RECV_BATCH];
+		ni_capture_rslot_t	slot[NI_CAPTURE_RECV_BATCH];
+
+		/* shared capture receive handler */
+		ni_capture_recv_fn_t *	handler;
+		const char *		hint;
+		size_t			mtu;	/* largest user mtu */
+	} recv;
+
+	/*
+	 * Shared captures are refcounted by their users, which
+	 * send via the owner's socket and have no buffer.
+	 */
+	unsigned int		refcount;
+	ni_capture_t *		owner;
+
+	struct {
+		unsigned long		packets;
+		unsigned int		drops;	/* dropped by the kernel */
+	} stats;
+
 	struct {
 		struct timeval		deadline;
 		const ni_buffer_t *	buffer;
 		ni_timeout_param_t	timeout;
+		const ni_timer_t *	timer;	/* shared capture users */
 	} retrans;
 
 	void *			user_data;
 };
 
 static int		ni_capture_set_filter(ni_capture_t *, const ni_capture_protinfo_t *);
+static void		__ni_capture_update_timeout(ni_capture_t *);
 static ssize_t		__ni_capture_send(const ni_capture_t *, const ni_buffer_t *);
 
+/*
+ * Sum 32bit words into a 64bit accumulator; as 2^16 == 1 in one's
+ * complement arithmetic this is the same as summing the 16bit words,
+ * in either byte order. Folded to 16 bits (+ carry) on return, so
+ * callers can keep adding.
+ */
 static uint32_t
 checksum_partial(uint32_t sum, const void *data, uint16_t len)
 {
-	union {
-		const uint16_t *s;
-		const uint8_t *c;
-	} u;
-
-	u.s = data;
-	while (len > 1) {
-		sum += *u.s++;
-		len -= 2;
+	const unsigned char *ptr = data;
+	uint64_t acc = sum;
+	uint32_t w;
+	uint16_t s;
+
+	while (len >= sizeof(w)) {
+		memcpy(&w, ptr, sizeof(w));
+		acc += w;
+		ptr += sizeof(w);
+		len -= sizeof(w);
+	}
+	if (len >= sizeof(s)) {
+		memcpy(&s, ptr, sizeof(s));
+		acc += s;
+		ptr += sizeof(s);
+		len -= sizeof(s);
 	}
 
 	if (len == 1) {
@@ -154,11 +224,15 @@ checksum_partial(uint32_t sum, const void *data, uint16_t len)
 			uint8_t c[2];
 			uint16_t s;
 		} bs;
-		bs.c[0] = u.c[0];
+		bs.c[0] = ptr[0];
 		bs.c[1] = 0;
-		sum += bs.s;
+		acc += bs.s;
 	}
-	return sum;
+
+	acc = (acc >> 32) + (acc & 0xffffffff);
+	acc = (acc >> 16) + (acc & 0xffff);
+	acc = (acc >> 16) + (acc & 0xffff);
+	return acc;
 }
 
 static inline uint16_t
@@ -201,8 +275,10 @@ ipudp_checksum(const struct ip *iph, const struct udphdr *uhp,
 	csum = checksum_partial(bs.s + uh.uh_ulen, &iph->ip_src, 2* sizeof(iph->ip_src));
 	csum = checksum_partial(csum, data, length);
 	csum = checksum_partial(csum, &uh, sizeof(uh));
+	csum = checksum_fold(csum);
 
-	return checksum_fold(csum);
+	/* a zero UDP checksum means none, transmit it as all ones */
+	return csum ? csum : 0xffff;
 }
 
 int
@@ -259,6 +335,56 @@ ni_capture_build_udp_header(ni_buffer_t *bp,
 	return 0;
 }
 
+/*
+ * Replace len bytes at offset into the UDP payload of a packet built
+ * by ni_capture_build_udp_header and adjust the UDP checksum using
+ * HC' = ~(~HC + ~m + m') [RFC 1624] instead of summing the packet
+ * again. Used to update e.g. the dhcp4 secs field on retransmits.
+ */
+int
+ni_capture_update_udp_payload(ni_buffer_t *bp, unsigned int offset,
+		const void *data, size_t len)
+{
+	const unsigned char *src = data;
+	unsigned char *ptr;
+	struct udphdr *udp;
+	struct ip *ip;
+	uint16_t old, new;
+	uint32_t csum;
+	size_t count, i;
+
+	/* only word aligned updates keep the 16bit sums aligned */
+	if ((offset | len) & 1)
+		return -1;
+
+	count = ni_buffer_count(bp);
+	if (count < sizeof(*ip) + sizeof(*udp))
+		return -1;
+
+	ip = ni_buffer_head(bp);
+	if (ip->ip_v != 4 || ip->ip_hl != 5 || ip->ip_p != IPPROTO_UDP)
+		return -1;
+
+	udp = (struct udphdr *)(ip + 1);
+	if (ntohs(udp->uh_ulen) != count - sizeof(*ip) ||
+	    offset + len > count - sizeof(*ip) - sizeof(*udp))
+		return -1;
+
+	ptr = (unsigned char *)(udp + 1) + offset;
+	if (udp->uh_sum) {
+		csum = (uint16_t)~udp->uh_sum;
+		for (i = 0; i < len; i += 2) {
+			memcpy(&old, ptr + i, sizeof(old));
+			memcpy(&new, src + i, sizeof(new));
+			csum += (uint16_t)~old + new;
+		}
+		csum = checksum_fold(csum);
+		udp->uh_sum = csum ? csum : 0xffff;
+	}
+	memcpy(ptr, src, len);
+	return 0;
+}
+
 static void *
 ni_capture_inspect_udp_header(void *data, size_t bytes, size_t *payload_len,
 				ni_bool_t partial_checksum)
@@ -328,13 +454,17 @@ void
 ni_capture_arm_retransmit(ni_capture_t *capture)
 {
 	ni_timeout_arm(&capture->retrans.deadline, &capture->retrans.timeout);
+	__ni_capture_update_timeout(capture);
 }
 
 void
 ni_capture_disarm_retransmit(ni_capture_t *capture)
 {
 	/* Clear retransmit timer, buffer, and everything else */
+	if (capture->retrans.timer)
+		ni_timer_cancel(capture->retrans.timer);
 	memset(&capture->retrans, 0, sizeof(capture->retrans));
+	__ni_capture_update_timeout(capture);
 }
 
 void
@@ -345,6 +475,7 @@ ni_capture_force_retransmit(ni_capture_t *capture, unsigned int delay)
 
 		ni_timer_get_time(deadline);
 		deadline->tv_sec += delay;
+		__ni_capture_update_timeout(capture);
 	}
 }
 
@@ -415,56 +546,137 @@ __ni_capture_socket_check_timeout(ni_socket_t *sock, const struct timeval *now)
 		ni_capture_retransmit(capture);
 }
 
+/*
+ * Users of a shared capture do not own a socket and use
+ * a timer for their retransmits instead.
+ */
+static void
+__ni_capture_retrans_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_capture_t *capture = user_data;
+
+	if (capture->retrans.timer != timer)
+		return;
+	capture->retrans.timer = NULL;
+
+	ni_capture_retransmit(capture);
+}
+
+static void
+__ni_capture_update_timeout(ni_capture_t *capture)
+{
+	struct timeval now, delta;
+	unsigned long timeout = 0;
+
+	if (!capture->owner) {
+		ni_socket_update_timeout(capture->sock);
+		return;
+	}
+
+	if (!timerisset(&capture->retrans.deadline)) {
+		if (capture->retrans.timer) {
+			ni_timer_cancel(capture->retrans.timer);
+			capture->retrans.timer = NULL;
+		}
+		return;
+	}
+
+	ni_timer_get_time(&now);
+	if (timercmp(&capture->retrans.deadline, &now, >)) {
+		timersub(&capture->retrans.deadline, &now, &delta);
+		timeout = delta.tv_sec * 1000 + (delta.tv_usec + 999) / 1000;
+	}
+
+	if (capture->retrans.timer &&
+	    (capture->retrans.timer = ni_timer_rearm(capture->retrans.timer, timeout)))
+		return;
+	capture->retrans.timer = ni_timer_register(timeout, __ni_capture_retrans_timeout, capture);
+}
+
 /*
  * Capture receive handling
  */
-int
-__ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_sockaddr_t *from)
+static void
+__ni_capture_recv_prepare(ni_capture_t *capture, unsigned int i)
 {
-#if defined(PACKET_AUXDATA)
-	/* use 2 times bigger buffer to catch possible additions... */
-	unsigned char cbuf[CMSG_SPACE(sizeof(struct tpacket_auxdata)*2)];
-	struct iovec iov = {
-		.iov_base = buf,
-		.iov_len  = len,
-	};
-	struct msghdr msg = {
-		.msg_iov = &iov,
-		.msg_iovlen = 1,
-		.msg_control = cbuf,
-		.msg_controllen = sizeof(cbuf),
-		.msg_name = from ? from : NULL,
-		.msg_namelen = from ? sizeof(from->ss) : 0,
-	};
-	struct cmsghdr *cmsg;
-	struct tpacket_auxdata *aux;
+	ni_capture_rslot_t *slot = &capture->recv.slot[i];
+	struct mmsghdr *mmsg = &capture->recv.msgs[i];
+
+	memset(&slot->from, 0, sizeof(slot->from));
+	slot->iov.iov_base = (unsigned char *)capture->buffer + i * capture->mtu;
+	slot->iov.iov_len = capture->mtu;
+
+	memset(mmsg, 0, sizeof(*mmsg));
+	mmsg->msg_hdr.msg_iov = &slot->iov;
+	mmsg->msg_hdr.msg_iovlen = 1;
+	mmsg->msg_hdr.msg_control = slot->cbuf;
+	mmsg->msg_hdr.msg_controllen = sizeof(slot->cbuf);
+	mmsg->msg_hdr.msg_name = &slot->from;
+	mmsg->msg_hdr.msg_namelen = sizeof(slot->from.ss);
+}
+
+static int
+__ni_capture_recvmmsg(int fd, struct mmsghdr *msgs, unsigned int vlen)
+{
+#if defined(HAVE_RECVMMSG)
+	return recvmmsg(fd, msgs, vlen, MSG_DONTWAIT, NULL);
+#else
+	unsigned int i;
 	ssize_t bytes;
 
-	*partial_csum = FALSE;
-	memset(cbuf, 0, sizeof(cbuf));
-	if (from)
-		memset(from, 0, sizeof(*from));
+	for (i = 0; i < vlen; ++i) {
+		if ((bytes = recvmsg(fd, &msgs[i].msg_hdr, MSG_DONTWAIT)) < 0)
+			return i ? (int)i : -1;
+		msgs[i].msg_len = bytes;
+	}
+	return i;
+#endif
+}
+
+static void
+__ni_capture_update_drops(ni_capture_t *capture, uint32_t drops)
+{
+	uint32_t delta = drops - capture->stats.drops;
+
+	/* the kernel reports a running counter; ignore stale values */
+	if (delta == 0 || delta > INT32_MAX)
+		return;
+
+	capture->stats.drops = drops;
+	ni_debug_socket("%s: kernel dropped %u packets (%u total)",
+			capture->ifname, delta, drops);
+}
 
-	if ((bytes = recvmsg (fd, &msg, 0)) < 0)
-		return bytes;
+static ni_bool_t
+__ni_capture_recv_cmsg(ni_capture_t *capture, struct msghdr *msg)
+{
+	ni_bool_t partial_csum = FALSE;
+	struct cmsghdr *cmsg;
 
-	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+#if defined(PACKET_AUXDATA)
 		if (cmsg->cmsg_level == SOL_PACKET &&
 		    cmsg->cmsg_type == PACKET_AUXDATA &&
 		    cmsg->cmsg_len >= CMSG_LEN(sizeof(struct tpacket_auxdata))) {
-			aux = (void *)CMSG_DATA(cmsg);
+			struct tpacket_auxdata *aux = (void *)CMSG_DATA(cmsg);
+
 			if (aux->tp_status & TP_STATUS_CSUMNOTREADY)
-				*partial_csum = TRUE;
-			break;
+				partial_csum = TRUE;
+			continue;
+		}
+#endif
+#if defined(SO_RXQ_OVFL)
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+		    cmsg->cmsg_type == SO_RXQ_OVFL &&
+		    cmsg->cmsg_len >= CMSG_LEN(sizeof(uint32_t))) {
+			uint32_t drops;
+
+			memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+			__ni_capture_update_drops(capture, drops);
 		}
-	}
-
-	return bytes;
-#else
-	*partial_csum = FALSE;
-
-	return read(fd, buf, len);
 #endif
+	}
+	return partial_csum;
 }
 
 ni_bool_t
@@ -494,26 +706,34 @@ ni_capture_from_hwaddr_print(const ni_sockaddr_t *from)
 	return ni_link_address_print(&hwaddr);
 }
 
-int
-ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, const char *hint)
+unsigned int
+ni_capture_from_ifindex(const ni_sockaddr_t *from)
 {
-	void *payload;
+	const struct sockaddr_ll *ll;
+
+	if (!from || from->ss_family != AF_PACKET)
+		return 0;
+
+	ll = (const struct sockaddr_ll *)&from->ss;
+	return ll->sll_ifindex;
+}
+
+static int
+__ni_capture_recv_packet(ni_capture_t *capture, unsigned int i, ni_buffer_t *bp, const char *hint)
+{
+	ni_capture_rslot_t *slot = &capture->recv.slot[i];
+	struct mmsghdr *mmsg = &capture->recv.msgs[i];
+	void *buffer = slot->iov.iov_base;
+	size_t bytes = mmsg->msg_len;
+	ni_bool_t partial_checksum;
 	size_t payload_len;
-	ssize_t bytes;
-	ni_bool_t partial_checksum = FALSE;
 	const char *lladdr;
+	void *payload;
 
-	bytes = __ni_capture_recv(capture->sock->__fd, capture->buffer,
-				  capture->mtu, &partial_checksum, from);
+	partial_checksum = __ni_capture_recv_cmsg(capture, &mmsg->msg_hdr);
+	capture->stats.packets++;
 
-	if (bytes < 0) {
-		ni_error("%s: %s cannot read %s%spacket from socket: %m",
-				capture->ifname, __FUNCTION__,
-				hint ? hint : "", hint ? " " : "");
-		return -1;
-	}
-
-	lladdr = ni_capture_from_hwaddr_print(from);
+	lladdr = ni_capture_from_hwaddr_print(&slot->from);
 	ni_debug_socket("%s: incoming %s%spacket%s%s%s", capture->ifname,
 			hint ? hint : "", hint ? " " : "",
 			(partial_checksum ? " with partial checksum" : ""),
@@ -522,7 +742,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 	switch (capture->protocol) {
 	case ETHERTYPE_IP:
 		/* Make sure IP and UDP header are sane */
-		payload = ni_capture_inspect_udp_header(capture->buffer, bytes,
+		payload = ni_capture_inspect_udp_header(buffer, bytes,
 						&payload_len, partial_checksum);
 		if (payload == NULL) {
 			ni_debug_socket("%s: bad IP/UDP %s%spacket header",
@@ -534,7 +754,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 
 	case ETHERTYPE_ARP:
 	case ETHERTYPE_LLDP:
-		payload = capture->buffer;
+		payload = buffer;
 		payload_len = bytes;
 		break;
 
@@ -548,6 +768,60 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 	return payload_len;
 }
 
+/*
+ * Drain the packets queued on the capture socket and pass them
+ * in order to the protocol handler. The handler may close the
+ * capture, so we stop as soon as the socket is gone.
+ * Returns the number of packets passed to the handler.
+ */
+int
+ni_capture_recv_batch(ni_capture_t *capture, ni_capture_recv_fn_t *handler, const char *hint)
+{
+	ni_socket_t *sock = capture->sock;
+	unsigned int round, i;
+	int count, total = 0;
+	ni_buffer_t buf;
+
+	/* a shared capture user with a larger mtu attached */
+	if (capture->recv.mtu > capture->mtu) {
+		free(capture->buffer);
+		capture->mtu = capture->recv.mtu;
+		capture->buffer = xmalloc(NI_CAPTURE_RECV_BATCH * capture->mtu);
+	}
+
+	for (round = 0; round < NI_CAPTURE_RECV_ROUNDS; ++round) {
+		for (i = 0; i < NI_CAPTURE_RECV_BATCH; ++i)
+			__ni_capture_recv_prepare(capture, i);
+
+		count = __ni_capture_recvmmsg(sock->__fd, capture->recv.msgs,
+						NI_CAPTURE_RECV_BATCH);
+		if (count < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				break;
+
+			ni_error("%s: %s cannot read %s%spacket from socket: %m",
+					capture->ifname, __FUNCTION__,
+					hint ? hint : "", hint ? " " : "");
+			return total ? total : -1;
+		}
+
+		for (i = 0; i < (unsigned int)count; ++i) {
+			if (__ni_capture_recv_packet(capture, i, &buf, hint) < 0)
+				continue;
+
+			handler(capture, &buf, &capture->recv.slot[i].from);
+			total++;
+
+			if (sock->__fd < 0)
+				return total;
+		}
+
+		if (count < NI_CAPTURE_RECV_BATCH)
+			break;
+	}
+	return total;
+}
+
 /*
  * Get/set user data
  */
@@ -663,6 +937,20 @@ __ni_capture_enable_packet_auxdata(int fd)
 #endif
 }
 
+static void
+__ni_capture_enable_drop_counter(int fd)
+{
+#if defined(SO_RXQ_OVFL)
+	int on = 1;
+
+	if (setsockopt (fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0) {
+		if (errno != ENOPROTOOPT) {
+			ni_error("cannot enable socket drop counter: %m");
+		}
+	}
+#endif
+}
+
 static void
 __ni_capture_init_once(void)
 {
@@ -676,31 +964,52 @@ __ni_capture_init_once(void)
 	ni_modprobe(AFPACKET_MODULE_NAME, AFPACKET_MODULE_OPTS);
 }
 
-ni_capture_t *
-ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo, void (*receive)(ni_socket_t *))
+static int
+__ni_capture_get_destaddr(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo,
+			ni_hwaddr_t *destaddr)
 {
-	ni_packetaddr_t	addr;
-	ni_capture_t *capture = NULL;
-	ni_hwaddr_t destaddr;
-	int fd = -1;
-
 	if (devinfo->ifindex == 0) {
 		ni_error("no ifindex for interface `%s'", devinfo->ifname);
-		return NULL;
+		return -1;
 	}
 	if (protinfo->eth_protocol == 0) {
 		ni_error("%s: bad ethernet protocol for dev %s", __func__, devinfo->ifname);
-		return NULL;
+		return -1;
 	}
 
 	/* Destination address defaults to broadcast */
-	destaddr = protinfo->eth_destaddr;
+	*destaddr = protinfo->eth_destaddr;
 
-	if (destaddr.len == 0
-	 && ni_link_address_get_broadcast(devinfo->hwaddr.type, &destaddr) < 0) {
+	if (destaddr->len == 0
+	 && ni_link_address_get_broadcast(devinfo->hwaddr.type, destaddr) < 0) {
 		ni_error("cannot get broadcast address for %s (bad iftype)", devinfo->ifname);
-		return NULL;
+		return -1;
 	}
+	return 0;
+}
+
+static void
+__ni_capture_set_destaddr(ni_capture_t *capture, const ni_capture_devinfo_t *devinfo,
+			const ni_capture_protinfo_t *protinfo, const ni_hwaddr_t *destaddr)
+{
+	capture->addr.sll.sll_family = AF_PACKET;
+	capture->addr.sll.sll_protocol = htons(protinfo->eth_protocol);
+	capture->addr.sll.sll_ifindex = devinfo->ifindex;
+	capture->addr.sll.sll_hatype = htons(devinfo->hwaddr.type);
+	capture->addr.sll.sll_halen = destaddr->len;
+	memcpy(&capture->addr.sll.sll_addr, destaddr->data, destaddr->len);
+}
+
+ni_capture_t *
+ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo, void (*receive)(ni_socket_t *))
+{
+	ni_packetaddr_t	addr;
+	ni_capture_t *capture = NULL;
+	ni_hwaddr_t destaddr;
+	int fd = -1;
+
+	if (__ni_capture_get_destaddr(devinfo, protinfo, &destaddr) < 0)
+		return NULL;
 
 	__ni_capture_init_once();
 
@@ -716,13 +1025,7 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	ni_string_dup(&capture->ifname, devinfo->ifname);
 	capture->sock = ni_socket_wrap(fd, SOCK_DGRAM);
 	capture->protocol = protinfo->eth_protocol;
-
-	capture->addr.sll.sll_family = AF_PACKET;
-	capture->addr.sll.sll_protocol = htons(protinfo->eth_protocol);
-	capture->addr.sll.sll_ifindex = devinfo->ifindex;
-	capture->addr.sll.sll_hatype = htons(devinfo->hwaddr.type);
-	capture->addr.sll.sll_halen = destaddr.len;
-	memcpy(&capture->addr.sll.sll_addr, destaddr.data, destaddr.len);
+	__ni_capture_set_destaddr(capture, devinfo, protinfo, &destaddr);
 
 	if (ni_capture_set_filter(capture, protinfo) < 0)
 		goto failed;
@@ -738,11 +1041,12 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	}
 
 	__ni_capture_enable_packet_auxdata(fd);
+	__ni_capture_enable_drop_counter(fd);
 
 	capture->mtu = devinfo->mtu;
 	if (capture->mtu == 0)
 		capture->mtu = MTU_MAX;
-	capture->buffer = xmalloc(capture->mtu);
+	capture->buffer = xmalloc(NI_CAPTURE_RECV_BATCH * capture->mtu);
 
 	capture->sock->receive = receive;
 	capture->sock->get_timeout = __ni_capture_socket_get_timeout;
@@ -758,6 +1062,105 @@ failed:
 	return NULL;
 }
 
+/*
+ * A shared capture is a single socket, which is not bound to any
+ * interface and receives the packets matching protinfo on all of
+ * them. The handler is called with the shared capture; use
+ * ni_capture_from_ifindex() to find out where a packet came from.
+ * Per interface captures to send and retransmit are created with
+ * ni_capture_attach().
+ */
+static void
+__ni_capture_shared_recv(ni_socket_t *sock)
+{
+	ni_capture_t *capture = sock->user_data;
+
+	/* the handler may release the last user */
+	capture->refcount++;
+	ni_capture_recv_batch(capture, capture->recv.handler, capture->recv.hint);
+	ni_capture_free(capture);
+}
+
+ni_capture_t *
+ni_capture_open_shared(const ni_capture_protinfo_t *protinfo, ni_capture_recv_fn_t *handler, const char *hint)
+{
+	ni_capture_t *capture;
+	int fd;
+
+	if (protinfo->eth_protocol == 0 || !handler) {
+		ni_error("%s: bad ethernet protocol or handler", __func__);
+		return NULL;
+	}
+
+	__ni_capture_init_once();
+
+	if ((fd = socket (PF_PACKET, SOCK_DGRAM, htons(protinfo->eth_protocol))) < 0) {
+		ni_error("socket: %m");
+		return NULL;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	capture = calloc(1, sizeof(*capture));
+	if (!capture) {
+		close(fd);
+		return NULL;
+	}
+	ni_string_dup(&capture->ifname, "any");
+	capture->sock = ni_socket_wrap(fd, SOCK_DGRAM);
+	capture->protocol = protinfo->eth_protocol;
+	capture->refcount = 1;
+	capture->recv.handler = handler;
+	capture->recv.hint = hint;
+
+	if (ni_capture_set_filter(capture, protinfo) < 0) {
+		ni_capture_free(capture);
+		return NULL;
+	}
+
+	__ni_capture_enable_packet_auxdata(fd);
+	__ni_capture_enable_drop_counter(fd);
+
+	capture->mtu = MTU_MAX;
+	capture->buffer = xmalloc(NI_CAPTURE_RECV_BATCH * capture->mtu);
+
+	capture->sock->receive = __ni_capture_shared_recv;
+	capture->sock->user_data = capture;
+	ni_socket_activate(capture->sock);
+	return capture;
+}
+
+ni_capture_t *
+ni_capture_attach(ni_capture_t *owner, const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo)
+{
+	ni_capture_t *capture;
+	ni_hwaddr_t destaddr;
+
+	if (!owner || !owner->refcount || owner->protocol != protinfo->eth_protocol) {
+		ni_error("%s: not a shared %s capture", __func__, devinfo->ifname);
+		return NULL;
+	}
+
+	if (__ni_capture_get_destaddr(devinfo, protinfo, &destaddr) < 0)
+		return NULL;
+
+	capture = calloc(1, sizeof(*capture));
+	if (!capture)
+		return NULL;
+
+	ni_string_dup(&capture->ifname, devinfo->ifname);
+	capture->sock = owner->sock;
+	capture->protocol = protinfo->eth_protocol;
+	__ni_capture_set_destaddr(capture, devinfo, protinfo, &destaddr);
+
+	capture->mtu = devinfo->mtu ? devinfo->mtu : MTU_MAX;
+	if (owner->recv.mtu < capture->mtu)
+		owner->recv.mtu = capture->mtu;
+
+	capture->owner = owner;
+	owner->refcount++;
+	return capture;
+}
+
 static int
 ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
 {
@@ -801,6 +1204,78 @@ ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
 	return 0;
 }
 
+/*
+ * Install a filter passing only ARP packets for IPv4 with a sender or
+ * target address in the given set; an empty set drops all packets.
+ * The packet socket strips the link layer header, so the offsets are
+ * relative to the ARP header:
+ *   hrd(2) pro(2) hln(1) pln(1) op(2) sha(hln) sip(4) tha(hln) tip(4)
+ */
+#define NI_CAPTURE_ARP_FILTER_MAX	64
+
+int
+ni_capture_set_arp_filter(ni_capture_t *cap, unsigned int hwlen,
+			const struct in_addr *addrs, unsigned int count)
+{
+	struct bpf_insn filter[10 + 2 * NI_CAPTURE_ARP_FILTER_MAX];
+	unsigned int i, n = 0, drop, accept;
+	struct sock_fprog pf;
+
+	if (!cap || !cap->sock || cap->protocol != ETHERTYPE_ARP || (count && !addrs))
+		return -1;
+
+	if (count == 0) {
+		filter[n++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, 0);
+	} else {
+		/* match any address when there are too many for the jumps */
+		if (count > NI_CAPTURE_ARP_FILTER_MAX)
+			count = 0;
+
+		drop = 8 + 2 * count;
+		accept = drop + 1;
+
+		filter[n++] = (struct bpf_insn)BPF_STMT(BPF_LD + BPF_H + BPF_ABS, 2);
+		filter[n] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					ETHERTYPE_IP, 0, drop - n - 1);
+		n++;
+		filter[n++] = (struct bpf_insn)BPF_STMT(BPF_LD + BPF_B + BPF_ABS, 4);
+		filter[n] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					hwlen, 0, drop - n - 1);
+		n++;
+		filter[n++] = (struct bpf_insn)BPF_STMT(BPF_LD + BPF_B + BPF_ABS, 5);
+		filter[n] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					4, count ? 0 : accept - n - 1, drop - n - 1);
+		n++;
+
+		/* sender protocol address */
+		filter[n++] = (struct bpf_insn)BPF_STMT(BPF_LD + BPF_W + BPF_ABS, 8 + hwlen);
+		for (i = 0; i < count; ++i, ++n) {
+			filter[n] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					ntohl(addrs[i].s_addr), accept - n - 1, 0);
+		}
+
+		/* target protocol address */
+		filter[n++] = (struct bpf_insn)BPF_STMT(BPF_LD + BPF_W + BPF_ABS, 12 + 2 * hwlen);
+		for (i = 0; i < count; ++i, ++n) {
+			filter[n] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					ntohl(addrs[i].s_addr), accept - n - 1, 0);
+		}
+
+		filter[n++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, 0);
+		filter[n++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, ~0U);
+	}
+
+	memset(&pf, 0, sizeof(pf));
+	pf.filter = filter;
+	pf.len = n;
+
+	if (setsockopt(cap->sock->__fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) < 0) {
+		ni_error("%s: SO_ATTACH_FILTER: %m", cap->ifname);
+		return -1;
+	}
+	return 0;
+}
+
 ssize_t
 __ni_capture_send(const ni_capture_t *capture, const ni_buffer_t *buf)
 {
@@ -840,6 +1315,18 @@ ni_capture_free(ni_capture_t *capture)
 {
 	if (!capture)
 		return;
+	if (capture->refcount && --capture->refcount)
+		return;
+	if (capture->owner) {
+		if (capture->retrans.timer)
+			ni_timer_cancel(capture->retrans.timer);
+		ni_capture_free(capture->owner);
+		capture->sock = NULL;
+	}
+	if (capture->stats.drops)
+		ni_debug_socket("%s: %lu packets received, %u dropped by the kernel",
+				capture->ifname, capture->stats.packets,
+				capture->stats.drops);
 	if (capture->sock)
 		ni_socket_close(capture->sock);
 	if (capture->buffer)
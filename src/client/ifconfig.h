@@ -74,6 +74,7 @@ extern int			ni_nanny_addpolicy(xml_document_t *);
 extern ni_dbus_client_t *	ni_nanny_create_client(ni_dbus_object_t **);
 
 extern ni_bool_t		ni_nanny_call_add_policy(const char *, xml_node_t *);
+extern int			ni_nanny_call_add_policies(const xml_node_t *, ni_string_array_t *);
 extern ni_bool_t		ni_nanny_call_del_policy(const char *);
 extern ni_bool_t		ni_nanny_call_device_enable(const char *ifname);
 extern ni_bool_t		ni_nanny_call_device_disable(const char *ifname);
@@ -234,7 +234,7 @@ ni_convert_cfg_into_policy_node(const xml_node_t *ifcfg, xml_node_t *match, cons
 
 	/* clone <interface> into policy and rename to <merge> */
 	node = xml_node_clone(ifcfg, ifpolicy);
-	ni_string_dup(&node->name, NI_NANNY_IFPOLICY_MERGE);
+	xml_node_set_name(node, NI_NANNY_IFPOLICY_MERGE);
 
 	return ifpolicy;
 }
@@ -14,12 +14,14 @@
 #include <limits.h>
 #include <dlfcn.h>
 #include <netinet/if_ether.h>
+#include <linux/rtnetlink.h>
 
 #include <wicked/util.h>
 #include <wicked/wicked.h>
 #include <wicked/netinfo.h>
 #include <wicked/addrconf.h>
 #include <wicked/address.h>
+#include <wicked/route.h>
 #include <wicked/xpath.h>
 #include <wicked/dbus.h>
 #include "netinfo_priv.h"
@@ -49,8 +51,11 @@ static ni_bool_t	ni_config_parse_system_updater(ni_extension_t **, xml_node_t *)
 static ni_bool_t	ni_config_parse_extension(ni_extension_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_sources(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_rtnl_event(ni_config_rtnl_event_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_route_filter(ni_config_route_filter_t *, const xml_node_t *);
 static ni_bool_t	ni_config_parse_bonding(ni_config_bonding_t *, const xml_node_t *);
 static ni_bool_t	ni_config_parse_teamd(ni_config_teamd_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_socket_loop(ni_config_socket_loop_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_fsm(ni_config_fsm_t *, const xml_node_t *);
 static ni_c_binding_t *	ni_c_binding_new(ni_c_binding_t **, const char *name, const char *lib, const char *symbol);
 static const char *	ni_config_build_include(char *, size_t, const char *, const char *);
 static unsigned int	ni_config_addrconf_update_mask_all(void);
@@ -91,6 +96,7 @@ ni_config_new()
 
 	conf->rtnl_event.recv_buff_length = 1024 * 1024;
 	conf->rtnl_event.mesg_buff_length = 0;
+	conf->rtnl_event.coalesce_window = 0;
 
 	/* we enable it explicitly in wickedd only */
 	conf->teamd.enabled = FALSE;
@@ -257,6 +263,9 @@ ni_config_free(ni_config_t *conf)
 	ni_config_dhcp4_destroy(&conf->addrconf.dhcp4);
 	ni_config_dhcp6_destroy(&conf->addrconf.dhcp6);
 
+	ni_uint_array_destroy(&conf->route_filter.ignore_tables);
+	ni_uint_array_destroy(&conf->route_filter.ignore_protocols);
+
 	free(conf);
 }
 
@@ -409,6 +418,10 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 			if (!ni_config_parse_rtnl_event(&conf->rtnl_event, child))
 				goto failed;
 		} else
+		if (strcmp(child->name, "route-filter") == 0) {
+			if (!ni_config_parse_route_filter(&conf->route_filter, child))
+				goto failed;
+		} else
 		if (strcmp(child->name, "bonding") == 0) {
 			if (!ni_config_parse_bonding(&conf->bonding, child))
 				goto failed;
@@ -416,6 +429,14 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 		if (strcmp(child->name, "teamd") == 0) {
 			if (!ni_config_parse_teamd(&conf->teamd, child))
 				goto failed;
+		} else
+		if (strcmp(child->name, "socket-loop") == 0) {
+			if (!ni_config_parse_socket_loop(&conf->socket_loop, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "fsm") == 0) {
+			if (!ni_config_parse_fsm(&conf->fsm, child))
+				goto failed;
 		}
 		if (cb != NULL) {
 			if (!cb(appdata, child))
@@ -1540,6 +1561,70 @@ ni_config_parse_rtnl_event(ni_config_rtnl_event_t *conf, xml_node_t *node)
 		if (ni_string_eq(child->name, "message-buffer-length")) {
 			if (ni_parse_uint(child->cdata, &conf->mesg_buff_length, 0))
 				return FALSE;
+		} else
+		if (ni_string_eq(child->name, "coalesce-window")) {
+			if (ni_parse_uint(child->cdata, &conf->coalesce_window, 0))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * route tracking filter config options
+ */
+ni_bool_t
+ni_config_route_filter_ignored(unsigned int table, unsigned int protocol)
+{
+	ni_config_route_filter_t *filter;
+
+	if (!ni_global.config)
+		return FALSE;
+
+	filter = &ni_global.config->route_filter;
+	if (filter->ignore_tables.count &&
+	    ni_uint_array_contains(&filter->ignore_tables, table))
+		return TRUE;
+	if (filter->ignore_protocols.count &&
+	    ni_uint_array_contains(&filter->ignore_protocols, protocol))
+		return TRUE;
+	return FALSE;
+}
+
+static ni_bool_t
+ni_config_parse_route_filter(ni_config_route_filter_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int value;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "ignore-table")) {
+			if (!ni_route_table_name_to_type(child->cdata, &value) ||
+			    !ni_route_is_valid_table(value)) {
+				ni_error("%s: invalid <route-filter><ignore-table>%s</ignore-table></route-filter> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			if (value == RT_TABLE_MAIN) {
+				ni_warn("%s: ignoring routes in the main table is not supported",
+						xml_node_location(child));
+				continue;
+			}
+			if (!ni_uint_array_contains(&conf->ignore_tables, value))
+				ni_uint_array_append(&conf->ignore_tables, value);
+		} else
+		if (ni_string_eq(child->name, "ignore-protocol")) {
+			if (!ni_route_protocol_name_to_type(child->cdata, &value) ||
+			    !ni_route_is_valid_protocol(value)) {
+				ni_error("%s: invalid <route-filter><ignore-protocol>%s</ignore-protocol></route-filter> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			if (!ni_uint_array_contains(&conf->ignore_protocols, value))
+				ni_uint_array_append(&conf->ignore_protocols, value);
 		}
 	}
 	return TRUE;
@@ -1695,6 +1780,90 @@ ni_config_parse_teamd(ni_config_teamd_t *conf, const xml_node_t *node)
 	return TRUE;
 }
 
+/*
+ * socket loop config options
+ */
+static const ni_intmap_t	config_socket_loop_backend_names[] = {
+	{ "epoll",		NI_CONFIG_SOCKET_LOOP_EPOLL	},
+	{ "poll",		NI_CONFIG_SOCKET_LOOP_POLL	},
+	{ NULL,			-1U				}
+};
+
+ni_config_socket_loop_backend_t
+ni_config_socket_loop_backend(void)
+{
+	return ni_global.config ? ni_global.config->socket_loop.backend : NI_CONFIG_SOCKET_LOOP_EPOLL;
+}
+
+ni_bool_t
+ni_config_socket_loop_edge_triggered(void)
+{
+	return ni_global.config ? ni_global.config->socket_loop.edge_triggered : FALSE;
+}
+
+static ni_bool_t
+ni_config_parse_socket_loop(ni_config_socket_loop_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int backend;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "backend")) {
+			if (ni_parse_uint_mapped(child->cdata, config_socket_loop_backend_names, &backend)) {
+				ni_error("%s: invalid <socket-loop><backend>%s</backend></socket-loop> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			conf->backend = backend;
+		} else
+		if (ni_string_eq(child->name, "trigger")) {
+			if (ni_string_eq(child->cdata, "edge")) {
+				conf->edge_triggered = TRUE;
+			} else
+			if (ni_string_eq(child->cdata, "level")) {
+				conf->edge_triggered = FALSE;
+			} else {
+				ni_error("%s: invalid <socket-loop><trigger>%s</trigger></socket-loop> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * client fsm config options
+ */
+unsigned int
+ni_config_fsm_max_async_calls(void)
+{
+	return ni_global.config ? ni_global.config->fsm.max_async_calls : 0;
+}
+
+static ni_bool_t
+ni_config_parse_fsm(ni_config_fsm_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "max-async-calls")) {
+			if (ni_parse_uint(child->cdata, &conf->max_async_calls, 10) < 0) {
+				ni_error("%s: invalid <fsm><max-async-calls>%s</max-async-calls></fsm> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
 /*
  * Extension handling
  */
@@ -29,9 +29,15 @@ struct ni_dbus_client {
 struct ni_dbus_client_object {
 	ni_dbus_client_t *	client;
 	char *			default_interface;
+
+	struct {
+		uint32_t	generation;	/* of last GetManagedObjectsSince */
+		char *		owner;		/* unique name of the server */
+	} managed;
 };
 
 
+static dbus_bool_t	__ni_dbus_object_get_managed_objects_dict(ni_dbus_object_t *, DBusMessageIter *);
 static dbus_bool_t	__ni_dbus_object_get_managed_object_interfaces(ni_dbus_object_t *, DBusMessageIter *);
 static dbus_bool_t	__ni_dbus_object_get_managed_object_properties(ni_dbus_object_t *proxy,
 					const ni_dbus_service_t *service,
@@ -116,6 +122,7 @@ __ni_dbus_client_object_destroy(ni_dbus_object_t *object)
 
 	if ((cob = object->client_object) != NULL) {
 		ni_string_free(&cob->default_interface);
+		ni_string_free(&cob->managed.owner);
 		cob->client = NULL;
 		free(cob);
 		object->client_object= NULL;
@@ -470,6 +477,52 @@ ni_dbus_object_call_async(ni_dbus_object_t *proxy,
 	return rv;
 }
 
+/*
+ * Asynchronous call with variant arguments. The serial of the call
+ * permits the caller to match the reply passed to the callback.
+ */
+int
+ni_dbus_object_call_variant_async(ni_dbus_object_t *proxy,
+			const char *interface_name, const char *method,
+			unsigned int nargs, const ni_dbus_variant_t *args,
+			ni_dbus_async_callback_t *callback, dbus_uint32_t *serial)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_message_t *call = NULL;
+	ni_dbus_client_t *client;
+	int rv;
+
+	if (!proxy || !callback || !(client = ni_dbus_object_get_client(proxy)))
+		return -NI_ERROR_INVALID_ARGS;
+
+	if (interface_name == NULL)
+		interface_name = ni_dbus_object_get_default_interface(proxy);
+	if (interface_name == NULL)
+		return -NI_ERROR_METHOD_NOT_SUPPORTED;
+
+	ni_debug_dbus("%s(%s, if=%s, method=%s)", __func__, proxy->path, interface_name, method);
+	call = dbus_message_new_method_call(client->bus_name, proxy->path, interface_name, method);
+	if (call == NULL) {
+		ni_error("%s: unable to build %s() message", __func__, method);
+		return -NI_ERROR_INVALID_ARGS;
+	}
+
+	if (nargs && !ni_dbus_message_serialize_variants(call, nargs, args, &error)) {
+		ni_dbus_print_error(&error, "%s: unable to serialize %s() arguments", __func__, method);
+		dbus_error_free(&error);
+		dbus_message_unref(call);
+		return -NI_ERROR_CANNOT_MARSHAL;
+	}
+
+	rv = ni_dbus_connection_call_async(client->connection, call,
+			client->call_timeout, callback, proxy);
+	if (rv == 0 && serial)
+		*serial = dbus_message_get_serial(call);
+
+	dbus_message_unref(call);
+	return rv;
+}
+
 /*
  * Use ObjectManager.GetManagedObjects to retrieve (part of)
  * the server's object hierarchy
@@ -480,7 +533,7 @@ ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni
 	ni_dbus_client_t *client;
 	ni_dbus_object_t *objmgr;
 	ni_dbus_message_t *call = NULL, *reply = NULL;
-	DBusMessageIter iter, iter_dict;
+	DBusMessageIter iter;
 	dbus_bool_t rv = FALSE;
 
 	if (!(client = ni_dbus_object_get_client(proxy))) {
@@ -500,8 +553,38 @@ ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni
 		goto out;
 
 	dbus_message_iter_init(reply, &iter);
-	if (!ni_dbus_message_open_dict_read(&iter, &iter_dict))
+	if (!__ni_dbus_object_get_managed_objects_dict(proxy, &iter))
 		goto bad_reply;
+
+	if (purge)
+		__ni_dbus_object_purge_stale(proxy);
+
+	rv = TRUE;
+
+out:
+	if (call)
+		dbus_message_unref(call);
+	if (reply)
+		dbus_message_unref(reply);
+	ni_dbus_object_free(objmgr);
+	return rv;
+
+bad_reply:
+	dbus_set_error(error, DBUS_ERROR_FAILED, "%s: failed to parse reply", __FUNCTION__);
+	goto out;
+}
+
+/*
+ * Create or update the objects in the dict of a GetManagedObjects reply
+ */
+static dbus_bool_t
+__ni_dbus_object_get_managed_objects_dict(ni_dbus_object_t *proxy, DBusMessageIter *iter)
+{
+	DBusMessageIter iter_dict;
+
+	if (!ni_dbus_message_open_dict_read(iter, &iter_dict))
+		return FALSE;
+
 	while (dbus_message_iter_get_arg_type(&iter_dict) == DBUS_TYPE_DICT_ENTRY) {
 		DBusMessageIter iter_dict_entry;
 		ni_dbus_object_t *descendant;
@@ -511,11 +594,11 @@ ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni
 		dbus_message_iter_next(&iter_dict);
 
 		if (dbus_message_iter_get_arg_type(&iter_dict_entry) != DBUS_TYPE_STRING)
-			goto bad_reply;
+			return FALSE;
 		dbus_message_iter_get_basic(&iter_dict_entry, &object_path);
 
 		if (!dbus_message_iter_next(&iter_dict_entry))
-			goto bad_reply;
+			return FALSE;
 
 		descendant = ni_dbus_object_create(proxy, object_path, NULL, NULL);
 
@@ -538,14 +621,119 @@ ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni
 			descendant->class->initialize(descendant);
 
 		if (!__ni_dbus_object_get_managed_object_interfaces(descendant, &iter_dict_entry))
-			goto bad_reply;
+			return FALSE;
 
 		descendant->stale = FALSE;
 	}
 
-	if (purge)
-		__ni_dbus_object_purge_stale(proxy);
+	return TRUE;
+}
+
+/*
+ * Use ObjectManager.GetManagedObjectsSince to retrieve the objects
+ * changed since the last call on this proxy only. Falls back to the
+ * full GetManagedObjects when the server does not support it.
+ */
+dbus_bool_t
+ni_dbus_object_get_managed_objects_since(ni_dbus_object_t *proxy,
+				const ni_string_array_t *services, DBusError *error)
+{
+	ni_dbus_client_object_t *cob = proxy->client_object;
+	ni_dbus_message_t *call = NULL, *reply = NULL;
+	static const char *all[] = { NULL };
+	const char **names = all;
+	unsigned int nnames = 0;
+	ni_dbus_client_t *client;
+	ni_dbus_object_t *objmgr;
+	DBusMessageIter iter, iter_array;
+	dbus_uint32_t since, generation;
+	ni_bool_t missing = FALSE;
+	dbus_bool_t rv = FALSE;
+	const char *sender;
+
+	if (!cob || !(client = ni_dbus_object_get_client(proxy))) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: not a client object", __func__);
+		return FALSE;
+	}
+
+	if (services && services->count) {
+		names = (const char **) services->data;
+		nnames = services->count;
+	}
 
+	objmgr = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class, proxy->path,
+			NI_DBUS_INTERFACE ".ObjectManager",
+			NULL);
+
+	since = cob->managed.generation;
+retry:
+	call = ni_dbus_object_call_new(objmgr, "GetManagedObjectsSince",
+			DBUS_TYPE_UINT32, &since,
+			DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &names, nnames,
+			0);
+	if (call == NULL) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: unable to build call", __func__);
+		goto out;
+	}
+
+	if ((reply = ni_dbus_client_call(client, call, error)) == NULL) {
+		if (!dbus_error_has_name(error, DBUS_ERROR_UNKNOWN_METHOD))
+			goto out;
+
+		ni_debug_dbus("%s: GetManagedObjectsSince not supported, using GetManagedObjects",
+				proxy->path);
+		dbus_error_free(error);
+		rv = ni_dbus_object_get_managed_objects(proxy, error, TRUE);
+		goto out;
+	}
+
+	/* The generation is meaningless to another server instance */
+	sender = dbus_message_get_sender(reply);
+	if (since && !ni_string_eq(sender, cob->managed.owner)) {
+		ni_debug_dbus("%s: server changed, refreshing all objects", proxy->path);
+		goto restart;
+	}
+
+	dbus_message_iter_init(reply, &iter);
+	if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_UINT32)
+		goto bad_reply;
+	dbus_message_iter_get_basic(&iter, &generation);
+
+	__ni_dbus_object_mark_stale(proxy);
+
+	/* The objects changed since our generation ... */
+	if (!dbus_message_iter_next(&iter)
+	 || !__ni_dbus_object_get_managed_objects_dict(proxy, &iter))
+		goto bad_reply;
+
+	/* ... and the paths of all objects the server still has */
+	if (!dbus_message_iter_next(&iter)
+	 || dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY)
+		goto bad_reply;
+	dbus_message_iter_recurse(&iter, &iter_array);
+	while (dbus_message_iter_get_arg_type(&iter_array) == DBUS_TYPE_STRING) {
+		ni_dbus_object_t *object;
+		const char *object_path;
+
+		dbus_message_iter_get_basic(&iter_array, &object_path);
+		dbus_message_iter_next(&iter_array);
+
+		if ((object = ni_dbus_object_lookup(proxy, object_path)))
+			object->stale = FALSE;
+		else
+			missing = TRUE;
+	}
+
+	if (since && missing) {
+		/* we don't have all unchanged objects (any more) */
+		ni_debug_dbus("%s: objects missing, refreshing all objects", proxy->path);
+		goto restart;
+	}
+
+	__ni_dbus_object_purge_stale(proxy);
+
+	cob->managed.generation = generation;
+	ni_string_dup(&cob->managed.owner, sender);
 	rv = TRUE;
 
 out:
@@ -556,11 +744,79 @@ out:
 	ni_dbus_object_free(objmgr);
 	return rv;
 
+restart:
+	dbus_message_unref(call);
+	dbus_message_unref(reply);
+	call = reply = NULL;
+	since = 0;
+	missing = FALSE;
+	goto retry;
+
 bad_reply:
-	dbus_set_error(error, DBUS_ERROR_FAILED, "%s: failed to parse reply", __FUNCTION__);
+	cob->managed.generation = 0;
+	dbus_set_error(error, DBUS_ERROR_FAILED, "%s: failed to parse reply", __func__);
 	goto out;
 }
 
+/*
+ * Use ObjectManager.GetManagedObjectsFiltered to retrieve the objects
+ * matching the filter dict only. Objects not matching the filter are
+ * not purged. Falls back to the full GetManagedObjects when the server
+ * does not support it.
+ */
+dbus_bool_t
+ni_dbus_object_get_managed_objects_filtered(ni_dbus_object_t *proxy,
+				const ni_dbus_variant_t *filter, DBusError *error)
+{
+	ni_dbus_message_t *call = NULL, *reply = NULL;
+	ni_dbus_client_t *client;
+	ni_dbus_object_t *objmgr;
+	DBusMessageIter iter;
+	dbus_bool_t rv = FALSE;
+
+	if (!(client = ni_dbus_object_get_client(proxy))) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: not a client object", __func__);
+		return FALSE;
+	}
+
+	objmgr = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class, proxy->path,
+			NI_DBUS_INTERFACE ".ObjectManager",
+			NULL);
+
+	call = ni_dbus_object_call_new(objmgr, "GetManagedObjectsFiltered", 0);
+	if (call == NULL || !ni_dbus_message_serialize_variants(call, 1, filter, error)) {
+		if (!dbus_error_is_set(error))
+			dbus_set_error(error, DBUS_ERROR_FAILED, "%s: unable to build call", __func__);
+		goto out;
+	}
+
+	if ((reply = ni_dbus_client_call(client, call, error)) == NULL) {
+		if (!dbus_error_has_name(error, DBUS_ERROR_UNKNOWN_METHOD))
+			goto out;
+
+		ni_debug_dbus("%s: GetManagedObjectsFiltered not supported, using GetManagedObjects",
+				proxy->path);
+		dbus_error_free(error);
+		rv = ni_dbus_object_get_managed_objects(proxy, error, TRUE);
+		goto out;
+	}
+
+	dbus_message_iter_init(reply, &iter);
+	if (!__ni_dbus_object_get_managed_objects_dict(proxy, &iter)) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: failed to parse reply", __func__);
+		goto out;
+	}
+	rv = TRUE;
+
+out:
+	if (call)
+		dbus_message_unref(call);
+	if (reply)
+		dbus_message_unref(reply);
+	ni_dbus_object_free(objmgr);
+	return rv;
+}
+
 static dbus_bool_t
 __ni_dbus_object_get_managed_object_interfaces(ni_dbus_object_t *proxy, DBusMessageIter *iter)
 {
@@ -729,7 +985,7 @@ __ni_dbus_object_refresh_properties(ni_dbus_object_t *proxy, const ni_dbus_servi
 		if (!dbus_message_iter_next(&iter_dict_entry))
 			return FALSE;
 
-		if (!ni_dbus_message_iter_get_variant(&iter_dict_entry, &value)) {
+		if (!ni_dbus_message_iter_get_variant_borrowed(&iter_dict_entry, &value)) {
 			ni_debug_dbus("couldn't deserialize property %s.%s",
 					service->name, property_name);
 			continue;
@@ -792,6 +1048,19 @@ ni_dbus_object_refresh_children(ni_dbus_object_t *proxy)
 	return rv;
 }
 
+dbus_bool_t
+ni_dbus_object_refresh_changed_children(ni_dbus_object_t *proxy, const ni_string_array_t *services)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	dbus_bool_t rv;
+
+	rv = ni_dbus_object_get_managed_objects_since(proxy, services, &error);
+	if (!rv)
+		ni_dbus_print_error(&error, "%s.getManagedObjectsSince failed", proxy->path);
+	dbus_error_free(&error);
+	return rv;
+}
+
 /*
  * Use Properties.GetAll to refresh the properties of an object
  */
@@ -15,6 +15,8 @@
 #include "dbus-dict.h"
 #include "debug.h"
 
+static void		ni_dbus_dict_index_free(ni_dbus_variant_t *);
+
 int
 ni_dbus_translate_error(const DBusError *err, const ni_intmap_t *error_map)
 {
@@ -107,7 +109,7 @@ ni_dbus_message_get_args_variants(ni_dbus_message_t *msg, ni_dbus_variant_t *arg
 			iter_p = &iter_val;
 		}
 
-		if (!ni_dbus_message_iter_get_variant_data(iter_p, &argv[argc])) {
+		if (!ni_dbus_message_iter_get_variant_data_borrowed(iter_p, &argv[argc])) {
 			do {
 				ni_dbus_variant_destroy(&argv[argc]);
 			} while (argc--);
@@ -116,8 +118,8 @@ ni_dbus_message_get_args_variants(ni_dbus_message_t *msg, ni_dbus_variant_t *arg
 
 		/* We keep a reference to the dbus message in this variant variable,
 		 * because the caller may decide to free the message (eg in
-		 * ni_dbus_object_call_variant()). However, some strings we use point
-		 * directly into the message; such as the dict keys.
+		 * ni_dbus_object_call_variant()). However, the strings and byte
+		 * arrays we use point directly into the message; as do the dict keys.
 		 */
 		argv[argc].__message = dbus_message_ref(msg);
 		dbus_message_iter_next(&iter);
@@ -172,6 +174,8 @@ ni_dbus_variant_is_string_array(const ni_dbus_variant_t *var)
 static inline void
 __ni_dbus_variant_change_type(ni_dbus_variant_t *var, int new_type)
 {
+	if (var->__borrowed)
+		ni_dbus_variant_destroy(var);
 	if (var->type == new_type)
 		return;
 	if (var->type != DBUS_TYPE_INVALID) {
@@ -580,6 +584,9 @@ __ni_dbus_array_grow(ni_dbus_variant_t *var, size_t element_size, unsigned int g
 	unsigned int max = NI_DBUS_ARRAY_ALLOCATION(var->array.len);
 	unsigned int len = var->array.len;
 
+	if (var->__borrowed)
+		ni_dbus_variant_unborrow(var);
+
 	if (len + grow_by >= max) {
 		void *new_data;
 
@@ -627,6 +634,90 @@ ni_dbus_variant_append_byte_array(ni_dbus_variant_t *var, unsigned char byte)
 	return TRUE;
 }
 
+/*
+ * Borrowed values point into the buffer of the message they have been
+ * decoded from, and are only valid as long as the message is. They are
+ * not freed by ni_dbus_variant_destroy, and the first attempt to modify
+ * a borrowed value turns it into a private copy.
+ */
+void
+ni_dbus_variant_borrow_string(ni_dbus_variant_t *var, int type, const char *value)
+{
+	ni_dbus_variant_destroy(var);
+	var->type = type;
+	var->string_value = (char *) value;
+	var->__borrowed = TRUE;
+}
+
+void
+ni_dbus_variant_borrow_byte_array(ni_dbus_variant_t *var,
+				const unsigned char *data, unsigned int len)
+{
+	ni_dbus_variant_destroy(var);
+	__ni_dbus_init_array(var, DBUS_TYPE_BYTE);
+	var->byte_array_value = (unsigned char *) data;
+	var->array.len = len;
+	var->__borrowed = TRUE;
+}
+
+dbus_bool_t
+ni_dbus_variant_borrow_string_array_element(ni_dbus_variant_t *var, const char *string)
+{
+	unsigned int len = var->array.len;
+
+	if (!__ni_dbus_is_array(var, DBUS_TYPE_STRING_AS_STRING)
+	 && !__ni_dbus_is_array(var, DBUS_TYPE_OBJECT_PATH_AS_STRING))
+		return FALSE;
+	if (len && !var->__borrowed)
+		return FALSE;
+
+	/* Clear the flag so the grow only reallocs the pointer array
+	 * instead of copying the borrowed strings */
+	var->__borrowed = FALSE;
+	__ni_dbus_array_grow(var, sizeof(char *), 1);
+	var->string_array_value[len] = (char *) (string ?: "");
+	var->array.len++;
+	var->__borrowed = TRUE;
+
+	return TRUE;
+}
+
+void
+ni_dbus_variant_unborrow(ni_dbus_variant_t *var)
+{
+	unsigned char *data;
+	unsigned int i;
+
+	if (!var->__borrowed)
+		return;
+	var->__borrowed = FALSE;
+
+	switch (var->type) {
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		var->string_value = xstrdup(var->string_value);
+		break;
+
+	case DBUS_TYPE_ARRAY:
+		switch (var->array.element_type) {
+		case DBUS_TYPE_BYTE:
+			data = var->byte_array_value;
+			var->byte_array_value = NULL;
+			if (var->array.len) {
+				var->byte_array_value = xcalloc(NI_DBUS_ARRAY_ALLOCATION(var->array.len), 1);
+				memcpy(var->byte_array_value, data, var->array.len);
+			}
+			break;
+		case DBUS_TYPE_STRING:
+		case DBUS_TYPE_OBJECT_PATH:
+			for (i = 0; i < var->array.len; ++i)
+				var->string_array_value[i] = xstrdup(var->string_array_value[i]);
+			break;
+		}
+		break;
+	}
+}
+
 /*
  * A UUID is encoded as a fixed length array of bytes
  */
@@ -744,18 +835,20 @@ ni_dbus_variant_destroy(ni_dbus_variant_t *var)
 	}
 
 	if (var->type == DBUS_TYPE_STRING
-	 || var->type == DBUS_TYPE_OBJECT_PATH)
-		ni_string_free(&var->string_value);
-	else if (var->type == DBUS_TYPE_ARRAY) {
+	 || var->type == DBUS_TYPE_OBJECT_PATH) {
+		if (!var->__borrowed)
+			ni_string_free(&var->string_value);
+	} else if (var->type == DBUS_TYPE_ARRAY) {
 		unsigned int i;
 
 		switch (var->array.element_type) {
 		case DBUS_TYPE_BYTE:
-			free(var->byte_array_value);
+			if (!var->__borrowed)
+				free(var->byte_array_value);
 			break;
 		case DBUS_TYPE_STRING:
 		case DBUS_TYPE_OBJECT_PATH:
-			for (i = 0; i < var->array.len; ++i)
+			for (i = 0; !var->__borrowed && i < var->array.len; ++i)
 				free(var->string_array_value[i]);
 			free(var->string_array_value);
 			break;
@@ -763,6 +856,7 @@ ni_dbus_variant_destroy(ni_dbus_variant_t *var)
 			for (i = 0; i < var->array.len; ++i)
 				ni_dbus_variant_destroy(&var->dict_array_value[i].datum);
 			free(var->dict_array_value);
+			ni_dbus_dict_index_free(var);
 			break;
 		case DBUS_TYPE_INVALID:
 			if (var->array.element_signature == NULL)
@@ -1333,15 +1427,125 @@ ni_dbus_dict_add_byte_array(ni_dbus_variant_t *dict, const char *key,
 	return TRUE;
 }
 
+/*
+ * The property deserializers look up each key they know in the dict.
+ * Dicts with more than a few entries get a lazily built hash index of
+ * the first entry for each key, making these lookups O(1) instead of
+ * a scan of all entries each.
+ */
+#define NI_DBUS_DICT_INDEX_MIN_LEN	16
+
+struct ni_dbus_dict_index {
+	unsigned int		count;		/* number of entries indexed */
+	unsigned int		size;		/* number of slots, power of 2 */
+	unsigned int *		slots;		/* entry index + 1, 0 when empty */
+};
+
+static unsigned int
+ni_dbus_dict_index_hash(const char *key)
+{
+	unsigned int hash = 5381;
+
+	while (*key)
+		hash = ((hash << 5) + hash) + (unsigned char) *key++;
+	return hash;
+}
+
+static void
+ni_dbus_dict_index_free(ni_dbus_variant_t *dict)
+{
+	if (dict->__dict_index) {
+		free(dict->__dict_index->slots);
+		free(dict->__dict_index);
+		dict->__dict_index = NULL;
+	}
+}
+
+static void
+ni_dbus_dict_index_insert(const ni_dbus_variant_t *dict, ni_dbus_dict_index_t *index, unsigned int pos)
+{
+	const char *key = dict->dict_array_value[pos].key;
+	unsigned int slot, *sp;
+
+	if (key == NULL)
+		return;
+
+	slot = ni_dbus_dict_index_hash(key) & (index->size - 1);
+	while (*(sp = &index->slots[slot])) {
+		/* keep the first entry with this key */
+		if (!strcmp(dict->dict_array_value[*sp - 1].key, key))
+			return;
+		slot = (slot + 1) & (index->size - 1);
+	}
+	*sp = pos + 1;
+}
+
+/*
+ * Entries are added at the end only; index the new ones and rebuild
+ * the index when it gets too full or entries have been deleted.
+ */
+static ni_dbus_dict_index_t *
+ni_dbus_dict_index(const ni_dbus_variant_t *dict)
+{
+	/* the index is a cache only -- update it on const dicts as well */
+	ni_dbus_variant_t *var = (ni_dbus_variant_t *) dict;
+	ni_dbus_dict_index_t *index = var->__dict_index;
+	unsigned int size;
+
+	if (dict->array.len < NI_DBUS_DICT_INDEX_MIN_LEN) {
+		ni_dbus_dict_index_free(var);
+		return NULL;
+	}
+
+	if (index && (index->count > dict->array.len || index->size < 2 * dict->array.len))
+		ni_dbus_dict_index_free(var);
+
+	if (!(index = var->__dict_index)) {
+		for (size = 2 * NI_DBUS_DICT_INDEX_MIN_LEN; size < 4 * dict->array.len; size <<= 1)
+			;
+		index = xcalloc(1, sizeof(*index));
+		index->slots = xcalloc(size, sizeof(index->slots[0]));
+		index->size = size;
+		var->__dict_index = index;
+	}
+
+	for (; index->count < dict->array.len; index->count++)
+		ni_dbus_dict_index_insert(dict, index, index->count);
+
+	return index;
+}
+
+static ni_dbus_dict_entry_t *
+ni_dbus_dict_index_lookup(const ni_dbus_variant_t *dict, const ni_dbus_dict_index_t *index, const char *key)
+{
+	ni_dbus_dict_entry_t *entry;
+	unsigned int slot, pos;
+
+	slot = ni_dbus_dict_index_hash(key) & (index->size - 1);
+	while ((pos = index->slots[slot])) {
+		entry = &dict->dict_array_value[pos - 1];
+		if (!strcmp(entry->key, key))
+			return entry;
+		slot = (slot + 1) & (index->size - 1);
+	}
+	return NULL;
+}
+
 ni_dbus_variant_t *
 ni_dbus_dict_get(const ni_dbus_variant_t *dict, const char *key)
 {
+	ni_dbus_dict_index_t *index;
 	ni_dbus_dict_entry_t *entry;
 	unsigned int i;
 
-	if (!ni_dbus_variant_is_dict(dict))
+	if (!ni_dbus_variant_is_dict(dict) || !key)
 		return NULL;
 
+	if ((index = ni_dbus_dict_index(dict))) {
+		entry = ni_dbus_dict_index_lookup(dict, index, key);
+		return entry ? &entry->datum : NULL;
+	}
+
 	for (i = 0; i < dict->array.len; ++i) {
 		entry = &dict->dict_array_value[i];
 		if (entry->key && !strcmp(entry->key, key))
@@ -1527,6 +1731,7 @@ ni_dbus_dict_delete_entry(ni_dbus_variant_t *dict, const char *key)
 	for (i = 0; i < dict->array.len; ++i, ++entry) {
 		if (entry->key && !strcmp(entry->key, key)) {
 			ni_dbus_variant_destroy(&entry->datum);
+			ni_dbus_dict_index_free(dict);
 			dict->array.len--;
 
 			/* Shift down all entries */
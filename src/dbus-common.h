@@ -31,9 +31,21 @@ extern dbus_bool_t		ni_dbus_message_iter_append_variant(DBusMessageIter *iter,
 					const ni_dbus_variant_t *variant);
 extern dbus_bool_t		ni_dbus_message_iter_get_variant(DBusMessageIter *iter,
 					ni_dbus_variant_t *variant);
+extern dbus_bool_t		ni_dbus_message_iter_get_variant_data_borrowed(DBusMessageIter *iter,
+					ni_dbus_variant_t *variant);
+extern dbus_bool_t		ni_dbus_message_iter_get_variant_borrowed(DBusMessageIter *iter,
+					ni_dbus_variant_t *variant);
 extern dbus_bool_t		ni_dbus_message_iter_append_byte_array(DBusMessageIter *iter,
 						const unsigned char *value, unsigned int len);
 
+extern void			ni_dbus_variant_borrow_string(ni_dbus_variant_t *, int,
+					const char *);
+extern void			ni_dbus_variant_borrow_byte_array(ni_dbus_variant_t *,
+					const unsigned char *, unsigned int);
+extern dbus_bool_t		ni_dbus_variant_borrow_string_array_element(ni_dbus_variant_t *,
+					const char *);
+extern void			ni_dbus_variant_unborrow(ni_dbus_variant_t *);
+
 extern const ni_dbus_property_t *__ni_dbus_service_get_property(const ni_dbus_property_t *, const char *);
 
 
@@ -18,6 +18,35 @@
 
 static dbus_bool_t	ni_dbus_message_iter_get_array(DBusMessageIter *, ni_dbus_variant_t *);
 
+/*
+ * When non-zero, strings and byte arrays are not copied while decoding
+ * a message, but borrowed from the message buffer.
+ */
+static unsigned int	ni_dbus_message_borrow;
+
+/*
+ * Count how much data decoding had to copy, and how much it could borrow
+ */
+static ni_dbus_decode_stats_t	ni_dbus_message_stats;
+
+static inline void
+__ni_dbus_message_count_data(size_t len)
+{
+	if (ni_dbus_message_borrow) {
+		ni_dbus_message_stats.borrowed++;
+		ni_dbus_message_stats.borrowed_bytes += len;
+	} else {
+		ni_dbus_message_stats.copied++;
+		ni_dbus_message_stats.copied_bytes += len;
+	}
+}
+
+const ni_dbus_decode_stats_t *
+ni_dbus_message_decode_stats(void)
+{
+	return &ni_dbus_message_stats;
+}
+
 dbus_bool_t
 ni_dbus_message_iter_append_byte_array(DBusMessageIter *iter,
 				const unsigned char *value, unsigned int len)
@@ -298,15 +327,19 @@ ni_dbus_message_iter_append_variant(DBusMessageIter *iter, const ni_dbus_variant
 dbus_bool_t
 ni_dbus_message_iter_get_byte_array(DBusMessageIter *iter, ni_dbus_variant_t *variant)
 {
-	ni_dbus_variant_init_byte_array(variant);
+	const unsigned char *data = NULL;
+	int len = 0;
 
-	while (dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_BYTE) {
-		unsigned char byte;
+	if (dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_BYTE)
+		dbus_message_iter_get_fixed_array(iter, &data, &len);
 
-		dbus_message_iter_get_basic(iter, &byte);
-		ni_dbus_variant_append_byte_array(variant, byte);
-		dbus_message_iter_next(iter);
-	}
+	__ni_dbus_message_count_data(len);
+	if (ni_dbus_message_borrow)
+		ni_dbus_variant_borrow_byte_array(variant, data, len);
+	else if (len > 0)
+		ni_dbus_variant_set_byte_array(variant, data, len);
+	else
+		ni_dbus_variant_init_byte_array(variant);
 
 	return TRUE;
 }
@@ -319,7 +352,11 @@ ni_dbus_message_iter_get_string_array(DBusMessageIter *iter, ni_dbus_variant_t *
 		const char *value;
 
 		dbus_message_iter_get_basic(iter, &value);
-		ni_dbus_variant_append_string_array(variant, value);
+		__ni_dbus_message_count_data(ni_string_len(value) + 1);
+		if (ni_dbus_message_borrow)
+			ni_dbus_variant_borrow_string_array_element(variant, value);
+		else
+			ni_dbus_variant_append_string_array(variant, value);
 		dbus_message_iter_next(iter);
 	}
 
@@ -334,7 +371,11 @@ ni_dbus_message_iter_get_object_path_array(DBusMessageIter *iter, ni_dbus_varian
 		const char *value;
 
 		dbus_message_iter_get_basic(iter, &value);
-		ni_dbus_variant_append_object_path_array(variant, value);
+		__ni_dbus_message_count_data(ni_string_len(value) + 1);
+		if (ni_dbus_message_borrow)
+			ni_dbus_variant_borrow_string_array_element(variant, value);
+		else
+			ni_dbus_variant_append_object_path_array(variant, value);
 		dbus_message_iter_next(iter);
 	}
 
@@ -480,6 +521,7 @@ ni_dbus_message_iter_get_variant_data(DBusMessageIter *iter, ni_dbus_variant_t *
 
 	ni_dbus_variant_destroy(variant);
 	variant->type = dbus_message_iter_get_arg_type(iter);
+	ni_dbus_message_stats.variants++;
 
 	value = ni_dbus_variant_datum_ptr(variant);
 	if (value != NULL) {
@@ -487,8 +529,13 @@ ni_dbus_message_iter_get_variant_data(DBusMessageIter *iter, ni_dbus_variant_t *
 		dbus_message_iter_get_basic(iter, value);
 
 		if (variant->type == DBUS_TYPE_STRING
-		 || variant->type == DBUS_TYPE_OBJECT_PATH)
-			variant->string_value = xstrdup(variant->string_value);
+		 || variant->type == DBUS_TYPE_OBJECT_PATH) {
+			__ni_dbus_message_count_data(ni_string_len(variant->string_value) + 1);
+			if (ni_dbus_message_borrow)
+				variant->__borrowed = TRUE;
+			else
+				variant->string_value = xstrdup(variant->string_value);
+		}
 	} else if (variant->type == DBUS_TYPE_ARRAY) {
 		if (!ni_dbus_message_iter_get_array(iter, variant))
 			return FALSE;
@@ -520,6 +567,33 @@ ni_dbus_message_iter_get_variant(DBusMessageIter *iter, ni_dbus_variant_t *varia
 	return ni_dbus_message_iter_get_variant_data(&iter_val, variant);
 }
 
+/*
+ * Same as above, but let strings and byte arrays point into the message
+ * instead of copying them. The caller has to make sure the message lives
+ * at least as long as the variant (which is also needed for dict keys).
+ */
+dbus_bool_t
+ni_dbus_message_iter_get_variant_data_borrowed(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+{
+	dbus_bool_t rv;
+
+	ni_dbus_message_borrow++;
+	rv = ni_dbus_message_iter_get_variant_data(iter, variant);
+	ni_dbus_message_borrow--;
+	return rv;
+}
+
+dbus_bool_t
+ni_dbus_message_iter_get_variant_borrowed(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+{
+	dbus_bool_t rv;
+
+	ni_dbus_message_borrow++;
+	rv = ni_dbus_message_iter_get_variant(iter, variant);
+	ni_dbus_message_borrow--;
+	return rv;
+}
+
 /*
  * Append one or more variants to a dbus message
  */
@@ -34,11 +34,13 @@ extern dbus_bool_t	ni_objectmodel_netif_list_refresh(ni_dbus_object_t *);
 static void		ni_objectmodel_register_netif_factory_service(ni_dbus_service_t *);
 static void		ni_objectmodel_netif_initialize(ni_dbus_object_t *object);
 static void		ni_objectmodel_netif_destroy(ni_dbus_object_t *object);
+static ni_bool_t	ni_objectmodel_netif_match(const ni_dbus_object_t *, const ni_dbus_variant_t *);
 
 const ni_dbus_class_t		ni_objectmodel_netif_class = {
 	.name		= NI_OBJECTMODEL_NETIF_CLASS,
 	.initialize	= ni_objectmodel_netif_initialize,
 	.destroy	= ni_objectmodel_netif_destroy,
+	.match		= ni_objectmodel_netif_match,
 };
 static ni_dbus_class_t		ni_objectmodel_ifreq_class = {
 	.name		= NI_OBJECTMODEL_NETIF_REQUEST_CLASS,
@@ -1360,6 +1362,39 @@ ni_objectmodel_netif_destroy(ni_dbus_object_t *object)
 	ni_netdev_put(ifp);
 }
 
+/*
+ * Match the interface against the "name" and "ifindex" entries of
+ * a GetManagedObjectsFiltered filter dict; without any, all match.
+ */
+static ni_bool_t
+ni_objectmodel_netif_match(const ni_dbus_object_t *object, const ni_dbus_variant_t *filter)
+{
+	const ni_dbus_variant_t *var;
+	ni_bool_t restricted = FALSE;
+	const char *name;
+	uint32_t ifindex;
+	ni_netdev_t *dev;
+
+	if (!(dev = ni_objectmodel_unwrap_netif(object, NULL)))
+		return FALSE;
+
+	var = NULL;
+	while ((var = ni_dbus_dict_get_next(filter, "name", var))) {
+		restricted = TRUE;
+		if (ni_dbus_variant_get_string(var, &name) && ni_string_eq(dev->name, name))
+			return TRUE;
+	}
+
+	var = NULL;
+	while ((var = ni_dbus_dict_get_next(filter, "ifindex", var))) {
+		restricted = TRUE;
+		if (ni_dbus_variant_get_uint32(var, &ifindex) && dev->link.ifindex == ifindex)
+			return TRUE;
+	}
+
+	return !restricted;
+}
+
 static ni_dbus_method_t		ni_objectmodel_netif_methods[] = {
 	{ "linkUp",		"a{sv}",	.handler = ni_objectmodel_netif_link_up },
 	{ "linkDown",		"",		.handler = ni_objectmodel_netif_link_down },
@@ -20,6 +20,7 @@
 
 struct ni_dbus_server_object {
 	ni_dbus_server_t *	server;			/* back pointer at server */
+	unsigned int		generation;		/* server generation of last change */
 };
 
 static const ni_dbus_class_t	dbus_root_object_class = {
@@ -29,8 +30,19 @@ static const ni_dbus_class_t	dbus_root_object_class = {
 struct ni_dbus_server {
 	ni_dbus_connection_t *	connection;
 	ni_dbus_object_t *	root_object;
+	unsigned int		generation;		/* counts object changes */
 };
 
+typedef struct ni_dbus_object_manager_filter {
+	uint32_t		since;			/* changed after generation */
+	ni_string_array_t	services;		/* service names or all */
+	ni_dbus_variant_t *	paths;			/* collects all object paths */
+
+	const ni_dbus_object_t *root;			/* object called, always matches */
+	const char *		class_name;		/* objects of this class only */
+	const ni_dbus_variant_t *match;			/* class specific match dict */
+} ni_dbus_object_manager_filter_t;
+
 static dbus_bool_t		ni_dbus_object_register_object_manager(ni_dbus_object_t *);
 static dbus_bool_t		ni_dbus_object_register_introspectable_interface(ni_dbus_object_t *);
 static const char *		__ni_dbus_server_root_path(const char *);
@@ -106,6 +118,7 @@ __ni_dbus_server_object_init(ni_dbus_object_t *object, ni_dbus_server_t *server)
 
 		object->server_object = calloc(1, sizeof(ni_dbus_server_object_t));
 		object->server_object->server = server;
+		ni_dbus_server_object_modified(object);
 
 		if (object->path) {
 			ni_dbus_connection_register_object(server->connection, object);
@@ -145,6 +158,9 @@ ni_dbus_server_send_signal(ni_dbus_server_t *server, ni_dbus_object_t *object,
 	if (svc && !(method = ni_dbus_service_get_signal(svc, signal_name)))
 		ni_warn("%s: unknown signal %s", __func__, signal_name);
 
+	/* Signals announce a change of the object state */
+	ni_dbus_server_object_modified(object);
+
 	msg = dbus_message_new_signal(object->path, interface, signal_name);
 	if (msg == NULL) {
 		ni_error("%s: unable to build %s() signal message", __func__, signal_name);
@@ -166,6 +182,24 @@ out:
 	return rv;
 }
 
+/*
+ * Record a change of the object properties in the object generation,
+ * so GetManagedObjectsSince returns the object to the clients again.
+ */
+void
+ni_dbus_server_object_modified(ni_dbus_object_t *object)
+{
+	ni_dbus_server_object_t *sob = object ? object->server_object : NULL;
+
+	if (!sob || !sob->server)
+		return;
+
+	/* generation 0 requests all objects; skip it on wrap around */
+	if (++sob->server->generation == 0)
+		sob->server->generation = 1;
+	sob->generation = sob->server->generation;
+}
+
 /*
  * When creating an object as a child of a server side object, inherit
  * its server handle.
@@ -217,6 +251,7 @@ static const ni_dbus_service_t __ni_dbus_object_manager_interface;
 static const ni_dbus_service_t __ni_dbus_object_properties_interface;
 static const ni_dbus_service_t __ni_dbus_object_introspectable_interface;
 static dbus_bool_t		__ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *,
+					const ni_dbus_object_manager_filter_t *,
 					ni_dbus_variant_t *dict, DBusError *);
 
 dbus_bool_t
@@ -270,16 +305,117 @@ __ni_dbus_object_manager_get_managed_objects(ni_dbus_object_t *object,
 	NI_TRACE_ENTER_ARGS("path=%s, method=%s", object->path, method->name);
 
 	ni_dbus_variant_init_dict(&obj_dict);
-	rv = __ni_dbus_object_manager_enumerate_object(object, &obj_dict, error);
+	rv = __ni_dbus_object_manager_enumerate_object(object, NULL, &obj_dict, error);
+	if (rv)
+		rv = ni_dbus_message_serialize_variants(reply, 1, &obj_dict, error);
+	ni_dbus_variant_destroy(&obj_dict);
+
+	return rv;
+}
+
+/*
+ * GetManagedObjectsSince(generation, services) returns the current server
+ * generation, the objects changed after the given generation restricted
+ * to the given services (all when empty) and the paths of all objects,
+ * permitting the client to purge the deleted objects.
+ */
+static dbus_bool_t
+__ni_dbus_object_manager_get_managed_objects_since(ni_dbus_object_t *object,
+		const ni_dbus_method_t *method,
+		unsigned int argc, const ni_dbus_variant_t *argv,
+		ni_dbus_message_t *reply,
+		DBusError *error)
+{
+	ni_dbus_server_t *server = ni_dbus_object_get_server(object);
+	ni_dbus_object_manager_filter_t filter;
+	ni_dbus_variant_t result[3];
+	unsigned int i;
+	int rv = TRUE;
+
+	NI_TRACE_ENTER_ARGS("path=%s, method=%s", object->path, method->name);
+
+	memset(&filter, 0, sizeof(filter));
+	if (argc != 2 || !server
+	 || !ni_dbus_variant_get_uint32(&argv[0], &filter.since)
+	 || !ni_dbus_variant_is_string_array(&argv[1])) {
+		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
+				"%s: bad arguments in call to %s", object->path, method->name);
+		return FALSE;
+	}
+	filter.services.count = argv[1].array.len;
+	filter.services.data = argv[1].string_array_value;
+
+	/* a generation unknown to us, e.g. from before a restart */
+	if (filter.since > server->generation)
+		filter.since = 0;
+
+	memset(result, 0, sizeof(result));
+	ni_dbus_variant_init_dict(&result[1]);
+	ni_dbus_variant_init_string_array(&result[2]);
+	filter.paths = &result[2];
+
+	/* objects changed while enumerating are returned again next time */
+	ni_dbus_variant_set_uint32(&result[0], server->generation);
+	rv = __ni_dbus_object_manager_enumerate_object(object, &filter, &result[1], error);
+	if (rv)
+		rv = ni_dbus_message_serialize_variants(reply, 3, result, error);
+
+	for (i = 0; i < 3; ++i)
+		ni_dbus_variant_destroy(&result[i]);
+	return rv;
+}
+
+/*
+ * GetManagedObjectsFiltered(filter) returns the objects matching the
+ * filter dict: the "class" name of the objects, the "service" names to
+ * return the properties of and class specific entries, e.g. the "name"
+ * and "ifindex" of network interfaces. Objects not matching the filter
+ * are omitted with their children.
+ */
+static dbus_bool_t
+__ni_dbus_object_manager_get_managed_objects_filtered(ni_dbus_object_t *object,
+		const ni_dbus_method_t *method,
+		unsigned int argc, const ni_dbus_variant_t *argv,
+		ni_dbus_message_t *reply,
+		DBusError *error)
+{
+	ni_dbus_variant_t obj_dict = NI_DBUS_VARIANT_INIT;
+	ni_dbus_object_manager_filter_t filter;
+	const ni_dbus_variant_t *var = NULL;
+	const char *name;
+	int rv = TRUE;
+
+	NI_TRACE_ENTER_ARGS("path=%s, method=%s", object->path, method->name);
+
+	if (argc != 1 || !ni_dbus_variant_is_dict(&argv[0])) {
+		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
+				"%s: bad arguments in call to %s", object->path, method->name);
+		return FALSE;
+	}
+
+	memset(&filter, 0, sizeof(filter));
+	filter.root = object;
+	filter.match = &argv[0];
+	ni_dbus_dict_get_string(&argv[0], "class", &filter.class_name);
+	while ((var = ni_dbus_dict_get_next(&argv[0], "service", var))) {
+		if (ni_dbus_variant_get_string(var, &name))
+			ni_string_array_append(&filter.services, name);
+	}
+
+	ni_dbus_variant_init_dict(&obj_dict);
+	rv = __ni_dbus_object_manager_enumerate_object(object, &filter, &obj_dict, error);
 	if (rv)
 		rv = ni_dbus_message_serialize_variants(reply, 1, &obj_dict, error);
 	ni_dbus_variant_destroy(&obj_dict);
+	ni_string_array_destroy(&filter.services);
 
 	return rv;
 }
 
 static ni_dbus_method_t	__ni_dbus_object_manager_methods[] = {
 	{ "GetManagedObjects",	NULL,	.handler = __ni_dbus_object_manager_get_managed_objects },
+	{ "GetManagedObjectsSince", "uas", .handler = __ni_dbus_object_manager_get_managed_objects_since },
+	{ "GetManagedObjectsFiltered", "a{sv}", .handler = __ni_dbus_object_manager_get_managed_objects_filtered },
 	{ NULL }
 };
 
@@ -505,20 +641,80 @@ static const ni_dbus_service_t __ni_dbus_object_introspectable_interface = {
 	.methods = __ni_dbus_object_introspectable_methods,
 };
 
+static ni_bool_t
+__ni_dbus_object_manager_match_object(const ni_dbus_object_t *object,
+				const ni_dbus_object_manager_filter_t *filter)
+{
+	const ni_dbus_class_t *class;
+
+	if (!filter || object == filter->root)
+		return TRUE;
+
+	if (filter->class_name) {
+		for (class = object->class; class; class = class->superclass) {
+			if (ni_string_eq(class->name, filter->class_name))
+				break;
+		}
+		if (class == NULL)
+			return FALSE;
+	}
+
+	if (filter->match) {
+		for (class = object->class; class; class = class->superclass) {
+			if (class->match)
+				return class->match(object, filter->match);
+		}
+	}
+	return TRUE;
+}
+
+static ni_bool_t
+__ni_dbus_object_manager_filter_object(const ni_dbus_object_t *object,
+				const ni_dbus_object_manager_filter_t *filter)
+{
+	if (!filter || !filter->since)
+		return TRUE;
+
+	return object->server_object && object->server_object->generation > filter->since;
+}
+
+static ni_bool_t
+__ni_dbus_object_manager_filter_service(const ni_dbus_service_t *service,
+				const ni_dbus_object_manager_filter_t *filter)
+{
+	if (!filter || !filter->services.count)
+		return TRUE;
+
+	return ni_string_array_index(&filter->services, service->name) >= 0;
+}
+
 dbus_bool_t
-__ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *object, ni_dbus_variant_t *obj_dict, DBusError *error)
+__ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *object,
+				const ni_dbus_object_manager_filter_t *filter,
+				ni_dbus_variant_t *obj_dict, DBusError *error)
 {
 	ni_dbus_object_t *child;
 	int rv = TRUE;
 
-	if (object->interfaces) {
+	if (!__ni_dbus_object_manager_match_object(object, filter))
+		return TRUE;
+
+	if (object->interfaces && filter && filter->paths)
+		ni_dbus_variant_append_string_array(filter->paths, object->path);
+
+	if (object->interfaces && __ni_dbus_object_manager_filter_object(object, filter)) {
 		ni_dbus_variant_t *ifdict = ni_dbus_dict_add(obj_dict, object->path);
 		const ni_dbus_service_t *service;
 		unsigned int i;
 
 		ni_dbus_variant_init_dict(ifdict);
 		for (i = 0; rv && (service = object->interfaces[i]) != NULL; ++i) {
-			ni_dbus_variant_t *propdict = ni_dbus_dict_add(ifdict, service->name);
+			ni_dbus_variant_t *propdict;
+
+			if (!__ni_dbus_object_manager_filter_service(service, filter))
+				continue;
+
+			propdict = ni_dbus_dict_add(ifdict, service->name);
 
 			ni_dbus_variant_init_dict(propdict);
 			rv = ni_dbus_object_get_properties_as_dict(object, service, propdict, error);
@@ -537,7 +733,7 @@ __ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *object, ni_dbus_vari
 			continue;
 		}
 
-		rv = __ni_dbus_object_manager_enumerate_object(child, obj_dict, error);
+		rv = __ni_dbus_object_manager_enumerate_object(child, filter, obj_dict, error);
 	}
 
 	return rv;
@@ -629,6 +825,11 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 			}
 		}
 
+		/* Calls other than queries may change the object */
+		if (svc != &__ni_dbus_object_manager_interface
+		 && svc != &__ni_dbus_object_introspectable_interface)
+			ni_dbus_server_object_modified(object);
+
 		/* If the object has a refresh function, call it now */
 		if (object->class && object->class->refresh
 		 && !object->class->refresh(object)) {
@@ -48,6 +48,8 @@ static dbus_bool_t	ni_dbus_deserialize_xml_struct(const ni_dbus_variant_t *, con
 static dbus_bool_t	ni_dbus_deserialize_xml_union(const ni_dbus_variant_t *, const ni_xs_type_t *, xml_node_t *);
 static dbus_bool_t	ni_dbus_deserialize_xml_array(const ni_dbus_variant_t *, const ni_xs_type_t *, xml_node_t *);
 static dbus_bool_t	ni_dbus_deserialize_xml_dict(const ni_dbus_variant_t *, const ni_xs_type_t *, xml_node_t *);
+static dbus_bool_t	ni_dbus_deserialize_xml_iter(DBusMessageIter *, const ni_xs_type_t *, xml_node_t *);
+static dbus_bool_t	ni_dbus_deserialize_xml_dict_iter(DBusMessageIter *, const ni_xs_type_t *, xml_node_t *);
 static char *		__ni_xs_type_to_dbus_signature(const ni_xs_type_t *, char *, size_t);
 static char *		ni_xs_type_to_dbus_signature(const ni_xs_type_t *);
 static ni_xs_service_t *ni_dbus_xml_get_service_schema(const ni_xs_scope_t *, const char *);
@@ -356,6 +358,44 @@ ni_dbus_xml_deserialize_properties(ni_xs_scope_t *schema, const char *interface_
 	return node;
 }
 
+/*
+ * Same as above, but build the xml straight from the a{sv} properties
+ * dict in a dbus message, without decoding it into variants first.
+ */
+xml_node_t *
+ni_dbus_xml_deserialize_properties_iter(ni_xs_scope_t *schema, const char *interface_name, DBusMessageIter *iter, xml_node_t *parent)
+{
+	ni_xs_service_t *service;
+	DBusMessageIter iter_dict;
+	xml_node_t *node;
+	ni_xs_type_t *type;
+
+	if (dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_ARRAY
+	 && dbus_message_iter_get_element_type(iter) == DBUS_TYPE_DICT_ENTRY) {
+		dbus_message_iter_recurse(iter, &iter_dict);
+		if (dbus_message_iter_get_arg_type(&iter_dict) == DBUS_TYPE_INVALID)
+			return NULL;
+	}
+
+	if (!(service = ni_dbus_xml_get_service_schema(schema, interface_name))) {
+		ni_error("cannot represent %s properties - no schema definition", interface_name);
+		return NULL;
+	}
+
+	if (!(type = ni_dbus_xml_get_properties_schema(schema, service))) {
+		ni_error("no type named <properties> for interface %s", interface_name);
+		return NULL;
+	}
+
+	node = xml_node_new(service->name, parent);
+	if (!ni_dbus_deserialize_xml_iter(iter, type, node)) {
+		ni_error("failed to build xml for %s properties", interface_name);
+		return NULL;
+	}
+
+	return node;
+}
+
 int
 ni_dbus_xml_serialize_properties(ni_xs_scope_t *schema, ni_dbus_variant_t *result, xml_node_t *node)
 {
@@ -1214,6 +1254,100 @@ ni_dbus_deserialize_xml_dict(const ni_dbus_variant_t *var, const ni_xs_type_t *t
 	return TRUE;
 }
 
+/*
+ * Create XML from a dbus message iterator.
+ * Dicts are walked in place, and scalars are read into a variant on the
+ * stack which borrows strings from the message. Anything else is decoded
+ * into a (borrowing) variant first.
+ */
+static dbus_bool_t
+ni_dbus_deserialize_xml_iter(DBusMessageIter *iter, const ni_xs_type_t *type, xml_node_t *node)
+{
+	ni_dbus_variant_t var = NI_DBUS_VARIANT_INIT;
+	DBusMessageIter iter_val;
+	dbus_bool_t rv;
+	void *value;
+	int arg_type;
+
+	arg_type = dbus_message_iter_get_arg_type(iter);
+	if (arg_type == DBUS_TYPE_VARIANT) {
+		dbus_message_iter_recurse(iter, &iter_val);
+		return ni_dbus_deserialize_xml_iter(&iter_val, type, node);
+	}
+
+	switch (type->class) {
+	case NI_XS_TYPE_VOID:
+		return TRUE;
+
+	case NI_XS_TYPE_SCALAR:
+		var.type = arg_type;
+		if (!(value = ni_dbus_variant_datum_ptr(&var))) {
+			var.type = DBUS_TYPE_INVALID;
+			break;
+		}
+		dbus_message_iter_get_basic(iter, value);
+		return ni_dbus_deserialize_xml_scalar(&var, type, node);
+
+	case NI_XS_TYPE_DICT:
+		if (arg_type != DBUS_TYPE_ARRAY
+		 || dbus_message_iter_get_element_type(iter) != DBUS_TYPE_DICT_ENTRY)
+			break;
+		return ni_dbus_deserialize_xml_dict_iter(iter, type, node);
+
+	default:
+		break;
+	}
+
+	if (!ni_dbus_message_iter_get_variant_data_borrowed(iter, &var)) {
+		ni_error("unable to deserialize %s: cannot decode %c data",
+				node->name, arg_type);
+		return FALSE;
+	}
+	rv = ni_dbus_deserialize_xml(&var, type, node);
+	ni_dbus_variant_destroy(&var);
+	return rv;
+}
+
+static dbus_bool_t
+ni_dbus_deserialize_xml_dict_iter(DBusMessageIter *iter, const ni_xs_type_t *type, xml_node_t *node)
+{
+	ni_xs_dict_info_t *dict_info = ni_xs_dict_info(type);
+	DBusMessageIter iter_dict;
+
+	dbus_message_iter_recurse(iter, &iter_dict);
+	while (dbus_message_iter_get_arg_type(&iter_dict) == DBUS_TYPE_DICT_ENTRY) {
+		const ni_xs_type_t *child_type;
+		DBusMessageIter iter_entry;
+		xml_node_t *child;
+		const char *key;
+
+		dbus_message_iter_recurse(&iter_dict, &iter_entry);
+		dbus_message_iter_next(&iter_dict);
+
+		if (dbus_message_iter_get_arg_type(&iter_entry) != DBUS_TYPE_STRING) {
+			ni_error("unable to deserialize %s: bad dict key", node->name);
+			return FALSE;
+		}
+		dbus_message_iter_get_basic(&iter_entry, &key);
+		if (!dbus_message_iter_next(&iter_entry)) {
+			ni_error("unable to deserialize %s: missing dict value", node->name);
+			return FALSE;
+		}
+
+		/* Silently ignore dict entries we have no schema information for */
+		if (!(child_type = ni_xs_dict_info_find(dict_info, key))) {
+			ni_debug_dbus("%s: ignoring unknown dict entry %s in node <%s>",
+					__func__, key, node->name);
+			continue;
+		}
+
+		child = xml_node_new(key, node);
+		if (!ni_dbus_deserialize_xml_iter(&iter_entry, child_type, child))
+			return FALSE;
+	}
+	return TRUE;
+}
+
 /*
  * Serialize a struct
  */
@@ -1766,19 +1900,18 @@ int
 ni_dbus_xml_expand_element_reference(xml_node_t *doc_node, const char *expr_string,
 			xml_node_t **ret_nodes, unsigned int max_nodes)
 {
-	xpath_enode_t *expression;
+	const xpath_enode_t *expression;
 	xpath_result_t *result;
 	unsigned int i, nret;
 
 	if (xml_node_is_empty(doc_node))
 		return 0;
 
-	expression = xpath_expression_parse(expr_string);
+	expression = xpath_expression_lookup(expr_string);
 	if (expression == NULL)
 		return -NI_ERROR_DOCUMENT_ERROR;
 
 	result = xpath_expression_eval(expression, doc_node);
-	xpath_expression_free(expression);
 
 	if (result == NULL)
 		return -NI_ERROR_DOCUMENT_ERROR;
@@ -12,6 +12,7 @@
 #include <arpa/inet.h>
 #include <time.h>
 #include <errno.h>
+#include <stddef.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -682,6 +683,27 @@ ni_dhcp4_device_prepare_message(void *data)
 	return 0;
 }
 
+/*
+ * Retransmits differ in the secs field only; update it in the
+ * packet already built, adjusting the UDP checksum incrementally.
+ */
+static int
+ni_dhcp4_device_refresh_message(void *data)
+{
+	ni_dhcp4_device_t *dev = data;
+	uint16_t secs;
+
+	secs = htons(ni_dhcp4_device_uptime(dev, 0xFFFF));
+	if (ni_capture_update_udp_payload(&dev->message, offsetof(ni_dhcp4_message_t, secs),
+					&secs, sizeof(secs)) < 0)
+		return ni_dhcp4_device_prepare_message(dev);
+
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
+			"%s: xid: 0x%x, secs: %u", dev->ifname,
+			dev->dhcp4.xid, ntohs(secs));
+	return 0;
+}
+
 int
 ni_dhcp4_device_send_message(ni_dhcp4_device_t *dev, unsigned int msg_code, const ni_addrconf_lease_t *lease)
 {
@@ -719,7 +741,7 @@ ni_dhcp4_device_send_message(ni_dhcp4_device_t *dev, unsigned int msg_code, cons
 		timeout.nretries = -1;
 		timeout.jitter.min = -1;/* add a random jitter of +/-1 sec */
 		timeout.jitter.max = 1;
-		timeout.timeout_callback = ni_dhcp4_device_prepare_message;
+		timeout.timeout_callback = ni_dhcp4_device_refresh_message;
 		timeout.timeout_data = dev;
 		rv = ni_capture_send(dev->capture, &dev->message, &timeout);
 		break;
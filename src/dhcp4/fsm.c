@@ -1076,6 +1076,7 @@ ni_dhcp4_fsm_arp_validate(ni_dhcp4_device_t *dev)
 			return -1;
 		}
 	}
+	ni_arp_socket_set_filter(dev->arp.handle, &claim, 1);
 
 	if (dev->arp.nprobes) {
 		ni_debug_dhcp("%s: arp validate: probing for %s",
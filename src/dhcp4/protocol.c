@@ -45,7 +45,13 @@
 #include "buffer.h"
 #include "socket_priv.h"
 
-static void	ni_dhcp4_socket_recv(ni_socket_t *);
+static void	ni_dhcp4_socket_process(ni_capture_t *, ni_buffer_t *, ni_sockaddr_t *);
+
+/*
+ * All devices share a single packet socket for receiving,
+ * which dispatches the packets by the incoming ifindex.
+ */
+static ni_capture_t *	ni_dhcp4_shared_capture;
 
 /*
  * Open a DHCP4 socket for send and receive
@@ -112,7 +118,21 @@ ni_dhcp4_socket_open(ni_dhcp4_device_t *dev)
 		dev->capture = NULL;
 	}
 
-	dev->capture = ni_capture_open(&dev->system, &prot_info, ni_dhcp4_socket_recv);
+	if ((capture = ni_dhcp4_shared_capture) != NULL &&
+	    !ni_capture_is_valid(capture, ETHERTYPE_IP)) {
+		/* devices still using it drop it when they reopen */
+		ni_capture_free(capture);
+		ni_dhcp4_shared_capture = NULL;
+	}
+
+	if (ni_dhcp4_shared_capture == NULL) {
+		ni_dhcp4_shared_capture = ni_capture_open_shared(&prot_info,
+						ni_dhcp4_socket_process, "dhcp4");
+		if (!ni_dhcp4_shared_capture)
+			return -1;
+	}
+
+	dev->capture = ni_capture_attach(ni_dhcp4_shared_capture, &dev->system, &prot_info);
 	if (!dev->capture)
 		return -1;
 
@@ -121,21 +141,19 @@ ni_dhcp4_socket_open(ni_dhcp4_device_t *dev)
 }
 
 /*
- * This callback is invoked from the socket code when we
- * detect an incoming DHCP4 packet on the raw socket.
+ * This callback is invoked from the shared capture when we
+ * detect incoming DHCP4 packets on the raw socket.
  */
 static void
-ni_dhcp4_socket_recv(ni_socket_t *sock)
+ni_dhcp4_socket_process(ni_capture_t *capture, ni_buffer_t *buf, ni_sockaddr_t *from)
 {
-	ni_capture_t *capture = sock->user_data;
-	ni_sockaddr_t from;
-	ni_buffer_t buf;
+	ni_dhcp4_device_t *dev;
 
-	if (ni_capture_recv(capture, &buf, &from, "dhcp4") >= 0) {
-		ni_dhcp4_device_t *dev = ni_capture_get_user_data(capture);
+	dev = ni_dhcp4_device_by_index(ni_capture_from_ifindex(from));
+	if (!dev || !dev->capture)
+		return;
 
-		ni_dhcp4_fsm_process_dhcp4_packet(dev, &buf, &from);
-	}
+	ni_dhcp4_fsm_process_dhcp4_packet(dev, buf, from);
 }
 
 /*
@@ -42,6 +42,7 @@
 #include "appconfig.h"
 #include "util_priv.h"
 #include "netinfo_priv.h"
+#include "socket_priv.h"
 #include "iaid.h"
 #include "duid.h"
 #include "dhcp.h"
@@ -865,6 +866,7 @@ ni_dhcp6_device_retransmit_arm(ni_dhcp6_device_t *dev)
 		 */
 		ni_dhcp6_fsm_set_timeout_msec(dev, dev->retrans.duration);
 	}
+	ni_socket_update_timeout(dev->mcast.sock);
 }
 
 void
@@ -881,6 +883,7 @@ ni_dhcp6_device_retransmit_disarm(ni_dhcp6_device_t *dev)
 
 	dev->dhcp6.xid = 0;
 	memset(&dev->retrans, 0, sizeof(dev->retrans));
+	ni_socket_update_timeout(dev->mcast.sock);
 }
 
 static ni_bool_t
@@ -914,6 +917,7 @@ ni_dhcp6_device_retransmit_advance(ni_dhcp6_device_t *dev)
 		dev->retrans.params.timeout = ni_timeout_arm_msec(
 				&dev->retrans.deadline,
 				&dev->retrans.params);
+		ni_socket_update_timeout(dev->mcast.sock);
 
 		ni_debug_dhcp("%s: advanced xid 0x%06x retransmission timeout from %u to %u [%d .. %d]",
 				dev->ifname, dev->dhcp6.xid, old_timeout,
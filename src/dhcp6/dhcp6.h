@@ -183,6 +183,7 @@ struct ni_dhcp6_device {
 	struct {
 	    ni_socket_t *	sock;		/* multicast socket		*/
 	    ni_sockaddr_t	dest;		/* relays & servers multicast	*/
+	    unsigned int	drops;		/* packets dropped by kernel	*/
 	} mcast;
 
 	struct timeval		start_time;	/* when we started managing     */
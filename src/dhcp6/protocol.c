@@ -124,8 +124,10 @@ __ni_dhcp6_mcast_socket_open(const struct ni_dhcp6_link *link, const char *ifnam
 	if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1)
 		ni_error("%s: Cannot set setsockopt(SO_REUSEPORT): %m", ifname);
 #endif
-	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &on, sizeof(on)) == -1)
-		ni_error("%s: Cannot set setsockopt(SO_RCVBUF): %m", ifname);
+#if defined(SO_RXQ_OVFL)
+	if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) == -1)
+		ni_error("%s: Cannot set setsockopt(SO_RXQ_OVFL): %m", ifname);
+#endif
 
 	if (setsockopt(fd, IPPROTO_IPV6, IPV6_RECVPKTINFO, &on, sizeof(on)) != 0)
 		ni_error("%s: Cannot set setsockopt(IPV6_RECVPKTINFO): %m", ifname);
@@ -230,6 +232,7 @@ ni_dhcp6_mcast_socket_close(ni_dhcp6_device_t *dev)
 		ni_socket_close(dev->mcast.sock);
 	dev->mcast.sock = NULL;
 	memset(&dev->mcast.dest, 0, sizeof(dev->mcast.dest));
+	dev->mcast.drops = 0;
 }
 
 ssize_t
@@ -275,14 +278,34 @@ __ni_dhcp6_hexdump(ni_stringbuf_t *sbuf, const ni_buffer_t *packet)
 }
 
 static void
-ni_dhcp6_socket_recv(ni_socket_t *sock)
+ni_dhcp6_socket_update_drops(ni_dhcp6_device_t *dev, uint32_t drops)
+{
+	uint32_t delta = drops - dev->mcast.drops;
+
+	/* the kernel reports a running counter; ignore stale values */
+	if (delta == 0 || delta > INT32_MAX)
+		return;
+
+	dev->mcast.drops = drops;
+	ni_debug_socket("%s: kernel dropped %u DHCPv6 packets (%u total)",
+			dev->ifname, delta, drops);
+}
+
+/*
+ * Receive and process one packet from the socket.
+ * Returns 1 when a packet has been read, 0 when the socket
+ * queue is empty and -1 on error.
+ */
+static int
+ni_dhcp6_socket_recv_one(ni_socket_t *sock)
 {
 #ifdef	NI_DHCP6_HEXDUMP_LEVEL
 	ni_stringbuf_t hexbuf = NI_STRINGBUF_INIT_DYNAMIC;
 #endif
 	ni_dhcp6_device_t * dev = sock->user_data;
 	ni_buffer_t * rbuf = &sock->rbuf;
-	unsigned char cbuf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+	unsigned char cbuf[CMSG_SPACE(sizeof(struct in6_pktinfo)) +
+			   CMSG_SPACE(sizeof(uint32_t))];
 	ni_sockaddr_t saddr;
 	struct iovec iov = {
 		.iov_base = ni_buffer_tail(rbuf),
@@ -304,18 +327,19 @@ ni_dhcp6_socket_recv(ni_socket_t *sock)
 	memset(&saddr, 0, sizeof(saddr));
 	memset(&cbuf, 0, sizeof(cbuf));
 
-	bytes = recvmsg(sock->__fd, &msg, 0);
+	bytes = recvmsg(sock->__fd, &msg, MSG_DONTWAIT);
 	if(bytes < 0) {
-		if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
-			ni_error("%s: recvmsg error on socket %d: %m",
-				dev->ifname, sock->__fd);
-			ni_socket_deactivate(sock);
-		}
-		return;
+		if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+			return 0;
+
+		ni_error("%s: recvmsg error on socket %d: %m",
+			dev->ifname, sock->__fd);
+		ni_socket_deactivate(sock);
+		return -1;
 	} else if (bytes == 0) {
 		ni_error("%s: recvmsg didn't returned any data on socket %d",
 			dev->ifname, sock->__fd);
-		return;
+		return 1;
 	}
 
 	for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
@@ -324,17 +348,27 @@ ni_dhcp6_socket_recv(ni_socket_t *sock)
 		    cm->cmsg_len == CMSG_LEN(sizeof(struct in6_pktinfo))) {
 			pinfo = (struct in6_pktinfo *)(CMSG_DATA(cm));
 		}
+#if defined(SO_RXQ_OVFL)
+		if (cm->cmsg_level == SOL_SOCKET &&
+		    cm->cmsg_type == SO_RXQ_OVFL &&
+		    cm->cmsg_len >= CMSG_LEN(sizeof(uint32_t))) {
+			uint32_t drops;
+
+			memcpy(&drops, CMSG_DATA(cm), sizeof(drops));
+			ni_dhcp6_socket_update_drops(dev, drops);
+		}
+#endif
 	}
 
 	if (pinfo == NULL) {
 		ni_error("%s: discarding packet without packet info on socket %d",
 			dev->ifname, sock->__fd);
-		return;
+		return 1;
 	}
 	if(dev->link.ifindex != pinfo->ipi6_ifindex) {
 		ni_error("%s: discarding packet with interface index %u instead %u",
 			dev->ifname, pinfo->ipi6_ifindex, dev->link.ifindex);
-		return;
+		return 1;
 	}
 
 	ni_buffer_push_tail(rbuf, bytes);
@@ -349,6 +383,25 @@ ni_dhcp6_socket_recv(ni_socket_t *sock)
 
 	ni_dhcp6_process_packet(dev, rbuf, &pinfo->ipi6_addr);
 	ni_buffer_reset(rbuf);
+	return 1;
+}
+
+/*
+ * Drain up to NI_DHCP6_RECV_BATCH queued packets per wakeup.
+ * Processing a packet may close the socket, e.g. when the
+ * device gets stopped, so we stop as soon as it is gone.
+ */
+static void
+ni_dhcp6_socket_recv(ni_socket_t *sock)
+{
+	unsigned int count;
+
+	for (count = 0; count < NI_DHCP6_RECV_BATCH; ++count) {
+		if (ni_dhcp6_socket_recv_one(sock) <= 0)
+			break;
+		if (sock->__fd < 0 || !sock->active)
+			break;
+	}
 }
 
 static int
@@ -29,6 +29,7 @@
  */
 #define NI_DHCP6_RBUF_SIZE		65536		/* max. UDP packet  */
 #define NI_DHCP6_WBUF_SIZE		1280		/* initial size     */
+#define NI_DHCP6_RECV_BATCH		16		/* packets / wakeup */
 
 /*
  * We use the preferred lifetime (== lease time) to adjust
@@ -102,6 +102,11 @@ struct ni_fsm_policy {
 	ni_fsm_policy_t **		pprev;
 	ni_fsm_policy_t *		next;
 
+	struct {			/* fsm->policy_index chain */
+		ni_fsm_policy_t **	pprev;
+		ni_fsm_policy_t *	next;
+	} index;
+
 	unsigned int			seq;
 
 	ni_fsm_policy_type_t		type;
@@ -157,6 +162,48 @@ __ni_fsm_policy_list_unlink(ni_fsm_policy_t *policy)
 		next->pprev = pprev;
 	policy->pprev = NULL;
 	policy->next = NULL;
+
+	pprev = policy->index.pprev;
+	next = policy->index.next;
+	if (pprev)
+		*pprev = next;
+	if (next)
+		next->index.pprev = pprev;
+	policy->index.pprev = NULL;
+	policy->index.next = NULL;
+}
+
+/*
+ * Policies apply to the worker with the matching policy name only,
+ * so the fsm keeps an index of its policies by name.
+ */
+static inline unsigned int
+__ni_fsm_policy_index_hash(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (name && *name)
+		hash = ((hash << 5) + hash) + (unsigned char) *name++;
+	return hash % NI_FSM_POLICY_INDEX_SIZE;
+}
+
+static inline void
+__ni_fsm_policy_index_insert(ni_fsm_t *fsm, ni_fsm_policy_t *policy)
+{
+	ni_fsm_policy_t **head;
+
+	head = &fsm->policy_index[__ni_fsm_policy_index_hash(policy->name)];
+	policy->index.pprev = head;
+	policy->index.next = *head;
+	if (policy->index.next)
+		policy->index.next->index.pprev = &policy->index.next;
+	*head = policy;
+}
+
+static inline ni_fsm_policy_t *
+__ni_fsm_policy_index_first(const ni_fsm_t *fsm, const char *name)
+{
+	return fsm->policy_index[__ni_fsm_policy_index_hash(name)];
 }
 
 /*
@@ -322,6 +369,7 @@ ni_fsm_policy_new(ni_fsm_t *fsm, const char *name, xml_node_t *node)
 	}
 
 	__ni_fsm_policy_list_insert(&fsm->policies, policy);
+	__ni_fsm_policy_index_insert(fsm, policy);
 	return policy;
 }
 
@@ -406,7 +454,8 @@ ni_fsm_policy_by_name(const ni_fsm_t *fsm, const char *name)
 {
 	ni_fsm_policy_t *policy;
 
-	for (policy = fsm->policies; policy; policy = policy->next) {
+	policy = __ni_fsm_policy_index_first(fsm, name);
+	for ( ; policy; policy = policy->index.next) {
 		if (policy->name && ni_string_eq(policy->name, name))
 			return policy;
 	}
@@ -447,21 +496,17 @@ ni_fsm_policy_location(const ni_fsm_policy_t *policy)
  * Check whether policy applies to this ifworker
  */
 static ni_bool_t
-ni_fsm_policy_applicable(const ni_fsm_t *fsm, ni_fsm_policy_t *policy, ni_ifworker_t *w)
+ni_fsm_policy_applicable(const ni_fsm_t *fsm, ni_fsm_policy_t *policy, ni_ifworker_t *w,
+			const char *pname)
 {
 	xml_node_t *node;
-	char *pname;
 
 	if (!policy || !w)
 		return FALSE;
 
 	/* 1st match check -ifworker to policy name comparison */
-	pname = ni_ifpolicy_name_from_ifname(w->name);
-	if (!ni_string_eq(policy->name, pname)) {
-		ni_string_free(&pname);
+	if (!ni_string_eq(policy->name, pname))
 		return FALSE;
-	}
-	ni_string_free(&pname);
 
 	/* 2nd match check - ifworker  to config name comparison */
 	if (!xml_node_is_empty(w->config.node) &&
@@ -527,13 +572,20 @@ ni_fsm_policy_get_applicable_policies(const ni_fsm_t *fsm, ni_ifworker_t *w,
 {
 	unsigned int count = 0;
 	ni_fsm_policy_t *policy;
+	char *pname;
 
 	if (!w) {
 		ni_error("unable to get applicable policy for non-existing device");
 		return 0;
 	}
 
-	for (policy = fsm->policies; policy; policy = policy->next) {
+	/* only the policies named after the worker can apply */
+	pname = ni_ifpolicy_name_from_ifname(w->name);
+	policy = __ni_fsm_policy_index_first(fsm, pname);
+	for ( ; policy; policy = policy->index.next) {
+		if (!ni_string_eq(policy->name, pname))
+			continue;
+
 		if (!ni_ifpolicy_name_is_valid(policy->name)) {
 			ni_error("policy with invalid name %s", policy->name);
 			continue;
@@ -549,11 +601,12 @@ ni_fsm_policy_get_applicable_policies(const ni_fsm_t *fsm, ni_ifworker_t *w,
 			continue;
 		}
 
-		if (ni_fsm_policy_applicable(fsm, policy, w)) {
+		if (ni_fsm_policy_applicable(fsm, policy, w, pname)) {
 			if (count < max)
 				result[count++] = policy;
 		}
 	}
+	ni_string_free(&pname);
 
 	qsort(result, count, sizeof(result[0]), __ni_fsm_policy_compare);
 	return count;
@@ -563,16 +616,24 @@ ni_bool_t
 ni_fsm_exists_applicable_policy(const ni_fsm_t *fsm, ni_fsm_policy_t *list, ni_ifworker_t *w)
 {
 	ni_fsm_policy_t *policy;
+	ni_bool_t found = FALSE;
+	char *pname;
 
 	if (!list || !w)
 		return FALSE;
 
-	for (policy = list; policy; policy = policy->next) {
-		if (ni_fsm_policy_applicable(fsm, policy, w))
-			return TRUE;
+	pname = ni_ifpolicy_name_from_ifname(w->name);
+	if (fsm && list == fsm->policies) {
+		policy = __ni_fsm_policy_index_first(fsm, pname);
+		for ( ; policy && !found; policy = policy->index.next)
+			found = ni_fsm_policy_applicable(fsm, policy, w, pname);
+	} else {
+		for (policy = list; policy && !found; policy = policy->next)
+			found = ni_fsm_policy_applicable(fsm, policy, w, pname);
 	}
+	ni_string_free(&pname);
 
-	return FALSE;
+	return found;
 }
 
 /*
@@ -49,6 +49,7 @@ static int			ni_ifworker_bind_device_apis(ni_ifworker_t *, const ni_dbus_service
 static void			ni_ifworker_control_init(ni_ifworker_control_t *);
 static void			ni_ifworker_control_destroy(ni_ifworker_control_t *);
 static ni_bool_t		__ni_ifworker_refresh_netdevs(ni_fsm_t *);
+static ni_bool_t		__ni_ifworker_refresh_netdevs_by_name(ni_dbus_object_t *, const ni_string_array_t *);
 #ifdef MODEM
 static ni_bool_t		__ni_ifworker_refresh_modems(ni_fsm_t *);
 #endif
@@ -58,6 +59,7 @@ static void			ni_ifworker_set_config_origin(ni_ifworker_t *, const char *);
 static void			ni_ifworker_cancel_timeout(ni_ifworker_t *);
 static void			ni_ifworker_cancel_secondary_timeout(ni_ifworker_t *);
 static void			ni_ifworker_cancel_callbacks(ni_ifworker_t *, ni_objectmodel_callback_info_t **);
+static void			ni_ifworker_cancel_async_calls(const ni_ifworker_t *);
 static dbus_bool_t		ni_ifworker_waiting_for_events(ni_ifworker_t *);
 static void			ni_ifworker_advance_state(ni_ifworker_t *, ni_event_t);
 static ni_bool_t		ni_ifworker_revert_state(ni_ifworker_t *, ni_event_t);
@@ -89,6 +91,7 @@ ni_fsm_free(ni_fsm_t *fsm)
 	ni_fsm_events_destroy(&fsm->events);
 	ni_ifworker_array_destroy(&fsm->pending);
 	ni_ifworker_array_destroy(&fsm->workers);
+	ni_string_array_destroy(&fsm->refresh_ifnames);
 	free(fsm);
 }
 
@@ -312,6 +315,8 @@ __ni_ifworker_reset_action_table(ni_ifworker_t *w)
 {
 	ni_fsm_transition_t *action;
 
+	ni_ifworker_cancel_async_calls(w);
+
 	for (action = w->fsm.action_table; action && action->next_state; action++) {
 		ni_fsm_transition_reset(action);
 		ni_fsm_require_list_destroy(&action->require.list);
@@ -359,6 +364,7 @@ __ni_ifworker_destroy_fsm(ni_ifworker_t *w)
 
 	__ni_ifworker_destroy_action_table(w);
 	ni_fsm_require_list_destroy(&w->fsm.check_state_req_list);
+	ni_ifworker_array_destroy(&w->fsm.dependents);
 }
 
 void
@@ -3966,8 +3972,17 @@ __ni_ifworker_refresh_netdevs(ni_fsm_t *fsm)
 		return FALSE;
 	}
 
-	/* Call ObjectManager.GetManagedObjects to get list of objects and their properties */
-	if (!ni_dbus_object_refresh_children(list_object)) {
+	if (fsm->refresh_ifnames.count) {
+		/* Call ObjectManager.GetManagedObjectsFiltered to get the
+		 * requested objects and the objects they depend on only */
+		if (!__ni_ifworker_refresh_netdevs_by_name(list_object, &fsm->refresh_ifnames)) {
+			ni_error("Couldn't refresh list of requested network interfaces");
+			return FALSE;
+		}
+	} else
+	/* Call ObjectManager.GetManagedObjectsSince to get list of objects and
+	 * the properties of the objects changed since the last refresh */
+	if (!ni_dbus_object_refresh_changed_children(list_object, NULL)) {
 		ni_error("Couldn't refresh list of active network interfaces");
 		return FALSE;
 	}
@@ -3977,6 +3992,66 @@ __ni_ifworker_refresh_netdevs(ni_fsm_t *fsm)
 	return TRUE;
 }
 
+static void
+__ni_ifworker_refresh_netdevs_query(ni_string_array_t *names, ni_string_array_t *query, const char *name)
+{
+	if (ni_string_empty(name) || ni_string_array_index(names, name) >= 0)
+		return;
+
+	ni_string_array_append(names, name);
+	ni_string_array_append(query, name);
+}
+
+/*
+ * Refresh the named devices and, in further rounds, their master and
+ * lower devices, e.g. the base device of a vlan, the fsm needs to build
+ * the hierarchy.
+ */
+static ni_bool_t
+__ni_ifworker_refresh_netdevs_by_name(ni_dbus_object_t *list_object, const ni_string_array_t *ifnames)
+{
+	ni_string_array_t names = NI_STRING_ARRAY_INIT;
+	ni_string_array_t query = NI_STRING_ARRAY_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_variant_t filter;
+	ni_dbus_object_t *object;
+	ni_bool_t rv = TRUE;
+	unsigned int i;
+
+	for (i = 0; i < ifnames->count; ++i)
+		__ni_ifworker_refresh_netdevs_query(&names, &query, ifnames->data[i]);
+
+	while (rv && query.count) {
+		ni_dbus_variant_init_dict(&filter);
+		for (i = 0; i < query.count; ++i)
+			ni_dbus_dict_add_string(&filter, "name", query.data[i]);
+		ni_string_array_destroy(&query);
+
+		rv = ni_dbus_object_get_managed_objects_filtered(list_object, &filter, &error);
+		ni_dbus_variant_destroy(&filter);
+		if (!rv) {
+			ni_dbus_print_error(&error, "%s.getManagedObjectsFiltered failed",
+					list_object->path);
+			break;
+		}
+
+		for (object = list_object->children; object; object = object->next) {
+			ni_netdev_t *dev = ni_objectmodel_unwrap_netif(object, NULL);
+
+			if (!dev || ni_string_array_index(&names, dev->name) < 0)
+				continue;
+
+			__ni_ifworker_refresh_netdevs_query(&names, &query, dev->link.masterdev.name);
+			__ni_ifworker_refresh_netdevs_query(&names, &query, dev->link.lowerdev.name);
+		}
+	}
+
+	dbus_error_free(&error);
+	ni_string_array_destroy(&query);
+	ni_string_array_destroy(&names);
+	return rv;
+}
+
 ni_ifworker_t *
 ni_fsm_recv_new_netif(ni_fsm_t *fsm, ni_dbus_object_t *object, ni_bool_t refresh)
 {
@@ -4099,8 +4174,9 @@ __ni_ifworker_refresh_modems(ni_fsm_t *fsm)
 		return FALSE;
 	}
 
-	/* Call ObjectManager.GetManagedObjects to get list of objects and their properties */
-	if (!ni_dbus_object_refresh_children(list_object)) {
+	/* Call ObjectManager.GetManagedObjectsSince to get list of objects and
+	 * the properties of the objects changed since the last refresh */
+	if (!ni_dbus_object_refresh_changed_children(list_object, NULL)) {
 		ni_error("Couldn't refresh list of available modems");
 		return FALSE;
 	}
@@ -4687,6 +4763,193 @@ ni_ifworker_update_from_request(ni_ifworker_t *w, const char *service, const cha
 	}
 }
 
+/*
+ * Evaluate the result of a common call binding.
+ * Returns 0 to continue with the next binding, 1 when the failure
+ * of the call has been ignored and the worker advanced to the next
+ * state and the (negative) error when the worker failed.
+ */
+static int
+ni_ifworker_common_call_result(ni_ifworker_t *w, ni_fsm_transition_t *action,
+			const char *service, const char *method, int rv,
+			ni_objectmodel_callback_info_t *callback_list, unsigned int *count)
+{
+	ni_ifworker_update_from_request(w, service, method, rv, callback_list);
+	if (rv < 0) {
+		if (action->common.may_fail) {
+			ni_error("[ignored] %s: call to %s.%s() failed: %s", w->name,
+					service, method, ni_strerror(rv));
+			ni_ifworker_set_state(w, action->next_state);
+			return 1;
+		}
+		ni_ifworker_fail(w, "call to %s.%s() failed: %s", service, method, ni_strerror(rv));
+		return rv;
+	}
+
+	if (callback_list) {
+		ni_debug_application("%s: adding callback for %s.%s()", w->name, service, method);
+		ni_ifworker_add_callbacks(action, callback_list, w->name);
+		(*count)++;
+	}
+	return 0;
+}
+
+static void
+ni_ifworker_common_call_done(ni_ifworker_t *w, ni_fsm_transition_t *action, unsigned int count)
+{
+	/* Reset wait_for if there are no callbacks ... */
+	if (count == 0) {
+		/* ... unless this action requires ACK via event */
+		if (action->next_state != NI_FSM_STATE_DEVICE_DOWN) {
+			ni_ifworker_set_state(w, action->next_state);
+			w->fsm.wait_for = NULL;
+		}
+	}
+}
+
+/*
+ * Workers without any master or lower device relation don't have to wait
+ * until the calls of other workers finished and may call wickedd in the
+ * background, limited to the configured number of calls in flight.
+ * The worker is waiting for the action while a call is in flight and
+ * continues with the next call binding of the action in the reply handler.
+ */
+typedef struct ni_ifworker_async_call	ni_ifworker_async_call_t;
+
+struct ni_ifworker_async_call {
+	ni_ifworker_async_call_t *	next;
+
+	ni_ifworker_t *			worker;
+	ni_fsm_transition_t *		action;
+	unsigned int			binding;
+	unsigned int			callbacks;
+	dbus_uint32_t			serial;
+};
+
+static struct {
+	unsigned int			count;
+	ni_ifworker_async_call_t *	list;
+} ni_ifworker_async_calls;
+
+static ni_bool_t
+ni_ifworker_async_call_possible(const ni_ifworker_t *w)
+{
+	unsigned int limit = ni_config_fsm_max_async_calls();
+
+	if (!limit || ni_ifworker_async_calls.count >= limit || !w->object)
+		return FALSE;
+
+	return !w->masterdev && !w->lowerdev &&
+		!w->children.count && !w->lowerdev_for.count;
+}
+
+static void
+ni_ifworker_cancel_async_calls(const ni_ifworker_t *w)
+{
+	ni_ifworker_async_call_t *call;
+
+	/* keep them to consume the replies, but forget the action */
+	for (call = ni_ifworker_async_calls.list; call; call = call->next) {
+		if (call->worker == w)
+			call->action = NULL;
+	}
+}
+
+static void	ni_ifworker_async_call_reply(ni_dbus_object_t *, ni_dbus_message_t *);
+
+static int
+ni_ifworker_do_common_call_async(ni_ifworker_t *w, ni_fsm_transition_t *action,
+			unsigned int index, unsigned int count)
+{
+	ni_ifworker_async_call_t *call;
+	int rv;
+
+	for ( ; index < action->num_bindings; ++index) {
+		ni_fsm_transition_bind_t *bind = &action->binding[index];
+
+		if (!bind->method || !bind->service)
+			continue;
+
+		if (bind->skip_call)
+			continue;
+
+		ni_debug_application("%s: calling %s.%s() asynchronously", w->name,
+				bind->service->name, bind->method->name);
+
+		call = xcalloc(1, sizeof(*call));
+		rv = ni_call_common_xml_async(w->object, bind->service, bind->method,
+				bind->config, ni_ifworker_async_call_reply, &call->serial);
+		if (rv < 0) {
+			free(call);
+			rv = ni_ifworker_common_call_result(w, action, bind->service->name,
+					bind->method->name, rv, NULL, &count);
+			return rv < 0 ? rv : 0;
+		}
+
+		call->worker = ni_ifworker_get(w);
+		call->action = action;
+		call->binding = index;
+		call->callbacks = count;
+		call->next = ni_ifworker_async_calls.list;
+		ni_ifworker_async_calls.list = call;
+		ni_ifworker_async_calls.count++;
+		return 0;
+	}
+
+	ni_ifworker_common_call_done(w, action, count);
+	return 0;
+}
+
+static void
+ni_ifworker_async_call_reply(ni_dbus_object_t *proxy, ni_dbus_message_t *reply)
+{
+	ni_objectmodel_callback_info_t *callback_list = NULL;
+	ni_ifworker_async_call_t *call, **pos;
+	ni_fsm_transition_bind_t *bind;
+	ni_fsm_transition_t *action;
+	unsigned int count;
+	ni_ifworker_t *w;
+	int rv;
+
+	for (pos = &ni_ifworker_async_calls.list; (call = *pos); pos = &call->next) {
+		if (reply ? call->serial == dbus_message_get_reply_serial(reply) :
+			    call->worker->object == proxy)
+			break;
+	}
+	if (!call) {
+		ni_debug_application("%s: ignoring reply to unknown call", __func__);
+		return;
+	}
+	*pos = call->next;
+	ni_ifworker_async_calls.count--;
+
+	w = call->worker;
+	action = call->action;
+	if (!action || w->fsm.wait_for != action || ni_ifworker_complete(w)) {
+		ni_debug_application("%s: ignoring reply to an obsolete call", w->name);
+		goto done;
+	}
+
+	bind = &action->binding[call->binding];
+	rv = ni_call_common_async_result(reply, bind->service, bind->method, &callback_list);
+	if (rv == -NI_ERROR_AUTH_INFO_MISSING) {
+		/* the error handler may prompt for it -- retry synchronously */
+		callback_list = NULL;
+		rv = ni_call_common_xml(w->object, bind->service, bind->method,
+				bind->config, &callback_list, ni_ifworker_error_handler);
+	}
+
+	count = call->callbacks;
+	rv = ni_ifworker_common_call_result(w, action, bind->service->name,
+			bind->method->name, rv, callback_list, &count);
+	if (rv == 0)
+		ni_ifworker_do_common_call_async(w, action, call->binding + 1, count);
+
+done:
+	ni_ifworker_release(w);
+	free(call);
+}
+
 static int
 ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t *action)
 {
@@ -4696,6 +4959,9 @@ ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t
 	/* Initially, enable waiting for this action */
 	w->fsm.wait_for = action;
 
+	if (ni_ifworker_async_call_possible(w))
+		return ni_ifworker_do_common_call_async(w, action, 0, 0);
+
 	for (i = 0; i < action->num_bindings; ++i) {
 		ni_fsm_transition_bind_t *bind = &action->binding[i];
 		ni_objectmodel_callback_info_t *callback_list = NULL;
@@ -4715,41 +4981,17 @@ ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t
 
 		rv = ni_call_common_xml(w->object, bind->service, bind->method, bind->config,
 				&callback_list, ni_ifworker_error_handler);
-		ni_ifworker_update_from_request(w, service, method, rv, callback_list);
-		if (rv < 0) {
-			if (action->common.may_fail) {
-				ni_error("[ignored] %s: call to %s.%s() failed: %s", w->name,
-						service, method, ni_strerror(rv));
-				ni_ifworker_set_state(w, action->next_state);
-				ni_string_free(&service);
-				ni_string_free(&method);
-				return 0;
-			}
-			ni_ifworker_fail(w, "call to %s.%s() failed: %s", service, method, ni_strerror(rv));
-			ni_string_free(&service);
-			ni_string_free(&method);
-			return rv;
-		}
-
-		if (callback_list) {
-			ni_debug_application("%s: adding callback for %s.%s()", w->name, service, method);
-			ni_ifworker_add_callbacks(action, callback_list, w->name);
-			count++;
-		}
+		rv = ni_ifworker_common_call_result(w, action, service, method, rv,
+				callback_list, &count);
 
 		ni_string_free(&service);
 		ni_string_free(&method);
-	}
 
-	/* Reset wait_for if there are no callbacks ... */
-	if (count == 0) {
-		/* ... unless this action requires ACK via event */
-		if (action->next_state != NI_FSM_STATE_DEVICE_DOWN) {
-			ni_ifworker_set_state(w, action->next_state);
-			w->fsm.wait_for = NULL;
-		}
+		if (rv != 0)
+			return rv < 0 ? rv : 0;
 	}
 
+	ni_ifworker_common_call_done(w, action, count);
 	return 0;
 }
 
@@ -5121,137 +5363,336 @@ ni_fsm_schedule_bind_methods(ni_fsm_t *fsm, ni_ifworker_t *w)
 	return 0;
 }
 
-unsigned int
-ni_fsm_schedule(ni_fsm_t *fsm)
+/*
+ * Run the next action of a worker.
+ * Returns 1 when the worker made progress, -1 when the action has been
+ * deferred because of pending dependencies and 0 otherwise.
+ */
+static int
+ni_fsm_schedule_worker(ni_fsm_t *fsm, ni_ifworker_t *w)
 {
-	unsigned int i, waiting, nrequested;
+	ni_fsm_transition_t *action;
+	unsigned int prev_state;
+	int made_progress = 0;
+	int rv;
 
-	while (1) {
-		int made_progress = 0;
+	if (w->pending || ni_ifworker_complete(w) || w->fsm.wait_for)
+		return 0;
 
-		for (i = 0; i < fsm->workers.count; ++i) {
-			ni_ifworker_t *w = fsm->workers.data[i];
-			ni_fsm_transition_t *action;
-			unsigned int prev_state;
-			int rv;
+	action = w->fsm.next_action;
+	if (action->next_state == NI_FSM_STATE_NONE)
+		w->fsm.state = w->target_state;
 
-			ni_ifworker_get(w);
+	if (w->fsm.state == w->target_state) {
+		ni_ifworker_success(w);
+		return 1;
+	}
 
-			if (w->pending)
-				goto release;
+	ni_debug_application("%s: state=%s want=%s, next transition is %s -> %s", w->name,
+		ni_ifworker_state_name(w->fsm.state),
+		ni_ifworker_state_name(w->target_state),
+		ni_ifworker_state_name(w->fsm.next_action->from_state),
+		ni_ifworker_state_name(w->fsm.next_action->next_state));
 
-			if (ni_ifworker_complete(w)) {
-				ni_ifworker_cancel_secondary_timeout(w);
-				ni_ifworker_cancel_timeout(w);
-				goto release;
-			}
+	if (!action->bound) {
+		ni_ifworker_fail(w, "failed to bind services and methods for %s()",
+				action->common.method_name);
+		return 0;
+	}
 
-			if (!w->kickstarted)
-				w->kickstarted = TRUE;
-
-			/* We requested a change that takes time (such as acquiring
-			 * a DHCP lease). Wait for a notification from wickedd */
-			if (w->fsm.wait_for) {
-				ni_debug_application("%s: state=%s want=%s, wait-for=%s", w->name,
-					ni_ifworker_state_name(w->fsm.state),
-					ni_ifworker_state_name(w->target_state),
-					ni_ifworker_state_name(w->fsm.wait_for->next_state));
-				goto release;
-			}
+	if (!ni_ifworker_check_dependencies(fsm, w, action)) {
+		ni_debug_application("%s: defer action (pending dependencies)", w->name);
+		return -1;
+	}
+
+	ni_ifworker_cancel_secondary_timeout(w);
+
+	prev_state = w->fsm.state;
+	ni_fsm_events_block(fsm);
 
-			action = w->fsm.next_action;
-			if (action->next_state == NI_FSM_STATE_NONE)
-				w->fsm.state = w->target_state;
+	rv = action->call_func(fsm, w, action);
+	if (w->fsm.next_action)
+		w->fsm.next_action++;
 
-			if (w->fsm.state == w->target_state) {
-				ni_ifworker_success(w);
-				made_progress = 1;
-				goto release;
-			}
+	if (rv >= 0) {
+		made_progress = 1;
 
-			ni_debug_application("%s: state=%s want=%s, next transition is %s -> %s", w->name,
+		if (w->fsm.wait_for) {
+			ni_debug_application("%s: waiting for event in state %s",
+				w->name, ni_ifworker_state_name(w->fsm.state));
+		} else {
+			ni_debug_application("%s: successfully transitioned from %s to %s",
+					w->name,
+					ni_ifworker_state_name(prev_state),
+					ni_ifworker_state_name(w->fsm.state));
+		}
+	} else
+	if (!w->failed) {
+		/* The fsm action should really have marked this
+		 * as a failure. shame on the lazy programmer. */
+		ni_ifworker_fail(w, "failed to transition from %s to %s",
+				ni_ifworker_state_name(prev_state),
+				ni_ifworker_state_name(action->next_state));
+	}
+
+	ni_fsm_process_events(fsm);
+	ni_fsm_events_unblock(fsm);
+
+	return made_progress;
+}
+
+/*
+ * Sort the workers into the ready queue and the list of workers
+ * waiting for an event.
+ */
+static void
+ni_fsm_schedule_queue_workers(ni_fsm_t *fsm, ni_ifworker_array_t *ready,
+				ni_ifworker_array_t *waiting)
+{
+	unsigned int i;
+
+	for (i = 0; i < fsm->workers.count; ++i) {
+		ni_ifworker_t *w = fsm->workers.data[i];
+
+		if (w->pending)
+			continue;
+
+		if (ni_ifworker_complete(w)) {
+			ni_ifworker_cancel_secondary_timeout(w);
+			ni_ifworker_cancel_timeout(w);
+			continue;
+		}
+
+		if (!w->kickstarted)
+			w->kickstarted = TRUE;
+
+		/* We requested a change that takes time (such as acquiring
+		 * a DHCP lease). Wait for a notification from wickedd */
+		if (w->fsm.wait_for) {
+			ni_debug_application("%s: state=%s want=%s, wait-for=%s", w->name,
 				ni_ifworker_state_name(w->fsm.state),
 				ni_ifworker_state_name(w->target_state),
-				ni_ifworker_state_name(w->fsm.next_action->from_state),
-				ni_ifworker_state_name(w->fsm.next_action->next_state));
+				ni_ifworker_state_name(w->fsm.wait_for->next_state));
+			ni_ifworker_array_append(waiting, w);
+		} else {
+			w->fsm.scheduled = TRUE;
+			ni_ifworker_array_append(ready, w);
+		}
+	}
+}
 
-			if (!action->bound) {
-				ni_ifworker_fail(w, "failed to bind services and methods for %s()",
-						action->common.method_name);
-				goto release;
-			}
+static ni_bool_t
+ni_fsm_schedule_add_dependent(ni_ifworker_t *w, ni_ifworker_t *dep,
+				ni_ifworker_array_t *owners)
+{
+	if (!w || w == dep)
+		return FALSE;
 
-			if (!ni_ifworker_check_dependencies(fsm, w, action)) {
-				ni_debug_application("%s: defer action (pending dependencies)", w->name);
-				goto release;
-			}
+	/* a complete worker does not change its state any more */
+	if (ni_ifworker_complete(w))
+		return TRUE;
 
-			ni_ifworker_cancel_secondary_timeout(w);
+	if (ni_ifworker_array_index(&w->fsm.dependents, dep) < 0) {
+		if (w->fsm.dependents.count == 0)
+			ni_ifworker_array_append(owners, w);
+		ni_ifworker_array_append(&w->fsm.dependents, dep);
+	}
+	return TRUE;
+}
 
-			prev_state = w->fsm.state;
-			ni_fsm_events_block(fsm);
+/*
+ * Register a worker deferred on its pending dependencies with the
+ * workers it is waiting for, so it is queued again as soon as one of
+ * them changes its state.
+ * Requirements we can't attribute to a worker (unresolved references,
+ * reachability checks, ...) put it on the unattributed list instead,
+ * which is queued again whenever any worker made progress.
+ */
+static void
+ni_fsm_schedule_block_worker(ni_ifworker_t *w, ni_ifworker_array_t *owners,
+				ni_ifworker_array_t *unattributed)
+{
+	ni_fsm_transition_t *action = w->fsm.next_action;
+	ni_ifworker_check_state_req_check_t *check;
+	ni_ifworker_check_state_req_t *csr;
+	ni_fsm_require_t *req;
+	unsigned int i, n = 0;
+
+	for (req = action->require.list; req; req = req->next) {
+		if (!(csr = ni_ifworker_check_state_req_cast(req))) {
+			/* resolved references do not block any more */
+			if (!req->user_data &&
+			    (req->test_fn == ni_fsm_require_netif_resolve ||
+			     req->test_fn == ni_fsm_require_modem_resolve ||
+			     req->test_fn == ni_ifworker_require_resolver_test))
+				continue;
 
-			rv = action->call_func(fsm, w, action);
-			if (w->fsm.next_action)
-				w->fsm.next_action++;
+			ni_ifworker_array_append(unattributed, w);
+			return;
+		}
 
-			if (rv >= 0) {
-				made_progress = 1;
+		/* unresolved checks are skipped by the test */
+		for (check = csr->check; check; check = check->next) {
+			if (ni_fsm_schedule_add_dependent(check->worker, w, owners))
+				n++;
+		}
+	}
+
+	if (ni_fsm_schedule_add_dependent(w->masterdev, w, owners))
+		n++;
+	if (ni_fsm_schedule_add_dependent(w->lowerdev, w, owners))
+		n++;
+	for (i = 0; i < w->children.count; ++i) {
+		if (ni_fsm_schedule_add_dependent(w->children.data[i], w, owners))
+			n++;
+	}
+
+	if (n == 0)
+		ni_ifworker_array_append(unattributed, w);
+}
+
+/*
+ * Queue deferred workers again after a worker they wait for changed
+ * its state. Workers deferred on several workers are queued once and
+ * the ones meanwhile moved on are skipped.
+ */
+static void
+ni_fsm_schedule_wake_workers(ni_ifworker_array_t *ready, ni_ifworker_array_t *deferred)
+{
+	ni_ifworker_t *w;
+	unsigned int i;
+
+	for (i = 0; i < deferred->count; ++i) {
+		w = deferred->data[i];
+		if (w->fsm.scheduled || w->fsm.wait_for || w->pending ||
+		    ni_ifworker_complete(w))
+			continue;
+
+		w->fsm.scheduled = TRUE;
+		ni_ifworker_array_append(ready, w);
+	}
+	ni_ifworker_array_destroy(deferred);
+}
 
-				if (w->fsm.wait_for) {
-					ni_debug_application("%s: waiting for event in state %s",
-						w->name, ni_ifworker_state_name(w->fsm.state));
+static void
+ni_fsm_schedule_reset_dependents(ni_ifworker_array_t *owners)
+{
+	unsigned int i;
+
+	for (i = 0; i < owners->count; ++i)
+		ni_ifworker_array_destroy(&owners->data[i]->fsm.dependents);
+	ni_ifworker_array_destroy(owners);
+}
+
+/*
+ * Instead of rescanning all workers until none of them makes progress
+ * any more, the workers are processed via a ready queue: a worker is
+ * queued again after it made progress, workers with pending dependencies
+ * when one of the workers they depend on changed its state and workers
+ * waiting for an event when the event arrived while we were processing
+ * the queue.
+ */
+unsigned int
+ni_fsm_schedule(ni_fsm_t *fsm)
+{
+	ni_ifworker_array_t ready = NI_IFWORKER_ARRAY_INIT;
+	ni_ifworker_array_t owners = NI_IFWORKER_ARRAY_INIT;
+	ni_ifworker_array_t unattributed = NI_IFWORKER_ARRAY_INIT;
+	ni_ifworker_array_t waiting = NI_IFWORKER_ARRAY_INIT;
+	unsigned int i, head, count, waiting_count, nrequested;
+	ni_bool_t rescan = TRUE;
+	ni_ifworker_t *w;
+	int rv;
+
+	while (rescan) {
+		rescan = FALSE;
+
+		ni_fsm_schedule_queue_workers(fsm, &ready, &waiting);
+		count = fsm->workers.count;
+
+		for (head = 0; head < ready.count; ) {
+			for (; head < ready.count; ++head) {
+				w = ni_ifworker_get(ready.data[head]);
+				w->fsm.scheduled = FALSE;
+
+				rv = ni_fsm_schedule_worker(fsm, w);
+				if (rv < 0) {
+					ni_fsm_schedule_block_worker(w, &owners, &unattributed);
 				} else {
-					ni_debug_application("%s: successfully transitioned from %s to %s",
-							w->name,
-							ni_ifworker_state_name(prev_state),
-							ni_ifworker_state_name(w->fsm.state));
+					/* state changed -- recheck the dependents */
+					if (rv > 0 || ni_ifworker_complete(w)) {
+						ni_fsm_schedule_wake_workers(&ready, &w->fsm.dependents);
+						ni_fsm_schedule_wake_workers(&ready, &unattributed);
+					}
+
+					if (w->pending || ni_ifworker_complete(w)) {
+						/* nothing more to do */
+					} else
+					if (w->fsm.wait_for) {
+						ni_ifworker_array_append(&waiting, w);
+					} else
+					if (rv > 0 && !w->fsm.scheduled) {
+						w->fsm.scheduled = TRUE;
+						ni_ifworker_array_append(&ready, w);
+					}
 				}
-			} else
-			if (!w->failed) {
-				/* The fsm action should really have marked this
-				 * as a failure. shame on the lazy programmer. */
-				ni_ifworker_fail(w, "failed to transition from %s to %s",
-						ni_ifworker_state_name(prev_state),
-						ni_ifworker_state_name(action->next_state));
+				ni_ifworker_release(w);
+
+				ni_dbus_objects_garbage_collect();
 			}
 
-			ni_fsm_process_events(fsm);
-			ni_fsm_events_unblock(fsm);
-release:
-			ni_ifworker_release(w);
+			/*
+			 * Workers completed as a side effect of another one
+			 * (e.g. failed with their parent) don't pass through
+			 * the queue -- wake up their dependents here.
+			 */
+			for (i = 0; i < owners.count; ++i) {
+				w = owners.data[i];
+				if (w->fsm.dependents.count && ni_ifworker_complete(w))
+					ni_fsm_schedule_wake_workers(&ready, &w->fsm.dependents);
+			}
+		}
 
-			ni_dbus_objects_garbage_collect();
+		/*
+		 * Workers, which got their event while we were processing
+		 * the ready queue or were created meanwhile need another run.
+		 */
+		for (i = waiting_count = 0; i < waiting.count; ++i) {
+			w = waiting.data[i];
+			if (!w->pending && !ni_ifworker_complete(w) && !w->fsm.wait_for)
+				waiting_count++;
 		}
+		if (waiting_count || count != fsm->workers.count)
+			rescan = TRUE;
 
-		if (!made_progress)
-			break;
+		ni_ifworker_array_destroy(&ready);
+		ni_ifworker_array_destroy(&unattributed);
+		ni_ifworker_array_destroy(&waiting);
+		ni_fsm_schedule_reset_dependents(&owners);
 
 		/* If all the requested workers are done (eg because they failed)
 		 * do not wait for any of the subordinate device which might still be
 		 * in the middle of being set up.
 		 */
-		for (i = nrequested = 0; i < fsm->workers.count; ++i) {
-			ni_ifworker_t *w = fsm->workers.data[i];
-
-			if (!ni_ifworker_complete(w))
+		for (i = nrequested = 0; rescan && i < fsm->workers.count; ++i) {
+			if (!ni_ifworker_complete(fsm->workers.data[i]))
 				nrequested++;
 		}
-
 		if (nrequested == 0)
-			break;
+			rescan = FALSE;
 	}
 
-	for (i = waiting = nrequested = 0; i < fsm->workers.count; ++i) {
-		ni_ifworker_t *w = fsm->workers.data[i];
+	for (i = waiting_count = nrequested = 0; i < fsm->workers.count; ++i) {
+		w = fsm->workers.data[i];
 
 		if (!ni_ifworker_complete(w) || w->pending) {
-			waiting++;
+			waiting_count++;
 			nrequested++;
 		}
 	}
 
-	ni_debug_application("waiting for %u devices to become ready (%u explicitly requested)", waiting, nrequested);
+	ni_debug_application("waiting for %u devices to become ready (%u explicitly requested)",
+			waiting_count, nrequested);
 	return nrequested;
 }
 
@@ -5245,7 +5245,12 @@ ni_address_updater_arp_open(ni_address_updater_t *au, ni_netdev_t *dev)
 		return FALSE;
 
 	au->sock = ni_arp_socket_open(&dev_info, ni_arp_verify_process, au);
-	return au->sock != NULL;
+	if (!au->sock)
+		return FALSE;
+
+	/* nothing to receive until there are addresses to verify */
+	ni_arp_socket_set_filter(au->sock, NULL, 0);
+	return TRUE;
 }
 
 static void
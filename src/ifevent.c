@@ -66,6 +66,48 @@ typedef struct ni_rtevent_handle
  */
 static ni_socket_t *	__ni_rtevent_sock;
 
+/*
+ * Devices with an obsolete name found while processing a read buffer.
+ */
+static ni_uint_array_t	__ni_rtevent_conflicts = NI_UINT_ARRAY_INIT;
+
+/*
+ * Device change and address update events are coalesced per interface
+ * while processing a read buffer (or within the configured coalescing
+ * window) and emitted once per interface when the batch is flushed.
+ * Device state transitions, renames, deletions and address deletions
+ * are emitted immediately.
+ */
+#define NI_RTEVENT_PENDING_BUCKETS	64
+
+typedef struct ni_rtevent_pending_addr	ni_rtevent_pending_addr_t;
+struct ni_rtevent_pending_addr {
+	ni_rtevent_pending_addr_t *	next;
+	ni_sockaddr_t			local_addr;
+};
+
+typedef struct ni_rtevent_pending	ni_rtevent_pending_t;
+struct ni_rtevent_pending {
+	ni_rtevent_pending_t *		next;
+	ni_rtevent_pending_t *		hnext;
+	unsigned int			ifindex;
+	ni_bool_t			changed;
+	ni_rtevent_pending_addr_t *	addrs;
+};
+
+static struct {
+	ni_bool_t			batch;
+	const ni_timer_t *		timer;
+	ni_rtevent_pending_t *		head;
+	ni_rtevent_pending_t **		tail;
+	ni_rtevent_pending_t *		bucket[NI_RTEVENT_PENDING_BUCKETS];
+} __ni_rtevent_pending = {
+	.batch	= FALSE,
+	.timer	= NULL,
+	.head	= NULL,
+	.tail	= &__ni_rtevent_pending.head,
+};
+
 static int	__ni_rtevent_process(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_newlink(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_dellink(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
@@ -77,6 +119,15 @@ static int	__ni_rtevent_delroute(ni_netconfig_t *, const struct sockaddr_nl *, s
 static int	__ni_rtevent_newrule(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_delrule(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_nduseropt(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
+static void	__ni_rtevent_conflict_add(unsigned int);
+static void	__ni_rtevent_conflict_drop(unsigned int);
+static void	__ni_rtevent_conflicts_resolve(ni_netconfig_t *);
+static ni_bool_t	__ni_rtevent_pending_change(const ni_netdev_t *);
+static ni_bool_t	__ni_rtevent_pending_addr(const ni_netdev_t *, const ni_address_t *);
+static void	__ni_rtevent_pending_addr_flush(ni_netdev_t *, const ni_sockaddr_t *);
+static void	__ni_rtevent_pending_drop(unsigned int);
+static void	__ni_rtevent_pending_flush(void);
+static unsigned int	__ni_rtevent_config_coalesce_window(void);
 
 
 /*
@@ -91,6 +142,17 @@ __ni_netdev_event(ni_netconfig_t *nc, ni_netdev_t *dev, ni_event_t ev)
 		ni_global.interface_event(dev, ev);
 }
 
+/*
+ * Notify about a change of the device state (link, addresses, routes,
+ * ...) applied from a netlink event or refresh, signalled or not.
+ */
+void
+__ni_netdev_modified(ni_netdev_t *dev)
+{
+	if (dev && ni_global.interface_modified)
+		ni_global.interface_modified(dev);
+}
+
 static inline void
 __ni_netdev_addr_event(ni_netdev_t *dev, ni_event_t ev, const ni_address_t *ap)
 {
@@ -247,10 +309,12 @@ __ni_netdev_process_events(ni_netconfig_t *nc, ni_netdev_t *dev, unsigned int ol
 
 	if (dev->deleted) {
 		dev->deleted = 0;
+		__ni_rtevent_pending_drop(dev->link.ifindex);
 		ni_uint_array_append(&events, NI_EVENT_DEVICE_DELETE);
 	} else
 	if (events.count == 0) {
-		__ni_netdev_event(nc, dev, NI_EVENT_DEVICE_CHANGE);
+		if (!__ni_rtevent_pending_change(dev))
+			__ni_netdev_event(nc, dev, NI_EVENT_DEVICE_CHANGE);
 	}
 
 	for (i = 0; i < events.count; ++i) {
@@ -267,7 +331,7 @@ int
 __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struct nlmsghdr *h)
 {
 	char namebuf[IF_NAMESIZE+1] = {'\0'};
-	ni_netdev_t *dev, *old;
+	ni_netdev_t *dev, *old, *conflict;
 	struct ifinfomsg *ifi;
 	struct nlattr *nla;
 	char *ifname = NULL;
@@ -279,30 +343,25 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 	if (ifi->ifi_family == AF_BRIDGE)
 		return 0;
 
-	old = ni_netdev_by_index(nc, ifi->ifi_index);
-	ifname = if_indextoname(ifi->ifi_index, namebuf);
-	if (!ifname) {
-		/*
-		 * device (index) does not exists any more;
-		 * process deletion/cleanup of the device.
-		 */
-		if (old) {
-			old_flags = old->link.ifflags;
-			old->link.ifflags = 0;
-			old->deleted = 1;
-
-			__ni_netdev_process_events(nc, old, old_flags);
-			ni_client_state_drop(old->link.ifindex);
-			ni_netconfig_device_remove(nc, old);
-		}
-		return 0;
+	if ((nla = nlmsg_find_attr(h, sizeof(*ifi), IFLA_IFNAME)) != NULL)
+		nla_strlcpy(namebuf, nla, sizeof(namebuf));
+	if (ni_string_empty(namebuf)) {
+		ni_warn("RTM_NEWLINK message for interface index %d without IFNAME",
+				ifi->ifi_index);
+		return -1;
 	}
+	ifname = namebuf;
+
+	/* This event provides the name of the device (again) */
+	__ni_rtevent_conflict_drop(ifi->ifi_index);
 
+	old = ni_netdev_by_index(nc, ifi->ifi_index);
 	if (old) {
 		if (!ni_string_eq(old->name, ifname)) {
 			ni_debug_events("%s[%u]: device renamed to %s",
 					old->name, old->link.ifindex, ifname);
 			ni_string_dup(&old->name, ifname);
+			ni_netconfig_device_index_update(nc, old);
 			__ni_netdev_event(nc, old, NI_EVENT_DEVICE_RENAME);
 		}
 		dev = old;
@@ -321,39 +380,23 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 		ni_error("Problem parsing RTM_NEWLINK message for %s", ifname);
 		return -1;
 	}
+	ni_netconfig_device_index_update(nc, dev);
+	__ni_netdev_modified(dev);
 
-	if ((ifname = dev->name)) {
-		ni_netdev_t *conflict;
-
-		conflict = ni_netdev_by_name(nc, ifname);
-		if (conflict && conflict->link.ifindex != (unsigned int)ifi->ifi_index) {
-			/*
-			 * As the events often provide an already obsolete name [2 events,
-			 * we process 1st with next in read buffer], we are reading the
-			 * current dev->name in advance (above).
-			 *
-			 * On a rename like eth0->rename1->eth1, eth1->rename2->eth0, the
-			 * current dev->name is already eth1 at processing time of eth0
-			 * to rename1 event. This sometimes causes that we find eth1 in
-			 * our device list [eth1 -> rename2 event in the read buffer].
-			 *
-			 * Just update the name of the conflicting device in advance too
-			 * and when the interface does not exist any more, emit events.
-			 */
-			char *current = if_indextoname(conflict->link.ifindex, namebuf);
-			if (current) {
-				ni_string_dup(&conflict->name, current);
-				__ni_netdev_event(nc, conflict, NI_EVENT_DEVICE_RENAME);
-			} else {
-				unsigned int ifflags = conflict->link.ifflags;
-				conflict->link.ifflags = 0;
-				conflict->deleted = 1;
-
-				__ni_netdev_process_events(nc, conflict, ifflags);
-				ni_client_state_drop(conflict->link.ifindex);
-				ni_netconfig_device_remove(nc, conflict);
-			}
-		}
+	if ((conflict = ni_netconfig_device_name_conflict(nc, dev))) {
+		/*
+		 * The events often provide a name, that is still in use by
+		 * another device in our list, e.g. on renames like
+		 * eth0->rename1->eth1, eth1->rename2->eth0 while the eth1 to
+		 * rename2 event is still in the read buffer.
+		 *
+		 * The name of the conflicting device is obsolete. Usually
+		 * the event renaming or deleting it follows, so we defer
+		 * to query its current name to the end of the read buffer.
+		 */
+		ni_debug_events("%s[%u]: name in use by device #%u, deferring name lookup",
+				dev->name, dev->link.ifindex, conflict->link.ifindex);
+		__ni_rtevent_conflict_add(conflict->link.ifindex);
 	}
 
 	__ni_netdev_process_events(nc, dev, old_flags);
@@ -364,6 +407,243 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 	return 0;
 }
 
+/*
+ * Query the current name of the devices with a name conflict
+ * not resolved by any later event in the read buffer.
+ */
+static void
+__ni_rtevent_conflict_add(unsigned int ifindex)
+{
+	if (!ni_uint_array_contains(&__ni_rtevent_conflicts, ifindex))
+		ni_uint_array_append(&__ni_rtevent_conflicts, ifindex);
+}
+
+static void
+__ni_rtevent_conflict_drop(unsigned int ifindex)
+{
+	if (__ni_rtevent_conflicts.count)
+		ni_uint_array_remove(&__ni_rtevent_conflicts, ifindex);
+}
+
+static void
+__ni_rtevent_conflicts_resolve(ni_netconfig_t *nc)
+{
+	char namebuf[IF_NAMESIZE+1];
+	unsigned int i, ifflags;
+	ni_netdev_t *dev;
+	char *current;
+
+	if (!__ni_rtevent_conflicts.count)
+		return;
+
+	for (i = 0; i < __ni_rtevent_conflicts.count; ++i) {
+		if (!nc || !(dev = ni_netdev_by_index(nc, __ni_rtevent_conflicts.data[i])))
+			continue;
+
+		if (!ni_netconfig_device_name_conflict(nc, dev))
+			continue;
+
+		memset(namebuf, 0, sizeof(namebuf));
+		if ((current = if_indextoname(dev->link.ifindex, namebuf))) {
+			if (ni_string_eq(dev->name, current))
+				continue;
+
+			ni_debug_events("%s[%u]: device renamed to %s",
+					dev->name, dev->link.ifindex, current);
+			ni_string_dup(&dev->name, current);
+			ni_netconfig_device_index_update(nc, dev);
+			__ni_netdev_event(nc, dev, NI_EVENT_DEVICE_RENAME);
+		} else {
+			ifflags = dev->link.ifflags;
+			dev->link.ifflags = 0;
+			dev->deleted = 1;
+
+			__ni_netdev_process_events(nc, dev, ifflags);
+			ni_client_state_drop(dev->link.ifindex);
+			ni_netconfig_device_remove(nc, dev);
+		}
+	}
+	ni_uint_array_destroy(&__ni_rtevent_conflicts);
+}
+
+/*
+ * Coalescing of device change and address update events
+ */
+static void
+__ni_rtevent_pending_timeout(void *user_data, const ni_timer_t *timer)
+{
+	if (__ni_rtevent_pending.timer != timer)
+		return;
+
+	__ni_rtevent_pending.timer = NULL;
+	__ni_rtevent_pending_flush();
+}
+
+static ni_rtevent_pending_t *
+__ni_rtevent_pending_get(unsigned int ifindex, ni_bool_t create)
+{
+	ni_rtevent_pending_t **pos, *p;
+	unsigned int window;
+
+	pos = &__ni_rtevent_pending.bucket[ifindex % NI_RTEVENT_PENDING_BUCKETS];
+	for (p = *pos; p; p = p->hnext) {
+		if (p->ifindex == ifindex)
+			return p;
+	}
+
+	/* outside of a read buffer without a window, emit immediately */
+	window = __ni_rtevent_config_coalesce_window();
+	if (!create || (!__ni_rtevent_pending.batch && !window))
+		return NULL;
+
+	p = xcalloc(1, sizeof(*p));
+	p->ifindex = ifindex;
+	p->hnext = *pos;
+	*pos = p;
+	*__ni_rtevent_pending.tail = p;
+	__ni_rtevent_pending.tail = &p->next;
+
+	if (window && !__ni_rtevent_pending.timer) {
+		__ni_rtevent_pending.timer = ni_timer_register(window,
+				__ni_rtevent_pending_timeout, NULL);
+	}
+	return p;
+}
+
+static void
+__ni_rtevent_pending_free(ni_rtevent_pending_t *p)
+{
+	ni_rtevent_pending_addr_t *pa;
+
+	while ((pa = p->addrs)) {
+		p->addrs = pa->next;
+		free(pa);
+	}
+	free(p);
+}
+
+static void
+__ni_rtevent_pending_unlink(ni_rtevent_pending_t *p)
+{
+	ni_rtevent_pending_t **pos, *cur;
+
+	pos = &__ni_rtevent_pending.bucket[p->ifindex % NI_RTEVENT_PENDING_BUCKETS];
+	for ( ; (cur = *pos); pos = &cur->hnext) {
+		if (cur == p) {
+			*pos = p->hnext;
+			break;
+		}
+	}
+	for (pos = &__ni_rtevent_pending.head; (cur = *pos); pos = &cur->next) {
+		if (cur == p) {
+			*pos = p->next;
+			break;
+		}
+	}
+	if (__ni_rtevent_pending.tail == &p->next)
+		__ni_rtevent_pending.tail = pos;
+}
+
+static ni_bool_t
+__ni_rtevent_pending_change(const ni_netdev_t *dev)
+{
+	ni_rtevent_pending_t *p;
+
+	if (!(p = __ni_rtevent_pending_get(dev->link.ifindex, TRUE)))
+		return FALSE;
+
+	p->changed = TRUE;
+	return TRUE;
+}
+
+static ni_bool_t
+__ni_rtevent_pending_addr(const ni_netdev_t *dev, const ni_address_t *ap)
+{
+	ni_rtevent_pending_addr_t *pa, **tail;
+	ni_rtevent_pending_t *p;
+
+	if (!ap || !(p = __ni_rtevent_pending_get(dev->link.ifindex, TRUE)))
+		return FALSE;
+
+	for (tail = &p->addrs; (pa = *tail); tail = &pa->next) {
+		if (ni_sockaddr_equal(&pa->local_addr, &ap->local_addr))
+			return TRUE;
+	}
+
+	pa = xcalloc(1, sizeof(*pa));
+	pa->local_addr = ap->local_addr;
+	*tail = pa;
+	return TRUE;
+}
+
+static void
+__ni_rtevent_pending_addr_emit(ni_netdev_t *dev, const ni_sockaddr_t *local_addr)
+{
+	ni_address_t *ap;
+
+	if ((ap = ni_address_list_find(dev->addrs, local_addr)))
+		__ni_netdev_addr_event(dev, NI_EVENT_ADDRESS_UPDATE, ap);
+}
+
+static void
+__ni_rtevent_pending_addr_flush(ni_netdev_t *dev, const ni_sockaddr_t *local_addr)
+{
+	ni_rtevent_pending_addr_t **pos, *pa;
+	ni_rtevent_pending_t *p;
+
+	if (!(p = __ni_rtevent_pending_get(dev->link.ifindex, FALSE)))
+		return;
+
+	for (pos = &p->addrs; (pa = *pos); pos = &pa->next) {
+		if (ni_sockaddr_equal(&pa->local_addr, local_addr)) {
+			*pos = pa->next;
+			__ni_rtevent_pending_addr_emit(dev, &pa->local_addr);
+			free(pa);
+			return;
+		}
+	}
+}
+
+static void
+__ni_rtevent_pending_drop(unsigned int ifindex)
+{
+	ni_rtevent_pending_t *p;
+
+	if (!(p = __ni_rtevent_pending_get(ifindex, FALSE)))
+		return;
+
+	__ni_rtevent_pending_unlink(p);
+	__ni_rtevent_pending_free(p);
+}
+
+static void
+__ni_rtevent_pending_flush(void)
+{
+	ni_rtevent_pending_addr_t *pa;
+	ni_rtevent_pending_t *p;
+	ni_netconfig_t *nc;
+	ni_netdev_t *dev;
+
+	if (__ni_rtevent_pending.timer) {
+		ni_timer_cancel(__ni_rtevent_pending.timer);
+		__ni_rtevent_pending.timer = NULL;
+	}
+
+	nc = ni_global_state_handle(0);
+	while ((p = __ni_rtevent_pending.head)) {
+		__ni_rtevent_pending_unlink(p);
+
+		if (nc && (dev = ni_netdev_by_index(nc, p->ifindex))) {
+			if (p->changed)
+				__ni_netdev_event(nc, dev, NI_EVENT_DEVICE_CHANGE);
+
+			for (pa = p->addrs; pa; pa = pa->next)
+				__ni_rtevent_pending_addr_emit(dev, &pa->local_addr);
+		}
+		__ni_rtevent_pending_free(p);
+	}
+}
+
 /*
  * Process DELLINK event
  */
@@ -386,6 +666,8 @@ __ni_rtevent_dellink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 		return 0;
 	}
 
+	__ni_rtevent_conflict_drop(ifi->ifi_index);
+
 	/* Open code interface removal. */
 	if ((dev = ni_netdev_by_index(nc, ifi->ifi_index)) == NULL) {
 		ni_debug_events("RTM_DELLINK message for unknown interface %s index %d",
@@ -448,6 +730,7 @@ __ni_rtevent_newprefix(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, str
 		ni_ipv6_ra_pinfo_free(pi);
 		return -1;
 	}
+	__ni_netdev_modified(dev);
 
 	if ((old = ni_ipv6_ra_pinfo_list_remove(&ipv6->radv.pinfo, pi)) != NULL) {
 		if (pi->valid_lft != NI_LIFETIME_EXPIRED) {
@@ -493,8 +776,10 @@ __ni_rtevent_newaddr(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 	 */
 	if (__ni_netdev_process_newaddr_event(dev, h, ifa, &ap) < 0)
 		return -1;
+	__ni_netdev_modified(dev);
 
-	__ni_netdev_addr_event(dev, NI_EVENT_ADDRESS_UPDATE, ap);
+	if (!__ni_rtevent_pending_addr(dev, ap))
+		__ni_netdev_addr_event(dev, NI_EVENT_ADDRESS_UPDATE, ap);
 	return 0;
 }
 
@@ -518,9 +803,14 @@ __ni_rtevent_deladdr(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 		return -1;
 	}
 
+	/* Emit a coalesced update of the address before its deletion */
+	__ni_rtevent_pending_addr_flush(dev, &tmp.local_addr);
+
 	/* Remove the address when we track it */
-	if ((ap = ni_address_list_find(dev->addrs, &tmp.local_addr)) != NULL)
+	if ((ap = ni_address_list_find(dev->addrs, &tmp.local_addr)) != NULL) {
 		__ni_address_list_remove(&dev->addrs, ap);
+		__ni_netdev_modified(dev);
+	}
 
 	/* Tentative IPv6 addresses are not exposed via NEWADDR events,
 	 * but in manuall address lookup / dump only.
@@ -549,7 +839,7 @@ __ni_rtevent_newroute(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, stru
 		return -1;
 
 	/* filter unwanted / unsupported  msgs */
-	if (ni_rtnl_route_filter_msg(rtm))
+	if (ni_rtnl_route_filter_msg(h, rtm))
 		return 1;
 
 	rp = ni_route_new();
@@ -573,6 +863,7 @@ __ni_rtevent_newroute(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, stru
 		ni_route_free(rp);
 		return -1;
 	}
+	__ni_netdev_modified(dev);
 
 	__ni_netinfo_route_event(nc, NI_EVENT_ROUTE_UPDATE, rp);
 	ni_route_free(rp);
@@ -591,7 +882,7 @@ __ni_rtevent_delroute(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, stru
 		return -1;
 
 	/* filter unwanted / unsupported  msgs */
-	if (ni_rtnl_route_filter_msg(rtm))
+	if (ni_rtnl_route_filter_msg(h, rtm))
 		return 1;
 
 	rp = ni_route_new();
@@ -609,6 +900,7 @@ __ni_rtevent_delroute(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, stru
 
 		__ni_netinfo_route_event(nc, NI_EVENT_ROUTE_DELETE, r);
 		ni_netconfig_route_del(nc, r, dev);
+		__ni_netdev_modified(dev);
 		break;
 	}
 
@@ -895,6 +1187,7 @@ __ni_rtevent_nduseropt(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, str
 
 	opt = (struct nd_opt_hdr *)(msg + 1);
 
+	__ni_netdev_modified(dev);
 	return __ni_rtevent_process_nd_radv_opts(dev, opt, msg->nduseropt_opts_len);
 }
 
@@ -940,9 +1233,15 @@ __ni_rtevent_receive(ni_socket_t *sock)
 	int ret;
 
 	if (handle && handle->nlsock) {
+		__ni_rtevent_pending.batch = TRUE;
 		do {
 			ret = nl_recvmsgs_default(handle->nlsock);
 		} while (ret == NLE_SUCCESS || ret == -NLE_INTR);
+		__ni_rtevent_pending.batch = FALSE;
+
+		__ni_rtevent_conflicts_resolve(ni_global_state_handle(0));
+		if (!__ni_rtevent_config_coalesce_window())
+			__ni_rtevent_pending_flush();
 
 		switch (ret) {
 		case NLE_SUCCESS:
@@ -1050,6 +1349,12 @@ __ni_rtevent_config_mesg_buff_len(void)
 	return ni_global.config ? ni_global.config->rtnl_event.mesg_buff_length : 0;
 }
 
+static unsigned int
+__ni_rtevent_config_coalesce_window(void)
+{
+	return ni_global.config ? ni_global.config->rtnl_event.coalesce_window : 0;
+}
+
 static ni_socket_t *
 __ni_rtevent_sock_open(void)
 {
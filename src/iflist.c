@@ -123,6 +123,47 @@ retry:
 	return rv;
 }
 
+/*
+ * Query netlink for the link info of one interface
+ */
+static inline int
+__ni_rtnl_query_link(struct ni_rtnl_info *qr, unsigned int ifindex)
+{
+	int rv;
+
+	ni_nlmsg_list_init(&qr->nlmsg_list);
+	rv = ni_nl_link_store(ifindex, &qr->nlmsg_list);
+	qr->entry = rv >= 0 ? qr->nlmsg_list.head : NULL;
+	return rv;
+}
+
+/*
+ * Query netlink for information of one interface, filtered by
+ * the kernel if supported; otherwise fall back to a full dump,
+ * which is filtered while iterating over the results.
+ */
+static inline int
+__ni_rtnl_query_ifindex(struct ni_rtnl_info *qr, int af, int type, unsigned int ifindex)
+{
+	int rv;
+
+	ni_nlmsg_list_init(&qr->nlmsg_list);
+retry:
+	rv = ni_nl_dump_store_ifindex(af, type, ifindex, &qr->nlmsg_list);
+	switch (rv) {
+	case NLE_SUCCESS:
+		qr->entry = qr->nlmsg_list.head;
+		break;
+	case -NLE_DUMP_INTR:
+		ni_nlmsg_list_destroy(&qr->nlmsg_list);
+		goto retry;
+	default:
+		ni_nlmsg_list_destroy(&qr->nlmsg_list);
+		return __ni_rtnl_query(qr, af, type);
+	}
+	return rv;
+}
+
 static inline struct nlmsghdr *
 __ni_rtnl_info_next(struct ni_rtnl_info *qr)
 {
@@ -163,13 +204,35 @@ ni_rtnl_query(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family
 	return 0;
 }
 
+/*
+ * Query link, addresses and routes of one interface only,
+ * avoiding to dump the whole system tables when possible.
+ * Note: the ipv6 link info dump can't be filtered by the
+ * kernel and isn't queried.
+ */
+static int
+ni_rtnl_query_interface(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family)
+{
+	memset(q, 0, sizeof(*q));
+	q->ifindex = ifindex;
+
+	if (__ni_rtnl_query_link(&q->link_info, ifindex) < 0
+	 || __ni_rtnl_query_ifindex(&q->addr_info, family, RTM_GETADDR, ifindex) < 0
+	 || __ni_rtnl_query_ifindex(&q->route_info, family, RTM_GETROUTE, ifindex) < 0) {
+		ni_rtnl_query_destroy(q);
+		return -1;
+	}
+
+	return 0;
+}
+
 static int
 ni_rtnl_query_link(struct ni_rtnl_query *q, unsigned int ifindex)
 {
 	memset(q, 0, sizeof(*q));
 	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK) < 0) {
+	if (__ni_rtnl_query_link(&q->link_info, ifindex) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -235,7 +298,7 @@ ni_rtnl_query_addr_info(struct ni_rtnl_query *q, unsigned int ifindex, unsigned
 	memset(q, 0, sizeof(*q));
 	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->addr_info, family, RTM_GETADDR) < 0) {
+	if (__ni_rtnl_query_ifindex(&q->addr_info, family, RTM_GETADDR, ifindex) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -262,11 +325,12 @@ ni_rtnl_query_next_addr_info(struct ni_rtnl_query *q, struct nlmsghdr **hp)
 }
 
 static int
-ni_rtnl_query_route_info(struct ni_rtnl_query *q, unsigned int family)
+ni_rtnl_query_route_info(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family)
 {
 	memset(q, 0, sizeof(*q));
+	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->route_info, family, RTM_GETROUTE) < 0) {
+	if (__ni_rtnl_query_ifindex(&q->route_info, family, RTM_GETROUTE, ifindex) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -367,20 +431,34 @@ ni_route_tables_reset_seq(ni_route_table_t *tab)
 static void
 ni_route_array_drop_by_seq(ni_netconfig_t *nc, ni_route_array_t *routes, unsigned int seq)
 {
-	unsigned int i;
+	ni_route_array_t dropped = NI_ROUTE_ARRAY_INIT;
+	unsigned int i, j;
 	ni_route_t *rp;
 
-	for (i = 0; i < routes->count; ) {
+	/*
+	 * Compact the array in one pass instead of moving the tail
+	 * for each dropped route; the bumped generation outdates the
+	 * route table index, which gets rebuilt once only.
+	 */
+	for (i = j = 0; i < routes->count; ++i) {
 		rp = routes->data[i];
-		if (rp->seq != seq) {
-			if (ni_route_array_remove(routes, i) == rp) {
-				ni_netconfig_route_del(nc, rp, NULL);
-				ni_route_free(rp);
-				continue;
-			}
-		}
-		i++;
+		if (rp->seq != seq && ni_route_array_append(&dropped, rp))
+			continue;
+		routes->data[j++] = rp;
 	}
+	for (i = j; i < routes->count; ++i)
+		routes->data[i] = NULL;
+	if (routes->count != j)
+		routes->gen++;
+	routes->count = j;
+
+	for (i = 0; i < dropped.count; ++i) {
+		rp = dropped.data[i];
+		dropped.data[i] = NULL;
+		ni_netconfig_route_del(nc, rp, NULL);
+		ni_route_free(rp);
+	}
+	ni_route_array_destroy(&dropped);
 }
 
 static void
@@ -577,6 +655,7 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 			/* FIXME: use ni_netconfig_device_append() */
 			*tail = dev;
 			tail = &dev->next;
+			ni_netconfig_device_index_add(nc, dev);
 		} else {
 			if (!ni_string_eq(dev->name, ifname))
 				ni_string_dup(&dev->name, ifname);
@@ -590,6 +669,8 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 
 		if (__ni_netdev_process_newlink(dev, h, ifi, nc) < 0)
 			ni_error("Problem parsing RTM_NEWLINK message for %s", ifname);
+
+		ni_netconfig_device_index_update(nc, dev);
 	}
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
@@ -640,6 +721,7 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 		ni_route_tables_drop_by_seq(nc, dev->routes, seqno);
 		if (dev->seq != seqno) {
 			*tail = dev->next;
+			ni_netconfig_device_index_del(nc, dev);
 			if (del_list == NULL) {
 				__ni_refresh_unbind_master(nc, dev);
 				ni_client_state_drop(dev->link.ifindex);
@@ -650,6 +732,7 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 				del_list = &dev->next;
 			}
 		} else {
+			__ni_netdev_modified(dev);
 			tail = &dev->next;
 		}
 	}
@@ -685,7 +768,7 @@ __ni_system_refresh_interface(ni_netconfig_t *nc, ni_netdev_t *dev)
 		__ni_global_seqno++;
 	} while (!__ni_global_seqno);
 
-	if (ni_rtnl_query(&query, dev->link.ifindex, ni_netconfig_get_family_filter(nc)) < 0)
+	if (ni_rtnl_query_interface(&query, dev->link.ifindex, ni_netconfig_get_family_filter(nc)) < 0)
 		goto failed;
 
 	dev->seq = 0;
@@ -713,6 +796,8 @@ __ni_system_refresh_interface(ni_netconfig_t *nc, ni_netdev_t *dev)
 
 		if (__ni_netdev_process_newlink(dev, h, ifi, nc) < 0)
 			ni_error("Problem parsing RTM_NEWLINK message for %s", dev->name);
+
+		ni_netconfig_device_index_update(nc, dev);
 	}
 
 	while (1) {
@@ -736,6 +821,7 @@ __ni_system_refresh_interface(ni_netconfig_t *nc, ni_netdev_t *dev)
 			ni_error("Problem parsing RTM_NEWROUTE message");
 	}
 	ni_route_tables_drop_by_seq(nc, dev->routes, dev->seq);
+	__ni_netdev_modified(dev);
 
 	res = 0;
 
@@ -786,8 +872,10 @@ __ni_system_refresh_addrs(ni_netconfig_t *nc, unsigned int family)
 			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
 	}
 
-	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
 		ni_address_list_drop_by_seq(&dev->addrs, seqno);
+		__ni_netdev_modified(dev);
+	}
 
 	res = 0;
 
@@ -825,6 +913,7 @@ __ni_system_refresh_interface_addrs(ni_netconfig_t *nc, ni_netdev_t *dev)
 			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
 	}
 	ni_address_list_drop_by_seq(&dev->addrs, dev->seq);
+	__ni_netdev_modified(dev);
 
 	res = 0;
 
@@ -890,7 +979,7 @@ __ni_system_refresh_routes(ni_netconfig_t *nc)
 		seqno = ++__ni_global_seqno;
 	} while (!seqno);
 
-	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
+	if (ni_rtnl_query_route_info(&query, 0, ni_netconfig_get_family_filter(nc)) < 0)
 		goto failed;
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
@@ -906,8 +995,10 @@ __ni_system_refresh_routes(ni_netconfig_t *nc)
 			ni_error("Problem parsing RTM_NEWROUTE message");
 	}
 
-	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
 		ni_route_tables_drop_by_seq(nc, dev->routes, seqno);
+		__ni_netdev_modified(dev);
+	}
 
 	res = 0;
 
@@ -931,7 +1022,7 @@ __ni_system_refresh_interface_routes(ni_netconfig_t *nc, ni_netdev_t *dev)
 		dev->seq = ++__ni_global_seqno;
 	} while (!dev->seq);
 
-	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
+	if (ni_rtnl_query_route_info(&query, dev->link.ifindex, ni_netconfig_get_family_filter(nc)) < 0)
 		goto failed;
 
 	ni_route_tables_reset_seq(dev->routes);
@@ -945,6 +1036,7 @@ __ni_system_refresh_interface_routes(ni_netconfig_t *nc, ni_netdev_t *dev)
 			ni_error("Problem parsing RTM_NEWROUTE message");
 	}
 	ni_route_tables_drop_by_seq(nc, dev->routes, dev->seq);
+	__ni_netdev_modified(dev);
 
 	res = 0;
 
@@ -987,6 +1079,9 @@ __ni_device_refresh_link_info(ni_netconfig_t *nc, ni_linkinfo_t *link)
 		}
 	}
 
+	if (dev && &dev->link == link)
+		ni_netconfig_device_index_update(nc, dev);
+
 done:
 	ni_rtnl_query_destroy(&query);
 	return rv;
@@ -1852,8 +1947,9 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 
 	/* Note: we explicitly update name on query/event as needed
 	 * before this function is called. While event processing,
-	 * we explicitely query the current name to avoid an update
-	 * to an already obsolete name provided in the event data.
+	 * the current name of devices whose name became obsolete
+	 * is queried at the end of the read buffer when no later
+	 * event provided it.
 	 * Thus just update device name in case it is missed.
 	 */
 	if (ni_string_empty(dev->name)) {
@@ -2963,8 +3059,21 @@ __ni_netdev_process_newaddr(ni_netdev_t *dev, struct nlmsghdr *h, struct ifaddrm
 	return __ni_netdev_process_newaddr_event(dev, h, ifa, NULL);
 }
 
+static ni_bool_t
+ni_rtnl_route_filter_ignored(struct nlmsghdr *h, struct rtmsg *rtm)
+{
+	unsigned int table = rtm->rtm_table;
+	struct nlattr *nla;
+
+	if (table == RT_TABLE_COMPAT && h &&
+	    (nla = nlmsg_find_attr(h, sizeof(*rtm), RTA_TABLE)))
+		table = nla_get_u32(nla);
+
+	return ni_config_route_filter_ignored(table, rtm->rtm_protocol);
+}
+
 ni_bool_t
-ni_rtnl_route_filter_msg(struct rtmsg *rtm)
+ni_rtnl_route_filter_msg(struct nlmsghdr *h, struct rtmsg *rtm)
 {
 	switch (rtm->rtm_family) {
 	case AF_INET:
@@ -3016,6 +3125,10 @@ ni_rtnl_route_filter_msg(struct rtmsg *rtm)
 	if (rtm->rtm_flags & RTM_F_CLONED)
 		return TRUE;
 
+	/* routes in tables or by protocols we've been told to ignore */
+	if (ni_rtnl_route_filter_ignored(h, rtm))
+		return TRUE;
+
 	return FALSE;
 }
 
@@ -3233,7 +3346,7 @@ __ni_netdev_process_newroute(ni_netdev_t *dev, struct nlmsghdr *h,
 #endif
 
 	/* filter unwanted / unsupported  msgs */
-	if (ni_rtnl_route_filter_msg(rtm))
+	if (ni_rtnl_route_filter_msg(h, rtm))
 		return 1;
 
 	rp = ni_route_new();
@@ -46,6 +46,13 @@
 # define SIOCETHTOOL	0x8946
 #endif
 
+#ifndef SOL_NETLINK
+# define SOL_NETLINK		270
+#endif
+#ifndef NETLINK_GET_STRICT_CHK
+# define NETLINK_GET_STRICT_CHK	12
+#endif
+
 ni_netlink_t *		__ni_global_netlink;
 int			__ni_global_iocfd = -1;
 
@@ -533,31 +540,18 @@ __ni_nl_dump_valid(struct nl_msg *msg, void *p)
 }
 
 /*
- * Issue a DUMP request and store all replies in list
+ * Receive all replies to a DUMP request and store them in list
  */
-int
-ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+static int
+__ni_nl_dump_recv(struct nl_sock *nl_sock, const char *name, struct ni_nlmsg_list *list)
 {
-	struct nl_sock *nl_sock;
 	struct __ni_nl_dump_state data = {
 		.msg_type = -1,
 		.list = list,
 	};
 	struct nl_cb *cb;
-	const char *name;
 	int rv;
 
-	name = ni_rtnl_msg_type_to_name(type, __func__);
-	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
-		ni_error("%s: no netlink socket", name);
-		return -NLE_BAD_SOCK;
-	}
-
-	if ((rv = nl_rtgen_request(nl_sock, type, af, NLM_F_DUMP)) < 0) {
-		ni_error("%s: failed to send request", name);
-		return rv;
-	}
-
 	if (!(cb = __ni_nl_cb_clone(__ni_global_netlink)))
 		return -NLE_NOMEM;
 
@@ -587,6 +581,175 @@ retry:
 	return rv;
 }
 
+/*
+ * Issue a DUMP request and store all replies in list
+ */
+int
+ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+{
+	struct nl_sock *nl_sock;
+	const char *name;
+	int rv;
+
+	name = ni_rtnl_msg_type_to_name(type, __func__);
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", name);
+		return -NLE_BAD_SOCK;
+	}
+
+	if ((rv = nl_rtgen_request(nl_sock, type, af, NLM_F_DUMP)) < 0) {
+		ni_error("%s: failed to send request", name);
+		return rv;
+	}
+
+	return __ni_nl_dump_recv(nl_sock, name, list);
+}
+
+/*
+ * Kernels >= 4.20 are able to filter address and route dumps
+ * by interface index, when the request has been sent using a
+ * socket with NETLINK_GET_STRICT_CHK enabled. We enable it on
+ * the global socket only while sending such requests, because
+ * the strict check rejects the short rtgenmsg dump requests.
+ */
+static int	__ni_nl_strict_chk_supported = -1;
+
+static ni_bool_t
+__ni_nl_set_strict_chk(struct nl_sock *nl_sock, ni_bool_t enable)
+{
+	int fd, val = enable ? 1 : 0;
+
+	if (!__ni_nl_strict_chk_supported)
+		return FALSE;
+
+	fd = nl_socket_get_fd(nl_sock);
+	if (setsockopt(fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &val, sizeof(val)) < 0) {
+		if (__ni_nl_strict_chk_supported < 0) {
+			ni_debug_socket("netlink strict checking not supported: %m");
+			__ni_nl_strict_chk_supported = 0;
+		} else {
+			ni_warn("unable to %s netlink strict checking: %m",
+					enable ? "enable" : "disable");
+		}
+		return FALSE;
+	}
+	__ni_nl_strict_chk_supported = 1;
+	return TRUE;
+}
+
+/*
+ * Issue a DUMP request filtered by the kernel to the specified
+ * interface index and store all replies in list.
+ * Returns -NLE_OPNOTSUPP when the kernel does not support it,
+ * so the caller can fall back to an unfiltered dump.
+ */
+int
+ni_nl_dump_store_ifindex(int af, int type, unsigned int ifindex, struct ni_nlmsg_list *list)
+{
+	struct nl_sock *nl_sock;
+	struct nl_msg *msg;
+	const char *name;
+	int rv;
+
+	name = ni_rtnl_msg_type_to_name(type, __func__);
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", name);
+		return -NLE_BAD_SOCK;
+	}
+
+	if (!ifindex || !__ni_nl_strict_chk_supported)
+		return -NLE_OPNOTSUPP;
+
+	if (!(msg = nlmsg_alloc_simple(type, NLM_F_DUMP)))
+		return -NLE_NOMEM;
+
+	switch (type) {
+	case RTM_GETADDR: {
+			struct ifaddrmsg ifa;
+
+			memset(&ifa, 0, sizeof(ifa));
+			ifa.ifa_family = af;
+			ifa.ifa_index = ifindex;
+			if ((rv = nlmsg_append(msg, &ifa, sizeof(ifa), NLMSG_ALIGNTO)) < 0)
+				goto failed;
+		}
+		break;
+
+	case RTM_GETROUTE: {
+			struct rtmsg rtm;
+
+			memset(&rtm, 0, sizeof(rtm));
+			rtm.rtm_family = af;
+			if ((rv = nlmsg_append(msg, &rtm, sizeof(rtm), NLMSG_ALIGNTO)) < 0)
+				goto failed;
+			NLA_PUT_U32(msg, RTA_OIF, ifindex);
+		}
+		break;
+
+	default:
+		rv = -NLE_OPNOTSUPP;
+		goto failed;
+	}
+
+	if (!__ni_nl_set_strict_chk(nl_sock, TRUE)) {
+		rv = -NLE_OPNOTSUPP;
+		goto failed;
+	}
+	rv = nl_send_auto(nl_sock, msg);
+	__ni_nl_set_strict_chk(nl_sock, FALSE);
+
+	if (rv < 0) {
+		ni_error("%s: failed to send request", name);
+		goto failed;
+	}
+	nlmsg_free(msg);
+
+	return __ni_nl_dump_recv(nl_sock, name, list);
+
+nla_put_failure:
+	rv = -NLE_NOMEM;
+failed:
+	nlmsg_free(msg);
+	return rv;
+}
+
+/*
+ * Issue a RTM_GETLINK request for a single interface index
+ * and store the reply in list.
+ */
+int
+ni_nl_link_store(unsigned int ifindex, struct ni_nlmsg_list *list)
+{
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+	int rv;
+
+	if (!ifindex)
+		return -NLE_INVAL;
+
+	if (!(msg = nlmsg_alloc_simple(RTM_GETLINK, NLM_F_REQUEST)))
+		return -NLE_NOMEM;
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_index = ifindex;
+	if ((rv = nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO)) < 0)
+		goto failed;
+
+	rv = ni_nl_talk(msg, list);
+	if (rv == -NLE_NODEV) {
+		/* device vanished: same as an empty dump result */
+		rv = NLE_SUCCESS;
+	} else if (rv < 0) {
+		ni_debug_socket("RTM_GETLINK: request for ifindex %u failed: %s",
+				ifindex, nl_geterror(rv));
+	}
+
+failed:
+	nlmsg_free(msg);
+	return rv;
+}
+
 /*
  * Send a message and capture the response message(s)
  */
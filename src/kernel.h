@@ -74,6 +74,9 @@ struct ni_nlmsg_list {
 
 extern int	ni_nl_talk(struct nl_msg *, struct ni_nlmsg_list *);
 extern int	ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list);
+extern int	ni_nl_dump_store_ifindex(int af, int type, unsigned int ifindex,
+					struct ni_nlmsg_list *list);
+extern int	ni_nl_link_store(unsigned int ifindex, struct ni_nlmsg_list *list);
 
 extern void	ni_nlmsg_list_init(struct ni_nlmsg_list *);
 extern void	ni_nlmsg_list_destroy(struct ni_nlmsg_list *);
@@ -126,7 +129,7 @@ ni_rtnl_nduseroptmsg(struct nlmsghdr *h, int expected_type)
 	return __ni_rtnl_msgdata(h, expected_type, sizeof(struct nduseroptmsg));
 }
 
-extern ni_bool_t	ni_rtnl_route_filter_msg(struct rtmsg *);
+extern ni_bool_t	ni_rtnl_route_filter_msg(struct nlmsghdr *, struct rtmsg *);
 extern int	ni_rtnl_route_parse_msg(struct nlmsghdr *, struct rtmsg *, ni_route_t *);
 extern int	ni_rtnl_rule_parse_msg(struct nlmsghdr *, struct fib_rule_hdr *, ni_rule_t *);
 
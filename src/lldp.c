@@ -724,39 +724,40 @@ ni_lldp_agent_update(ni_lldp_agent_t *agent, ni_lldp_t *lldp, const void *raw_id
  * LLDP receive handling
  */
 static void
-ni_lldp_receive(ni_socket_t *sock)
+ni_lldp_process(ni_capture_t *capture, ni_buffer_t *buf, ni_sockaddr_t *from)
 {
-	ni_capture_t *capture = sock->user_data;
-	ni_sockaddr_t from;
-	ni_buffer_t buf;
+	ni_lldp_agent_t *agent = ni_capture_get_user_data(capture);
+	ni_buffer_t raw_id_buf;
+	const void *raw_id;
+	unsigned int raw_id_len;
+	ni_lldp_t *lldp;
 
 	/* FIXME: we need to store the MAC address we received this packet from.
 	 * This is needed for DCBX tie-breaking among other things. */
-	if (ni_capture_recv(capture, &buf, &from, "lldp") >= 0) {
-		ni_lldp_agent_t *agent = ni_capture_get_user_data(capture);
-		ni_buffer_t raw_id_buf;
-		const void *raw_id;
-		unsigned int raw_id_len;
-		ni_lldp_t *lldp;
-
-		/* Get the chassis and port ID TLVs as a raw string
-		 * of bytes. */
-		raw_id_buf = buf;
-		if (ni_lldp_pdu_get_raw_id(&raw_id_buf, &raw_id, &raw_id_len) < 0)
-			return;
-
-		lldp = ni_lldp_new();
-		if (ni_lldp_pdu_parse(lldp, &buf) < 0) {
-			ni_debug_lldp("%s: failed to parse LLDP PDU", agent->dev->name);
-			ni_lldp_free(lldp);
-			return;
-		}
 
-		ni_lldp_agent_update(agent, lldp, raw_id, raw_id_len);
+	/* Get the chassis and port ID TLVs as a raw string
+	 * of bytes. */
+	raw_id_buf = *buf;
+	if (ni_lldp_pdu_get_raw_id(&raw_id_buf, &raw_id, &raw_id_len) < 0)
+		return;
+
+	lldp = ni_lldp_new();
+	if (ni_lldp_pdu_parse(lldp, buf) < 0) {
+		ni_debug_lldp("%s: failed to parse LLDP PDU", agent->dev->name);
+		ni_lldp_free(lldp);
+		return;
 	}
 
+	ni_lldp_agent_update(agent, lldp, raw_id, raw_id_len);
 }
 
+static void
+ni_lldp_receive(ni_socket_t *sock)
+{
+	ni_capture_recv_batch(sock->user_data, ni_lldp_process, "lldp");
+}
+
+
 /*
  * Handling of IEEE 802.1 org-specific information
  */
@@ -42,10 +42,47 @@ typedef struct ni_netconfig_filter {
 	unsigned int		discover;
 } ni_netconfig_filter_t;
 
+/*
+ * Hash indexes of the interface list to find a device by
+ * its ifindex, name or link-layer address in constant time.
+ * Each device in the list has one node, chained into a bucket
+ * of each index using the keys it has been (re)indexed with.
+ */
+enum {
+	NI_NETDEV_INDEX_IFINDEX,
+	NI_NETDEV_INDEX_NAME,
+	NI_NETDEV_INDEX_HWADDR,
+
+	NI_NETDEV_INDEX_MAX
+};
+
+#define NI_NETDEV_INDEX_SIZE_MIN	64
+
+typedef struct ni_netdev_index_node	ni_netdev_index_node_t;
+
+struct ni_netdev_index_node {
+	ni_netdev_index_node_t *next[NI_NETDEV_INDEX_MAX];
+
+	ni_netdev_t *		dev;
+	unsigned int		order;
+
+	unsigned int		ifindex;
+	char *			name;
+	ni_hwaddr_t		hwaddr;
+};
+
+typedef struct ni_netdev_index {
+	unsigned int		size;
+	unsigned int		count;
+	unsigned int		order;
+	ni_netdev_index_node_t **bucket[NI_NETDEV_INDEX_MAX];
+} ni_netdev_index_t;
+
 struct ni_netconfig {
 	ni_netconfig_filter_t	filter;
 
 	ni_netdev_t *		interfaces;
+	ni_netdev_index_t	index;
 	ni_modem_t *		modems;
 
 	struct {
@@ -399,6 +436,12 @@ ni_server_listen_other_events(void (*event_handler)(ni_event_t))
 	ni_global.other_event = event_handler;
 }
 
+void
+ni_server_listen_interface_changes(void (*change_handler)(ni_netdev_t *))
+{
+	ni_global.interface_modified = change_handler;
+}
+
 ni_dbus_server_t *
 ni_server_listen_dbus(const char *dbus_name)
 {
@@ -427,11 +470,21 @@ ni_create_dbus_client(const char *dbus_name)
 	return ni_dbus_client_open(ni_global.config->dbus_type, dbus_name);
 }
 
+/*
+ * The schema is loaded from a compiled cache in the state directory
+ * when it is up to date, and the cache is (re)written otherwise.
+ */
+#define NI_XS_SCHEMA_CACHE	"schema.cache"
+
 ni_xs_scope_t *
 ni_server_dbus_xml_schema(void)
 {
 	const char *filename = ni_global.config->dbus_xml_schema_file;
+	const char *statedir = ni_global.config->statedir.path;
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	char *cachefile = NULL;
 	ni_xs_scope_t *scope;
+	unsigned int nbuiltin;
 
 	if (filename == NULL) {
 		ni_error("Cannot create dbus xml schema: no schema path configured");
@@ -439,12 +492,34 @@ ni_server_dbus_xml_schema(void)
 	}
 
 	scope = ni_dbus_xml_init();
-	if (ni_xs_process_schema_file(filename, scope) < 0) {
+	if (ni_isdir(statedir))
+		ni_string_printf(&cachefile, "%s/%s", statedir, NI_XS_SCHEMA_CACHE);
+
+	if (cachefile) {
+		switch (ni_xs_cache_load(cachefile, filename, scope)) {
+		case 0:
+			ni_string_free(&cachefile);
+			return scope;
+		case -1:
+			break;
+		default:
+			ni_xs_scope_free(scope);
+			scope = ni_dbus_xml_init();
+			break;
+		}
+	}
+
+	nbuiltin = scope->types.count;
+	if (ni_xs_process_schema_file_tracked(filename, scope, &files) < 0) {
 		ni_error("Cannot create dbus xml schema: error in schema definition");
 		ni_xs_scope_free(scope);
-		return NULL;
+		scope = NULL;
+	} else if (cachefile) {
+		ni_xs_cache_save(cachefile, filename, &files, scope, nbuiltin);
 	}
 
+	ni_string_array_destroy(&files);
+	ni_string_free(&cachefile);
 	return scope;
 }
 
@@ -516,9 +591,12 @@ ni_netconfig_init(ni_netconfig_t *nc)
 	memset(nc, 0, sizeof(*nc));
 }
 
+static void		ni_netdev_index_destroy(ni_netdev_index_t *);
+
 void
 ni_netconfig_destroy(ni_netconfig_t *nc)
 {
+	ni_netdev_index_destroy(&nc->index);
 	__ni_netdev_list_destroy(&nc->interfaces);
 	ni_rule_array_destroy(&nc->route.rules);
 	memset(nc, 0, sizeof(*nc));
@@ -579,6 +657,7 @@ void
 ni_netconfig_device_append(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
 	__ni_netdev_list_append(&nc->interfaces, dev);
+	ni_netconfig_device_index_add(nc, dev);
 }
 
 static inline void
@@ -600,6 +679,7 @@ ni_netconfig_device_remove(ni_netconfig_t *nc, ni_netdev_t *dev)
 	for (pos = &nc->interfaces; (cur = *pos) != NULL; pos = &cur->next) {
 		if (cur == dev) {
 			*pos = cur->next;
+			ni_netconfig_device_index_del(nc, cur);
 			ni_netconfig_device_unbind_slave_index(nc, cur->link.ifindex);
 			ni_netdev_put(cur);
 			return;
@@ -607,6 +687,227 @@ ni_netconfig_device_remove(ni_netconfig_t *nc, ni_netdev_t *dev)
 	}
 }
 
+/*
+ * Maintain the device list hash indexes
+ */
+static inline unsigned int
+ni_netdev_index_hash_name(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (name && *name)
+		hash = ((hash << 5) + hash) + (unsigned char)*name++;
+	return hash;
+}
+
+static inline unsigned int
+ni_netdev_index_hash_hwaddr(const ni_hwaddr_t *hwa)
+{
+	unsigned int hash = 5381 ^ hwa->type;
+	unsigned int i;
+
+	for (i = 0; i < hwa->len && i < sizeof(hwa->data); ++i)
+		hash = ((hash << 5) + hash) + hwa->data[i];
+	return hash;
+}
+
+static ni_bool_t
+ni_netdev_index_node_key(const ni_netdev_index_node_t *node, unsigned int type,
+			unsigned int *hash)
+{
+	switch (type) {
+	case NI_NETDEV_INDEX_IFINDEX:
+		*hash = node->ifindex;
+		return TRUE;
+	case NI_NETDEV_INDEX_NAME:
+		if (ni_string_empty(node->name))
+			return FALSE;
+		*hash = ni_netdev_index_hash_name(node->name);
+		return TRUE;
+	case NI_NETDEV_INDEX_HWADDR:
+		if (!node->hwaddr.len)
+			return FALSE;
+		*hash = ni_netdev_index_hash_hwaddr(&node->hwaddr);
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static void
+ni_netdev_index_link(ni_netdev_index_t *index, unsigned int type, ni_netdev_index_node_t *node)
+{
+	ni_netdev_index_node_t **head;
+	unsigned int hash;
+
+	node->next[type] = NULL;
+	if (!ni_netdev_index_node_key(node, type, &hash))
+		return;
+
+	head = &index->bucket[type][hash & (index->size - 1)];
+	node->next[type] = *head;
+	*head = node;
+}
+
+static void
+ni_netdev_index_unlink(ni_netdev_index_t *index, unsigned int type, ni_netdev_index_node_t *node)
+{
+	ni_netdev_index_node_t **pos, *cur;
+	unsigned int hash;
+
+	if (!ni_netdev_index_node_key(node, type, &hash))
+		return;
+
+	pos = &index->bucket[type][hash & (index->size - 1)];
+	for ( ; (cur = *pos) != NULL; pos = &cur->next[type]) {
+		if (cur == node) {
+			*pos = node->next[type];
+			node->next[type] = NULL;
+			return;
+		}
+	}
+}
+
+static void
+ni_netdev_index_resize(ni_netdev_index_t *index, unsigned int size)
+{
+	ni_netdev_index_node_t **old = index->bucket[NI_NETDEV_INDEX_IFINDEX];
+	ni_netdev_index_node_t *node, *next;
+	unsigned int osize = index->size;
+	unsigned int i, type;
+
+	for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type) {
+		if (type != NI_NETDEV_INDEX_IFINDEX)
+			free(index->bucket[type]);
+		index->bucket[type] = xcalloc(size, sizeof(node));
+	}
+	index->size = size;
+
+	/* every node is chained exactly once in the ifindex buckets */
+	for (i = 0; i < osize; ++i) {
+		for (node = old[i]; node; node = next) {
+			next = node->next[NI_NETDEV_INDEX_IFINDEX];
+			for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type)
+				ni_netdev_index_link(index, type, node);
+		}
+	}
+	free(old);
+}
+
+static void
+ni_netdev_index_destroy(ni_netdev_index_t *index)
+{
+	ni_netdev_index_node_t *node;
+	unsigned int i, type;
+
+	for (i = 0; i < index->size; ++i) {
+		while ((node = index->bucket[NI_NETDEV_INDEX_IFINDEX][i])) {
+			index->bucket[NI_NETDEV_INDEX_IFINDEX][i] = node->next[NI_NETDEV_INDEX_IFINDEX];
+			ni_netdev_put(node->dev);
+			ni_string_free(&node->name);
+			free(node);
+		}
+	}
+	for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type)
+		free(index->bucket[type]);
+	memset(index, 0, sizeof(*index));
+}
+
+static ni_netdev_index_node_t *
+ni_netdev_index_find_node(const ni_netdev_index_t *index, const ni_netdev_t *dev)
+{
+	ni_netdev_index_node_t *node;
+
+	if (!index->size)
+		return NULL;
+
+	node = index->bucket[NI_NETDEV_INDEX_IFINDEX][dev->link.ifindex & (index->size - 1)];
+	for ( ; node; node = node->next[NI_NETDEV_INDEX_IFINDEX]) {
+		if (node->dev == dev)
+			return node;
+	}
+	return NULL;
+}
+
+void
+ni_netconfig_device_index_add(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	ni_netdev_index_t *index = &nc->index;
+	ni_netdev_index_node_t *node;
+	unsigned int type;
+
+	if ((node = ni_netdev_index_find_node(index, dev))) {
+		ni_netconfig_device_index_update(nc, dev);
+		return;
+	}
+
+	if (index->count >= index->size) {
+		ni_netdev_index_resize(index, index->size ?
+				index->size << 1 : NI_NETDEV_INDEX_SIZE_MIN);
+	}
+
+	node = xcalloc(1, sizeof(*node));
+	node->dev = ni_netdev_get(dev);
+	node->order = ++index->order;
+	node->ifindex = dev->link.ifindex;
+	ni_string_dup(&node->name, dev->name);
+	node->hwaddr = dev->link.hwaddr;
+
+	for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type)
+		ni_netdev_index_link(index, type, node);
+	index->count++;
+}
+
+void
+ni_netconfig_device_index_update(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	ni_netdev_index_t *index = &nc->index;
+	ni_netdev_index_node_t *node;
+
+	/* the ifindex of a device never changes */
+	if (!(node = ni_netdev_index_find_node(index, dev)))
+		return;
+
+	if (!ni_string_eq(node->name, dev->name)) {
+		ni_netdev_index_unlink(index, NI_NETDEV_INDEX_NAME, node);
+		ni_string_dup(&node->name, dev->name);
+		ni_netdev_index_link(index, NI_NETDEV_INDEX_NAME, node);
+	}
+
+	if (!ni_link_address_equal(&node->hwaddr, &dev->link.hwaddr)) {
+		ni_netdev_index_unlink(index, NI_NETDEV_INDEX_HWADDR, node);
+		node->hwaddr = dev->link.hwaddr;
+		ni_netdev_index_link(index, NI_NETDEV_INDEX_HWADDR, node);
+	}
+}
+
+void
+ni_netconfig_device_index_del(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	ni_netdev_index_t *index = &nc->index;
+	ni_netdev_index_node_t *node;
+	unsigned int i, type;
+
+	if (!(node = ni_netdev_index_find_node(index, dev))) {
+		/* not expected: ifindex modified after it has been indexed */
+		for (i = 0; !node && i < index->size; ++i) {
+			node = index->bucket[NI_NETDEV_INDEX_IFINDEX][i];
+			while (node && node->dev != dev)
+				node = node->next[NI_NETDEV_INDEX_IFINDEX];
+		}
+		if (!node)
+			return;
+	}
+
+	for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type)
+		ni_netdev_index_unlink(index, type, node);
+	index->count--;
+
+	ni_netdev_put(node->dev);
+	ni_string_free(&node->name);
+	free(node);
+}
+
 /*
  * Manage the list of modem devices
  */
@@ -811,17 +1112,58 @@ ni_netconfig_rule_find(ni_netconfig_t *nc, const ni_rule_t *rule)
 /*
  * Find interface by name
  */
+/*
+ * As the list is in append order, we return the first device
+ * in the list by preferring the match indexed at first.
+ */
 ni_netdev_t *
 ni_netdev_by_name(ni_netconfig_t *nc, const char *name)
 {
-	ni_netdev_t *dev;
+	ni_netdev_index_t *index = &nc->index;
+	ni_netdev_index_node_t *node, *found = NULL;
+	unsigned int hash;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (dev->name && ni_string_eq(dev->name, name))
-			return dev;
+	if (!index->size || ni_string_empty(name))
+		return NULL;
+
+	hash = ni_netdev_index_hash_name(name);
+	node = index->bucket[NI_NETDEV_INDEX_NAME][hash & (index->size - 1)];
+	for ( ; node; node = node->next[NI_NETDEV_INDEX_NAME]) {
+		if (found && found->order < node->order)
+			continue;
+		if (ni_string_eq(node->name, name) && ni_string_eq(node->dev->name, name))
+			found = node;
 	}
 
-	return NULL;
+	return found ? found->dev : NULL;
+}
+
+/*
+ * Find another interface using the name of the given one,
+ * e.g. because its rename event has not been processed yet.
+ */
+ni_netdev_t *
+ni_netconfig_device_name_conflict(ni_netconfig_t *nc, const ni_netdev_t *dev)
+{
+	ni_netdev_index_t *index = &nc->index;
+	ni_netdev_index_node_t *node, *found = NULL;
+	unsigned int hash;
+
+	if (!index->size || !dev || ni_string_empty(dev->name))
+		return NULL;
+
+	hash = ni_netdev_index_hash_name(dev->name);
+	node = index->bucket[NI_NETDEV_INDEX_NAME][hash & (index->size - 1)];
+	for ( ; node; node = node->next[NI_NETDEV_INDEX_NAME]) {
+		if (node->dev == dev || node->dev->link.ifindex == dev->link.ifindex)
+			continue;
+		if (found && found->order < node->order)
+			continue;
+		if (ni_string_eq(node->name, dev->name) && ni_string_eq(node->dev->name, dev->name))
+			found = node;
+	}
+
+	return found ? found->dev : NULL;
 }
 
 /*
@@ -830,14 +1172,21 @@ ni_netdev_by_name(ni_netconfig_t *nc, const char *name)
 ni_netdev_t *
 ni_netdev_by_index(ni_netconfig_t *nc, unsigned int ifindex)
 {
-	ni_netdev_t *dev;
+	ni_netdev_index_t *index = &nc->index;
+	ni_netdev_index_node_t *node, *found = NULL;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (dev->link.ifindex == ifindex)
-			return dev;
+	if (!index->size)
+		return NULL;
+
+	node = index->bucket[NI_NETDEV_INDEX_IFINDEX][ifindex & (index->size - 1)];
+	for ( ; node; node = node->next[NI_NETDEV_INDEX_IFINDEX]) {
+		if (found && found->order < node->order)
+			continue;
+		if (node->ifindex == ifindex && node->dev->link.ifindex == ifindex)
+			found = node;
 	}
 
-	return NULL;
+	return found ? found->dev : NULL;
 }
 
 /*
@@ -846,17 +1195,24 @@ ni_netdev_by_index(ni_netconfig_t *nc, unsigned int ifindex)
 ni_netdev_t *
 ni_netdev_by_hwaddr(ni_netconfig_t *nc, const ni_hwaddr_t *lla)
 {
-	ni_netdev_t *dev;
+	ni_netdev_index_t *index = &nc->index;
+	ni_netdev_index_node_t *node, *found = NULL;
+	unsigned int hash;
 
-	if (!lla || !lla->len)
+	if (!lla || !lla->len || !index->size)
 		return NULL;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (ni_link_address_equal(&dev->link.hwaddr, lla))
-			return dev;
+	hash = ni_netdev_index_hash_hwaddr(lla);
+	node = index->bucket[NI_NETDEV_INDEX_HWADDR][hash & (index->size - 1)];
+	for ( ; node; node = node->next[NI_NETDEV_INDEX_HWADDR]) {
+		if (found && found->order < node->order)
+			continue;
+		if (ni_link_address_equal(&node->hwaddr, lla) &&
+		    ni_link_address_equal(&node->dev->link.hwaddr, lla))
+			found = node;
 	}
 
-	return NULL;
+	return found ? found->dev : NULL;
 }
 
 /*
@@ -47,6 +47,10 @@ extern void		__ni_netlink_close(ni_netlink_t *);
 extern void		ni_netconfig_device_append(ni_netconfig_t *, ni_netdev_t *);
 extern void		ni_netconfig_device_remove(ni_netconfig_t *, ni_netdev_t *);
 extern ni_netdev_t **	ni_netconfig_device_list_head(ni_netconfig_t *);
+extern void		ni_netconfig_device_index_add(ni_netconfig_t *, ni_netdev_t *);
+extern void		ni_netconfig_device_index_update(ni_netconfig_t *, ni_netdev_t *);
+extern void		ni_netconfig_device_index_del(ni_netconfig_t *, ni_netdev_t *);
+extern ni_netdev_t *	ni_netconfig_device_name_conflict(ni_netconfig_t *, const ni_netdev_t *);
 extern void		ni_netconfig_modem_append(ni_netconfig_t *, ni_modem_t *);
 extern int		ni_netconfig_route_add(ni_netconfig_t *, ni_route_t *, ni_netdev_t *);
 extern int		ni_netconfig_route_del(ni_netconfig_t *, ni_route_t *, ni_netdev_t *);
@@ -71,6 +75,7 @@ extern void		__ni_netdev_track_ipv6_autoconf(ni_netdev_t *, int);
 extern unsigned int	__ni_netdev_translate_ifflags(unsigned int, unsigned int);
 extern void		__ni_netdev_process_events(ni_netconfig_t *, ni_netdev_t *, unsigned int);
 extern void		__ni_netdev_event(ni_netconfig_t *, ni_netdev_t *, ni_event_t);
+extern void		__ni_netdev_modified(ni_netdev_t *);
 
 extern int		__ni_ipv4_devconf_process_flags(ni_netdev_t *, int32_t *, unsigned int);
 extern int		__ni_ipv6_devconf_process_flags(ni_netdev_t *, int32_t *, unsigned int);
@@ -152,9 +157,13 @@ typedef struct ni_capture_protinfo {
 extern int		ni_capture_devinfo_init(ni_capture_devinfo_t *, const char *, const ni_linkinfo_t *);
 extern int		ni_capture_devinfo_refresh(ni_capture_devinfo_t *, const char *, const ni_linkinfo_t *);
 extern ni_capture_t *	ni_capture_open(const ni_capture_devinfo_t *, const ni_capture_protinfo_t *, void (*)(ni_socket_t *));
-extern int		ni_capture_recv(ni_capture_t *, ni_buffer_t *, ni_sockaddr_t *, const char *);
+typedef void		ni_capture_recv_fn_t(ni_capture_t *, ni_buffer_t *, ni_sockaddr_t *);
+extern ni_capture_t *	ni_capture_open_shared(const ni_capture_protinfo_t *, ni_capture_recv_fn_t *, const char *);
+extern ni_capture_t *	ni_capture_attach(ni_capture_t *, const ni_capture_devinfo_t *, const ni_capture_protinfo_t *);
+extern int		ni_capture_recv_batch(ni_capture_t *, ni_capture_recv_fn_t *, const char *);
 extern ni_bool_t	ni_capture_from_hwaddr_set(ni_hwaddr_t *, const ni_sockaddr_t *);
 extern const char *	ni_capture_from_hwaddr_print(const ni_sockaddr_t *);
+extern unsigned int	ni_capture_from_ifindex(const ni_sockaddr_t *);
 extern ssize_t		ni_capture_send(ni_capture_t *, const ni_buffer_t *, const ni_timeout_param_t *);
 extern void		ni_capture_disarm_retransmit(ni_capture_t *);
 extern void		ni_capture_force_retransmit(ni_capture_t *, unsigned int);
@@ -163,9 +172,13 @@ extern int		ni_capture_desc(const ni_capture_t *);
 extern int		ni_capture_build_udp_header(ni_buffer_t *,
 					struct in_addr src_addr, uint16_t src_port,
 					struct in_addr dst_addr, uint16_t dst_port);
+extern int		ni_capture_update_udp_payload(ni_buffer_t *, unsigned int,
+					const void *, size_t);
 extern void		ni_capture_set_user_data(ni_capture_t *, void *);
 extern void *		ni_capture_get_user_data(const ni_capture_t *);
 extern int		ni_capture_is_valid(const ni_capture_t *, int protocol);
+extern int		ni_capture_set_arp_filter(ni_capture_t *, unsigned int,
+					const struct in_addr *, unsigned int);
 
 typedef struct ni_arp_socket ni_arp_socket_t;
 
@@ -185,11 +198,18 @@ struct ni_arp_socket {
 
 	ni_arp_callback_t *	callback;
 	void *			user_data;
+
+	struct {
+		ni_bool_t	installed;
+		unsigned int	count;
+		struct in_addr *addrs;
+	} filter;
 };
 
 extern ni_arp_socket_t *ni_arp_socket_open(const ni_capture_devinfo_t *,
 					ni_arp_callback_t *, void *);
 extern void		ni_arp_socket_close(ni_arp_socket_t *);
+extern int		ni_arp_socket_set_filter(ni_arp_socket_t *, const struct in_addr *, unsigned int);
 extern int		ni_arp_send_request(ni_arp_socket_t *, struct in_addr, struct in_addr);
 extern int		ni_arp_send_reply(ni_arp_socket_t *, struct in_addr,
 				const ni_hwaddr_t *, struct in_addr);
@@ -39,8 +39,12 @@
 #include "debug.h"
 
 #define NI_ROUTE_ARRAY_CHUNK		16
+#define NI_ROUTE_ARRAY_GROWTH		256
 #define NI_RULE_ARRAY_CHUNK		4
 
+#define NI_ROUTE_INDEX_MIN_ROUTES	32
+#define NI_ROUTE_INDEX_MIN_SIZE		64
+
 #define IPROUTE2_RT_TABLES_FILE		"/etc/iproute2/rt_tables"
 
 
@@ -107,6 +111,15 @@ static const ni_intmap_t	ni_route_protocol_names[] = {
 	{ "xorp",		RTPROT_XORP		},
 	{ "ntk",		RTPROT_NTK		},
 	{ "dhcp",		RTPROT_DHCP		},
+#ifdef RTPROT_BGP
+	/* routing daemon protocols added in linux 4.17 */
+	{ "babel",		RTPROT_BABEL		},
+	{ "bgp",		RTPROT_BGP		},
+	{ "isis",		RTPROT_ISIS		},
+	{ "ospf",		RTPROT_OSPF		},
+	{ "rip",		RTPROT_RIP		},
+	{ "eigrp",		RTPROT_EIGRP		},
+#endif
 
 	{ NULL,			RTPROT_UNSPEC		}
 };
@@ -1499,6 +1512,7 @@ ni_route_array_destroy(ni_route_array_t *nra)
 		}
 		free(nra->data);
 		nra->data = NULL;
+		nra->gen++;
 	}
 }
 
@@ -1523,17 +1537,36 @@ ni_route_array_realloc(ni_route_array_t *nra, unsigned int newsize)
 	return TRUE;
 }
 
+/*
+ * Grow small arrays in chunks and large arrays by doubling
+ * their size at power of 2 counts, so appending the routes
+ * of a full routing table does not realloc all the time.
+ */
+static inline ni_bool_t
+ni_route_array_needs_realloc(unsigned int count, unsigned int *newsize)
+{
+	if (count < NI_ROUTE_ARRAY_GROWTH) {
+		*newsize = count;
+		return (count % NI_ROUTE_ARRAY_CHUNK) == 0;
+	}
+	*newsize = count * 2 - NI_ROUTE_ARRAY_CHUNK;
+	return (count & (count - 1)) == 0;
+}
+
 ni_bool_t
 ni_route_array_append(ni_route_array_t *nra, ni_route_t *rp)
 {
+	unsigned int newsize;
+
 	if (!nra || !rp)
 		return FALSE;
 
-	if ((nra->count % NI_ROUTE_ARRAY_CHUNK) == 0 &&
-	    !ni_route_array_realloc(nra, nra->count))
+	if (ni_route_array_needs_realloc(nra->count, &newsize) &&
+	    !ni_route_array_realloc(nra, newsize))
 		return FALSE;
 
 	nra->data[nra->count++] = rp;
+	nra->gen++;
 	return TRUE;
 }
 
@@ -1552,6 +1585,7 @@ ni_route_array_remove(ni_route_array_t *nra, unsigned int index)
 			(nra->count - index) * sizeof(ni_route_t *));
 	}
 	nra->data[nra->count] = NULL;
+	nra->gen++;
 
 	/* Don't bother with shrinking the array. It's not worth the trouble */
 	return rp;
@@ -1680,6 +1714,7 @@ ni_route_array_qsort(ni_route_array_t *nra, ni_route_cmp_fn *cmp_fn)
 
 	qsort_r(&nra->data[0], nra->count, sizeof(nra->data[0]),
 			ni_route_qsort_r_cmp, cmp_fn);
+	nra->gen++;
 }
 
 void
@@ -1695,6 +1730,272 @@ ni_route_array_sort_rev(ni_route_array_t *nra)
 }
 
 
+/*
+ * ni_route_table index
+ *
+ * Large tables (e.g. a full routing table learned from the kernel) are
+ * indexed by a hash of the destination key [family, prefixlen, prefix],
+ * which is a subset of the key ni_route_equal and ni_route_equal_destination
+ * are comparing. The hash chains preserve the order of the routes array,
+ * so a lookup returns the same (first) match as a linear array scan.
+ *
+ * The index remembers the generation of the routes array it reflects and
+ * is (re)built lazily on the next lookup once the array has been modified
+ * behind its back, e.g. by ni_route_array_delete() on the table routes.
+ */
+typedef struct ni_route_index_node	ni_route_index_node_t;
+
+struct ni_route_index_node {
+	ni_route_index_node_t *	next;
+	ni_route_t *		route;
+	unsigned int		hash;
+};
+
+struct ni_route_index {
+	unsigned int		size;
+	unsigned int		count;
+	unsigned int		gen;	/* of the indexed routes array */
+	ni_route_index_node_t **bucket;
+};
+
+static unsigned int
+ni_route_index_hash(const ni_route_t *rp)
+{
+	const unsigned char *ptr = NULL;
+	unsigned int hash = 5381;
+	unsigned int len = 0;
+
+	hash = ((hash << 5) + hash) + rp->family;
+	hash = ((hash << 5) + hash) + rp->prefixlen;
+	if (!rp->prefixlen)
+		return hash;
+
+	switch (rp->destination.ss_family) {
+	case AF_INET:
+		ptr = (const unsigned char *)&rp->destination.sin.sin_addr;
+		len = sizeof(rp->destination.sin.sin_addr);
+		break;
+	case AF_INET6:
+		ptr = (const unsigned char *)&rp->destination.six.sin6_addr;
+		len = sizeof(rp->destination.six.sin6_addr);
+		break;
+	default:
+		break;
+	}
+	while (len--)
+		hash = ((hash << 5) + hash) + *ptr++;
+	return hash;
+}
+
+static void
+ni_route_index_free(ni_route_index_t *index)
+{
+	ni_route_index_node_t *node;
+	unsigned int i;
+
+	if (!index)
+		return;
+
+	for (i = 0; i < index->size; ++i) {
+		while ((node = index->bucket[i])) {
+			index->bucket[i] = node->next;
+			free(node);
+		}
+	}
+	free(index->bucket);
+	free(index);
+}
+
+static ni_bool_t
+ni_route_index_insert(ni_route_index_t *index, ni_route_t *rp)
+{
+	ni_route_index_node_t *node, **pos;
+
+	if (!(node = xcalloc(1, sizeof(*node))))
+		return FALSE;
+
+	node->route = rp;
+	node->hash = ni_route_index_hash(rp);
+
+	pos = &index->bucket[node->hash & (index->size - 1)];
+	while (*pos)
+		pos = &(*pos)->next;
+	*pos = node;
+	index->count++;
+	return TRUE;
+}
+
+static ni_bool_t
+ni_route_index_remove(ni_route_index_t *index, const ni_route_t *rp)
+{
+	ni_route_index_node_t *node, **pos;
+	unsigned int hash;
+
+	hash = ni_route_index_hash(rp);
+	pos = &index->bucket[hash & (index->size - 1)];
+	while ((node = *pos)) {
+		if (node->route == rp) {
+			*pos = node->next;
+			free(node);
+			index->count--;
+			return TRUE;
+		}
+		pos = &node->next;
+	}
+	return FALSE;
+}
+
+static ni_route_index_t *
+ni_route_index_build(ni_route_table_t *tab)
+{
+	ni_route_index_t *index;
+	unsigned int size, i;
+
+	ni_route_index_free(tab->index);
+	tab->index = NULL;
+
+	if (tab->routes.count < NI_ROUTE_INDEX_MIN_ROUTES)
+		return NULL;
+
+	for (size = NI_ROUTE_INDEX_MIN_SIZE; size < tab->routes.count * 2; )
+		size <<= 1;
+
+	if (!(index = xcalloc(1, sizeof(*index))))
+		return NULL;
+	if (!(index->bucket = xcalloc(size, sizeof(index->bucket[0])))) {
+		free(index);
+		return NULL;
+	}
+	index->size = size;
+
+	for (i = 0; i < tab->routes.count; ++i) {
+		if (!tab->routes.data[i])
+			continue;
+		if (!ni_route_index_insert(index, tab->routes.data[i])) {
+			ni_route_index_free(index);
+			return NULL;
+		}
+	}
+
+	/* array contains NULL entries; we can't verify it by count */
+	if (index->count != tab->routes.count) {
+		ni_route_index_free(index);
+		return NULL;
+	}
+	index->gen = tab->routes.gen;
+	tab->index = index;
+	return index;
+}
+
+static ni_route_index_t *
+ni_route_table_index(ni_route_table_t *tab)
+{
+	if (tab->index && tab->index->gen == tab->routes.gen)
+		return tab->index;
+	return ni_route_index_build(tab);
+}
+
+static inline ni_bool_t
+ni_route_index_usable(ni_bool_t (*match)(const ni_route_t *, const ni_route_t *))
+{
+	return	match == ni_route_equal ||
+		match == ni_route_equal_destination ||
+		match == ni_route_equal_ref;
+}
+
+static void
+ni_route_table_index_add(ni_route_table_t *tab, ni_route_t *rp)
+{
+	ni_route_index_t *index = tab->index;
+
+	/* not built yet or outdated: leave it to the next lookup */
+	if (!index || index->gen + 1 != tab->routes.gen)
+		return;
+
+	if (index->count >= index->size || !ni_route_index_insert(index, rp))
+		ni_route_index_build(tab);
+	else
+		index->gen = tab->routes.gen;
+}
+
+static ni_route_t *
+ni_route_table_find_match(ni_route_table_t *tab, const ni_route_t *rp,
+		ni_bool_t (*match)(const ni_route_t *, const ni_route_t *))
+{
+	ni_route_index_node_t *node;
+	ni_route_index_t *index;
+	unsigned int hash;
+
+	if (!ni_route_index_usable(match) || !(index = ni_route_table_index(tab)))
+		return ni_route_array_find_match(&tab->routes, rp, match);
+
+	hash = ni_route_index_hash(rp);
+	for (node = index->bucket[hash & (index->size - 1)]; node; node = node->next) {
+		if (node->hash == hash && match(node->route, rp))
+			return node->route;
+	}
+	return NULL;
+}
+
+static unsigned int
+ni_route_table_find_matches(ni_route_table_t *tab, const ni_route_t *rp,
+		ni_bool_t (*match)(const ni_route_t *, const ni_route_t *),
+		ni_route_array_t *matches)
+{
+	ni_route_index_node_t *node;
+	ni_route_index_t *index;
+	unsigned int count;
+	unsigned int hash;
+
+	if (!matches || !ni_route_index_usable(match) ||
+	    !(index = ni_route_table_index(tab)))
+		return ni_route_array_find_matches(&tab->routes, rp, match, matches);
+
+	count = matches->count;
+	hash = ni_route_index_hash(rp);
+	for (node = index->bucket[hash & (index->size - 1)]; node; node = node->next) {
+		if (node->hash != hash || !match(node->route, rp))
+			continue;
+
+		/* do not add same route (another ref) multiple times */
+		if (!ni_route_array_find_match(matches, node->route, ni_route_equal_ref))
+			ni_route_array_append(matches, ni_route_ref(node->route));
+	}
+	return matches->count - count;
+}
+
+static ni_bool_t
+ni_route_table_del_route(ni_route_table_t *tab, const ni_route_t *rp)
+{
+	ni_route_index_t *index;
+	ni_route_t *r;
+	unsigned int i;
+
+	if (!(index = ni_route_table_index(tab)))
+		return ni_route_array_delete_ref(&tab->routes, rp);
+
+	if (!ni_route_index_remove(index, rp))
+		return FALSE;
+
+	/* recently added routes are usually the first to go */
+	for (i = tab->routes.count; i-- > 0; ) {
+		if (tab->routes.data[i] != rp)
+			continue;
+
+		if ((r = ni_route_array_remove(&tab->routes, i))) {
+			index->gen = tab->routes.gen;
+			ni_route_free(r);
+			return TRUE;
+		}
+		break;
+	}
+
+	/* the index was out of sync -- drop it */
+	ni_route_index_free(tab->index);
+	tab->index = NULL;
+	return FALSE;
+}
+
 /*
  * ni_route_table functions
  */
@@ -1730,6 +2031,8 @@ void
 ni_route_table_clear(ni_route_table_t *tab)
 {
 	if (tab) {
+		ni_route_index_free(tab->index);
+		tab->index = NULL;
 		ni_route_array_destroy(&tab->routes);
 	}
 }
@@ -1742,9 +2045,14 @@ ni_route_tables_add_route(ni_route_table_t **list, ni_route_t *rp)
 {
 	ni_route_table_t *tab;
 
-	if (rp && (tab = ni_route_tables_get(list, rp->table)))
-		return ni_route_array_append(&tab->routes, rp);
-	return FALSE;
+	if (!rp || !(tab = ni_route_tables_get(list, rp->table)))
+		return FALSE;
+
+	if (!ni_route_array_append(&tab->routes, rp))
+		return FALSE;
+
+	ni_route_table_index_add(tab, rp);
+	return TRUE;
 }
 
 ni_bool_t
@@ -1771,7 +2079,7 @@ ni_route_tables_del_route(ni_route_table_t *list, ni_route_t *rp)
 	if (!rp || !(tab = ni_route_tables_find(list, rp->table)))
 		return FALSE;
 
-	return ni_route_array_delete_ref(&tab->routes, rp);
+	return ni_route_table_del_route(tab, rp);
 }
 
 ni_route_t *
@@ -1782,7 +2090,7 @@ ni_route_tables_find_match(ni_route_table_t *list, const ni_route_t *rp,
 
 	if (!rp || !(tab = ni_route_tables_find(list, rp->table)))
 		return NULL;
-	return ni_route_array_find_match(&tab->routes, rp, match);
+	return ni_route_table_find_match(tab, rp, match);
 }
 
 unsigned int
@@ -1795,7 +2103,7 @@ ni_route_tables_find_matches(ni_route_table_t *list, const ni_route_t *rp,
 	if (!rp || !(tab = ni_route_tables_find(list, rp->table)))
 		return 0;
 
-	return ni_route_array_find_matches(&tab->routes, rp, match, matches);
+	return ni_route_table_find_matches(tab, rp, match, matches);
 }
 
 ni_route_table_t *
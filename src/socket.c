@@ -11,6 +11,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/poll.h>
+#include <sys/epoll.h>
 #include <sys/un.h>
 #include <signal.h>
 #include <string.h>
@@ -29,13 +30,38 @@
 #include "appconfig.h"
 
 #define	NI_SOCKET_ARRAY_CHUNK	16
+#define NI_SOCKET_EPOLL_EVENTS	64
 
 static void			__ni_socket_close(ni_socket_t *);
 static void			__ni_default_error_handler(ni_socket_t *);
 static void			__ni_default_hangup_handler(ni_socket_t *);
+static ni_bool_t		__ni_socket_epoll_init(void);
+static ni_bool_t		__ni_socket_epoll_add(ni_socket_t *);
+static void			__ni_socket_epoll_del(ni_socket_t *);
+static int			__ni_socket_epoll_wait(ni_socket_array_t *, long);
 
 static ni_socket_array_t	__ni_sockets;
 
+/*
+ * With the epoll backend, the sockets in __ni_sockets are registered
+ * in the epoll set once when activated and only the ready ones are
+ * dispatched. Socket timeouts are driven by the timer subsystem.
+ * In edge triggered mode, sockets still ready after their callback
+ * returned are kept on the pending list and dispatched again in the
+ * next wait.
+ */
+static struct {
+	ni_bool_t		init;
+	int			fd;
+	ni_bool_t		edge;
+	ni_socket_array_t	pending;
+} __ni_socket_epoll = {
+	.init		= FALSE,
+	.fd		= -1,
+	.edge		= FALSE,
+	.pending	= NI_SOCKET_ARRAY_INIT,
+};
+
 
 /*
  * Install a socket so we check it for incoming data.
@@ -43,7 +69,17 @@ static ni_socket_array_t	__ni_sockets;
 ni_bool_t
 ni_socket_activate(ni_socket_t *sock)
 {
-	return ni_socket_array_activate(&__ni_sockets, sock);
+	if (!ni_socket_array_activate(&__ni_sockets, sock))
+		return FALSE;
+
+	if (__ni_socket_epoll_init() && !sock->epoll) {
+		if (!__ni_socket_epoll_add(sock)) {
+			ni_socket_array_deactivate(&__ni_sockets, sock);
+			return FALSE;
+		}
+		ni_socket_update_timeout(sock);
+	}
+	return TRUE;
 }
 
 static inline void
@@ -52,6 +88,7 @@ __ni_socket_deactivate(ni_socket_t **slot)
 	ni_socket_t *sock = *slot;
 
 	*slot = NULL;
+	__ni_socket_epoll_del(sock);
 	sock->active = NULL;
 	ni_socket_release(sock);
 }
@@ -68,7 +105,22 @@ ni_socket_deactivate(ni_socket_t *sock)
 void
 ni_socket_deactivate_all(void)
 {
+	ni_socket_array_t *pending = &__ni_socket_epoll.pending;
+
 	ni_socket_array_destroy(&__ni_sockets);
+
+	while (pending->count) {
+		ni_socket_t *sock = pending->data[--pending->count];
+
+		sock->pending = 0;
+		ni_socket_release(sock);
+	}
+	ni_socket_array_destroy(pending);
+
+	if (__ni_socket_epoll.fd >= 0)
+		close(__ni_socket_epoll.fd);
+	__ni_socket_epoll.fd = -1;
+	__ni_socket_epoll.init = FALSE;
 }
 
 ni_socket_t *
@@ -110,6 +162,58 @@ __ni_default_hangup_handler(ni_socket_t *sock)
 }
 
 
+/*
+ * Dispatch the poll events of a socket to its callbacks.
+ * The poll loop passes the array slot of the socket, so
+ * it can clear it without disturbing the array order.
+ */
+static inline void
+__ni_socket_dispatch_deactivate(ni_socket_t *sock, ni_socket_t **slot)
+{
+	if (slot)
+		__ni_socket_deactivate(slot);
+	else
+		ni_socket_deactivate(sock);
+}
+
+static void
+__ni_socket_dispatch(ni_socket_t *sock, ni_socket_t **slot, int revents)
+{
+	if (revents & POLLERR) {
+		/* Deactivate socket */
+		__ni_socket_dispatch_deactivate(sock, slot);
+		sock->handle_error(sock);
+		return;
+	}
+
+	if (revents & POLLIN) {
+		if (sock->receive == NULL) {
+			ni_error("socket %d has no receive callback", sock->__fd);
+			__ni_socket_dispatch_deactivate(sock, slot);
+		} else {
+			sock->receive(sock);
+		}
+		if (sock->__fd < 0)
+			return;
+	}
+
+	if (revents & POLLHUP) {
+		if (sock->handle_hangup)
+			sock->handle_hangup(sock);
+		if (sock->__fd < 0)
+			return;
+	} else
+
+	if (revents & POLLOUT) {
+		if (sock->transmit == NULL) {
+			ni_error("socket %d has no transmit callback", sock->__fd);
+			__ni_socket_dispatch_deactivate(sock, slot);
+		} else {
+			sock->transmit(sock);
+		}
+	}
+}
+
 /*
  * Wait for incoming data on any of the sockets.
  */
@@ -181,42 +285,7 @@ ni_socket_array_wait(ni_socket_array_t *array, long timeout)
 			continue;
 
 		ni_socket_hold(sock);
-
-		if (pfd[i].revents & POLLERR) {
-			/* Deactivate socket */
-			__ni_socket_deactivate(&array->data[i]);
-			sock->handle_error(sock);
-			goto done_with_this_socket;
-		}
-
-		if (pfd[i].revents & POLLIN) {
-			if (sock->receive == NULL) {
-				ni_error("socket %d has no receive callback", sock->__fd);
-				__ni_socket_deactivate(&array->data[i]);
-			} else {
-				sock->receive(sock);
-			}
-			if (sock->__fd < 0)
-				goto done_with_this_socket;
-		}
-
-		if (pfd[i].revents & POLLHUP) {
-			if (sock->handle_hangup)
-				sock->handle_hangup(sock);
-			if (sock->__fd < 0)
-				goto done_with_this_socket;
-		} else
-
-		if (pfd[i].revents & POLLOUT) {
-			if (sock->transmit == NULL) {
-				ni_error("socket %d has no transmit callback", sock->__fd);
-				__ni_socket_deactivate(&array->data[i]);
-			} else {
-				sock->transmit(sock);
-			}
-		}
-
-done_with_this_socket:
+		__ni_socket_dispatch(sock, &array->data[i], pfd[i].revents);
 		ni_socket_release(sock);
 	}
 
@@ -240,9 +309,290 @@ done_with_this_socket:
 int
 ni_socket_wait(long timeout)
 {
+	if (__ni_socket_epoll.fd >= 0)
+		return __ni_socket_epoll_wait(&__ni_sockets, timeout);
+
 	return ni_socket_array_wait(&__ni_sockets, timeout);
 }
 
+/*
+ * epoll socket loop backend
+ */
+static ni_bool_t
+__ni_socket_epoll_init(void)
+{
+	if (__ni_socket_epoll.init)
+		return __ni_socket_epoll.fd >= 0;
+
+	__ni_socket_epoll.init = TRUE;
+	if (ni_config_socket_loop_backend() != NI_CONFIG_SOCKET_LOOP_EPOLL)
+		return FALSE;
+
+	if ((__ni_socket_epoll.fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		ni_warn("unable to create epoll instance, using poll: %m");
+		return FALSE;
+	}
+
+	__ni_socket_epoll.edge = ni_config_socket_loop_edge_triggered();
+	ni_debug_socket("using %s triggered epoll socket loop",
+			__ni_socket_epoll.edge ? "edge" : "level");
+	return TRUE;
+}
+
+static inline uint32_t
+__ni_socket_epoll_events(int poll_flags)
+{
+	uint32_t events = 0;
+
+	if (poll_flags & POLLIN)
+		events |= EPOLLIN;
+	if (poll_flags & POLLPRI)
+		events |= EPOLLPRI;
+	if (poll_flags & POLLOUT)
+		events |= EPOLLOUT;
+	if (__ni_socket_epoll.edge)
+		events |= EPOLLET;
+	return events;
+}
+
+static inline int
+__ni_socket_epoll_revents(uint32_t events)
+{
+	int revents = 0;
+
+	if (events & EPOLLIN)
+		revents |= POLLIN;
+	if (events & EPOLLPRI)
+		revents |= POLLPRI;
+	if (events & EPOLLOUT)
+		revents |= POLLOUT;
+	if (events & EPOLLERR)
+		revents |= POLLERR;
+	if (events & EPOLLHUP)
+		revents |= POLLHUP;
+	return revents;
+}
+
+static ni_bool_t
+__ni_socket_epoll_add(ni_socket_t *sock)
+{
+	struct epoll_event ev;
+
+	if (sock->epoll)
+		return TRUE;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = __ni_socket_epoll_events(sock->poll_flags);
+	ev.data.ptr = sock;
+	if (epoll_ctl(__ni_socket_epoll.fd, EPOLL_CTL_ADD, sock->__fd, &ev) < 0) {
+		ni_error("unable to add socket %d to epoll set: %m", sock->__fd);
+		return FALSE;
+	}
+
+	sock->epoll = 1;
+	sock->epoll_flags = sock->poll_flags;
+	return TRUE;
+}
+
+static void
+__ni_socket_epoll_del(ni_socket_t *sock)
+{
+	if (!sock->epoll)
+		return;
+
+	sock->epoll = 0;
+	if (sock->timer) {
+		ni_timer_cancel(sock->timer);
+		sock->timer = NULL;
+	}
+
+	if (sock->__fd < 0 || __ni_socket_epoll.fd < 0)
+		return;
+
+	if (epoll_ctl(__ni_socket_epoll.fd, EPOLL_CTL_DEL, sock->__fd, NULL) < 0 &&
+	    errno != EBADF && errno != ENOENT)
+		ni_warn("unable to remove socket %d from epoll set: %m", sock->__fd);
+}
+
+/*
+ * Callbacks may change the poll flags of their socket (e.g. dbus
+ * toggling POLLOUT), so update the registration when they differ.
+ */
+static void
+__ni_socket_epoll_sync(ni_socket_t *sock)
+{
+	struct epoll_event ev;
+
+	if (!sock->epoll || sock->__fd < 0 || sock->poll_flags == sock->epoll_flags)
+		return;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = __ni_socket_epoll_events(sock->poll_flags);
+	ev.data.ptr = sock;
+	if (epoll_ctl(__ni_socket_epoll.fd, EPOLL_CTL_MOD, sock->__fd, &ev) < 0) {
+		ni_error("unable to modify socket %d in epoll set: %m", sock->__fd);
+		return;
+	}
+	sock->epoll_flags = sock->poll_flags;
+}
+
+static int
+__ni_socket_poll_revents(const ni_socket_t *sock)
+{
+	struct pollfd pfd;
+
+	pfd.fd = sock->__fd;
+	pfd.events = sock->poll_flags;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) <= 0)
+		return 0;
+	return pfd.revents;
+}
+
+static void
+__ni_socket_epoll_dispatch(ni_socket_array_t *array, ni_socket_t *sock, int revents)
+{
+	if (sock->active != array || !sock->epoll || !revents)
+		return;
+
+	__ni_socket_dispatch(sock, NULL, revents);
+	__ni_socket_epoll_sync(sock);
+
+	/* Most callbacks consume one message per call only and the batched
+	 * ones stop at their batch limit, so with edge triggered notifications
+	 * we have to check whether the socket is still ready and dispatch it
+	 * again instead of waiting for the next event, which may not come.
+	 */
+	if (!__ni_socket_epoll.edge || sock->pending || !sock->epoll || sock->__fd < 0)
+		return;
+
+	if (__ni_socket_poll_revents(sock)) {
+		sock->pending = 1;
+		ni_socket_array_append(&__ni_socket_epoll.pending, ni_socket_hold(sock));
+	}
+}
+
+static int
+__ni_socket_epoll_wait(ni_socket_array_t *array, long timeout)
+{
+	struct epoll_event events[NI_SOCKET_EPOLL_EVENTS];
+	ni_socket_array_t pending;
+	ni_socket_t *sock;
+	unsigned int i;
+	int count;
+
+	if (array->count == 0 && timeout < 0) {
+		ni_debug_socket("no sockets left to watch");
+		return 1;
+	}
+
+	pending = __ni_socket_epoll.pending;
+	ni_socket_array_init(&__ni_socket_epoll.pending);
+	if (pending.count)
+		timeout = 0;
+
+	count = epoll_wait(__ni_socket_epoll.fd, events, NI_SOCKET_EPOLL_EVENTS, timeout);
+	if (count < 0) {
+		__ni_socket_epoll.pending = pending;
+		if (errno == EINTR)
+			return 0;
+		ni_error("epoll_wait returns error: %m");
+		return -1;
+	}
+
+	/* Callbacks may close other sockets, hold all we've got events for */
+	for (i = 0; i < (unsigned int)count; ++i)
+		ni_socket_hold(events[i].data.ptr);
+
+	for (i = 0; i < (unsigned int)count; ++i) {
+		sock = events[i].data.ptr;
+
+		/* dispatched with the pending ones below */
+		if (sock->pending)
+			continue;
+
+		__ni_socket_epoll_dispatch(array, sock,
+				__ni_socket_epoll_revents(events[i].events));
+	}
+
+	for (i = 0; i < pending.count; ++i) {
+		sock = pending.data[i];
+		sock->pending = 0;
+
+		if (sock->active != array || !sock->epoll)
+			continue;
+
+		__ni_socket_epoll_dispatch(array, sock, __ni_socket_poll_revents(sock));
+	}
+
+	for (i = 0; i < (unsigned int)count; ++i)
+		ni_socket_release(events[i].data.ptr);
+
+	while (pending.count)
+		ni_socket_release(pending.data[--pending.count]);
+	ni_socket_array_destroy(&pending);
+
+	return 0;
+}
+
+/*
+ * With the epoll backend, the get_timeout and check_timeout callbacks
+ * are driven by a timer instead of querying every socket on every
+ * wakeup. Sockets providing them have to call this function when
+ * their deadline has been changed.
+ */
+static void
+__ni_socket_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_socket_t *sock = user_data;
+	struct timeval now;
+
+	if (sock->timer != timer)
+		return;
+	sock->timer = NULL;
+
+	ni_socket_hold(sock);
+	if (sock->epoll && sock->check_timeout) {
+		ni_timer_get_time(&now);
+		sock->check_timeout(sock, &now);
+	}
+	ni_socket_update_timeout(sock);
+	ni_socket_release(sock);
+}
+
+void
+ni_socket_update_timeout(ni_socket_t *sock)
+{
+	struct timeval now, expires, delta;
+	unsigned long timeout = 0;
+
+	/* the poll backend queries the timeout on each wakeup */
+	if (!sock || !sock->epoll)
+		return;
+
+	timerclear(&expires);
+	if (!sock->get_timeout || sock->get_timeout(sock, &expires) != 0 ||
+	    !timerisset(&expires)) {
+		if (sock->timer) {
+			ni_timer_cancel(sock->timer);
+			sock->timer = NULL;
+		}
+		return;
+	}
+
+	ni_timer_get_time(&now);
+	if (timercmp(&expires, &now, >)) {
+		timersub(&expires, &now, &delta);
+		timeout = delta.tv_sec * 1000 + (delta.tv_usec + 999) / 1000;
+	}
+	/* check_timeout expects the deadline to be passed */
+	timeout++;
+
+	if (sock->timer && (sock->timer = ni_timer_rearm(sock->timer, timeout)))
+		return;
+	sock->timer = ni_timer_register(timeout, __ni_socket_timeout, sock);
+}
+
 /*
  * Wrap a file descriptor in a ni_socket object
  */
@@ -282,6 +632,7 @@ ni_socket_wrap(int fd, int sotype)
 static void
 __ni_socket_close(ni_socket_t *sock)
 {
+	__ni_socket_epoll_del(sock);
 	if (sock->close) {
 		sock->close(sock);
 	} else if (sock->__fd >= 0) {
@@ -322,8 +673,10 @@ ni_socket_array_destroy(ni_socket_array_t *array)
 			sock = array->data[array->count];
 			array->data[array->count] = NULL;
 			if (sock) {
-				if (sock->active == array)
+				if (sock->active == array) {
+					__ni_socket_epoll_del(sock);
 					sock->active = NULL;
+				}
 				ni_socket_release(sock);
 			}
 		}
@@ -390,8 +743,10 @@ ni_socket_array_remove_at(ni_socket_array_t *array, unsigned int index)
 	}
 	array->data[array->count] = NULL;
 
-	if (sock && sock->active == array)
+	if (sock && sock->active == array) {
+		__ni_socket_epoll_del(sock);
 		sock->active = NULL;
+	}
 	return sock;
 }
 
@@ -18,8 +18,12 @@ struct ni_socket {
 	ni_socket_array_t *	active;
 
 	int		__fd;
-	unsigned int	error  : 1;
+	unsigned int	error  : 1,
+			epoll  : 1,
+			pending: 1;
 	int		poll_flags;
+	int		epoll_flags;	/* poll_flags registered in epoll set */
+	const ni_timer_t *timer;	/* drives check_timeout with epoll */
 
 	ni_buffer_t	rbuf;
 	ni_buffer_t	wbuf;
@@ -59,5 +63,7 @@ extern unsigned int	ni_socket_array_find(ni_socket_array_t *, ni_socket_t *);
 extern ni_bool_t	ni_socket_array_activate(ni_socket_array_t *, ni_socket_t *);
 extern ni_bool_t	ni_socket_array_deactivate(ni_socket_array_t *, ni_socket_t *);
 
+extern void		ni_socket_update_timeout(ni_socket_t *);
+
 #endif /* __WICKED_SOCKET_PRIV_H__ */
 
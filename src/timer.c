@@ -13,15 +13,36 @@
 #include "netinfo_priv.h"
 #include "util_priv.h"
 
+/*
+ * Armed timers are kept in a binary min-heap ordered by their
+ * expiry time (and arm order for equal expiry times), so arming
+ * and disarming a timer is O(log n).
+ * As callers may pass handles of already expired or cancelled
+ * timers, a handle is validated using a hash of the pointers of
+ * all armed timers before we dereference it.
+ */
 struct ni_timer {
 	ni_timer_t *		next;
 	unsigned int		ident;
+	unsigned int		serial;
+	unsigned int		index;
 	struct timeval		expires;
 	ni_timeout_callback_t	*callback;
 	void *			user_data;
 };
 
-static ni_timer_t *		ni_timer_list;
+#define NI_TIMER_SIZE_MIN	64
+
+static struct {
+	ni_timer_t **		data;
+	unsigned int		count;
+	unsigned int		size;
+} ni_timer_heap;
+
+static struct {
+	ni_timer_t **		bucket;
+	unsigned int		size;
+} ni_timer_hash;
 
 static void			__ni_timer_arm(ni_timer_t *, unsigned long);
 static ni_timer_t *		__ni_timer_disarm(const ni_timer_t *);
@@ -83,7 +104,7 @@ ni_timer_next_timeout(void)
 	long timeout;
 
 	ni_timer_get_time(&now);
-	while ((timer = ni_timer_list) != NULL) {
+	while (ni_timer_heap.count && (timer = ni_timer_heap.data[0]) != NULL) {
 		if (!timercmp(&timer->expires, &now, <)) {
 			timersub(&timer->expires, &now, &delta);
 			timeout = delta.tv_sec * 1000 + delta.tv_usec / 1000;
@@ -98,7 +119,7 @@ ni_timer_next_timeout(void)
 				__func__, timer,
 				(long) now.tv_sec, (long) now.tv_usec,
 				(long) timer->expires.tv_sec, (long) timer->expires.tv_usec);
-		ni_timer_list = timer->next;
+		__ni_timer_disarm(timer);
 		timer->callback(timer->user_data, timer);
 		free(timer);
 	}
@@ -106,10 +127,166 @@ ni_timer_next_timeout(void)
 	return -1;
 }
 
+/*
+ * Hash of armed timer pointers
+ */
+static inline unsigned int
+__ni_timer_hash_slot(const ni_timer_t *handle)
+{
+	unsigned long hash = (unsigned long)handle;
+
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3bUL;
+	hash ^= hash >> 16;
+	return (unsigned int)hash & (ni_timer_hash.size - 1);
+}
+
+static void
+__ni_timer_hash_resize(unsigned int size)
+{
+	ni_timer_t **old = ni_timer_hash.bucket;
+	unsigned int i, osize = ni_timer_hash.size;
+	ni_timer_t *timer, *next;
+
+	ni_timer_hash.bucket = xcalloc(size, sizeof(timer));
+	ni_timer_hash.size = size;
+
+	for (i = 0; i < osize; ++i) {
+		for (timer = old[i]; timer; timer = next) {
+			unsigned int slot = __ni_timer_hash_slot(timer);
+
+			next = timer->next;
+			timer->next = ni_timer_hash.bucket[slot];
+			ni_timer_hash.bucket[slot] = timer;
+		}
+	}
+	free(old);
+}
+
+static void
+__ni_timer_hash_add(ni_timer_t *timer)
+{
+	unsigned int slot;
+
+	if (ni_timer_heap.count >= ni_timer_hash.size) {
+		__ni_timer_hash_resize(ni_timer_hash.size ?
+				ni_timer_hash.size << 1 : NI_TIMER_SIZE_MIN);
+	}
+
+	slot = __ni_timer_hash_slot(timer);
+	timer->next = ni_timer_hash.bucket[slot];
+	ni_timer_hash.bucket[slot] = timer;
+}
+
+static ni_timer_t *
+__ni_timer_hash_del(const ni_timer_t *handle)
+{
+	ni_timer_t **pos, *timer;
+
+	if (!handle || !ni_timer_hash.size)
+		return NULL;
+
+	pos = &ni_timer_hash.bucket[__ni_timer_hash_slot(handle)];
+	for ( ; (timer = *pos) != NULL; pos = &timer->next) {
+		if (timer == handle) {
+			*pos = timer->next;
+			timer->next = NULL;
+			return timer;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Min-heap of armed timers
+ */
+static inline ni_bool_t
+__ni_timer_before(const ni_timer_t *a, const ni_timer_t *b)
+{
+	if (timercmp(&a->expires, &b->expires, !=))
+		return timercmp(&a->expires, &b->expires, <);
+	return (int)(a->serial - b->serial) < 0;
+}
+
+static inline void
+__ni_timer_heap_set(unsigned int index, ni_timer_t *timer)
+{
+	ni_timer_heap.data[index] = timer;
+	timer->index = index;
+}
+
+static void
+__ni_timer_heap_up(unsigned int index)
+{
+	ni_timer_t *timer = ni_timer_heap.data[index];
+	unsigned int parent;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+		if (!__ni_timer_before(timer, ni_timer_heap.data[parent]))
+			break;
+		__ni_timer_heap_set(index, ni_timer_heap.data[parent]);
+		index = parent;
+	}
+	__ni_timer_heap_set(index, timer);
+}
+
+static void
+__ni_timer_heap_down(unsigned int index)
+{
+	ni_timer_t *timer = ni_timer_heap.data[index];
+	unsigned int child;
+
+	while ((child = 2 * index + 1) < ni_timer_heap.count) {
+		if (child + 1 < ni_timer_heap.count &&
+		    __ni_timer_before(ni_timer_heap.data[child + 1], ni_timer_heap.data[child]))
+			child++;
+		if (!__ni_timer_before(ni_timer_heap.data[child], timer))
+			break;
+		__ni_timer_heap_set(index, ni_timer_heap.data[child]);
+		index = child;
+	}
+	__ni_timer_heap_set(index, timer);
+}
+
+static void
+__ni_timer_heap_insert(ni_timer_t *timer)
+{
+	if (ni_timer_heap.count >= ni_timer_heap.size) {
+		ni_timer_heap.size = ni_timer_heap.size ?
+			ni_timer_heap.size << 1 : NI_TIMER_SIZE_MIN;
+		ni_timer_heap.data = xrealloc(ni_timer_heap.data,
+			ni_timer_heap.size * sizeof(ni_timer_heap.data[0]));
+	}
+
+	__ni_timer_heap_set(ni_timer_heap.count++, timer);
+	__ni_timer_heap_up(timer->index);
+}
+
+static void
+__ni_timer_heap_remove(ni_timer_t *timer)
+{
+	unsigned int index = timer->index;
+	ni_timer_t *last;
+
+	ni_assert(index < ni_timer_heap.count && ni_timer_heap.data[index] == timer);
+
+	last = ni_timer_heap.data[--ni_timer_heap.count];
+	ni_timer_heap.data[ni_timer_heap.count] = NULL;
+	if (last == timer)
+		return;
+
+	__ni_timer_heap_set(index, last);
+	if (index > 0 && __ni_timer_before(last, ni_timer_heap.data[(index - 1) / 2]))
+		__ni_timer_heap_up(index);
+	else
+		__ni_timer_heap_down(index);
+}
+
 static void
 __ni_timer_arm(ni_timer_t *timer, unsigned long timeout)
 {
-	ni_timer_t *tail, **pos;
+	static unsigned int serial;
 
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 			"%s: timer %p timeout %lu", __func__, timer, timeout);
@@ -120,29 +297,22 @@ __ni_timer_arm(ni_timer_t *timer, unsigned long timeout)
 		timer->expires.tv_sec++;
 		timer->expires.tv_usec -= 1000000;
 	}
+	timer->serial = serial++;
 
-	for (pos = &ni_timer_list; (tail = *pos) != NULL; pos = &tail->next) {
-		if (timercmp(&timer->expires, &tail->expires, <))
-			break;
-	}
-
-	timer->next = tail;
-	*pos = timer;
+	__ni_timer_hash_add(timer);
+	__ni_timer_heap_insert(timer);
 }
 
 static ni_timer_t *
 __ni_timer_disarm(const ni_timer_t *handle)
 {
-	ni_timer_t **pos, *timer;
+	ni_timer_t *timer;
 
-	for (pos = &ni_timer_list; (timer = *pos) != NULL; pos = &timer->next) {
-		if (timer == handle) {
-			*pos = timer->next;
-			timer->next = NULL;
-			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
-					"%s: timer %p found", __func__, handle);
-			return timer;
-		}
+	if ((timer = __ni_timer_hash_del(handle)) != NULL) {
+		__ni_timer_heap_remove(timer);
+		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
+				"%s: timer %p found", __func__, handle);
+		return timer;
 	}
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 			"%s: timer %p NOT found", __func__, handle);
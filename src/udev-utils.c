@@ -34,6 +34,7 @@
 #include <wicked/util.h>
 #include <wicked/netinfo.h>
 
+#include "netinfo_priv.h"
 #include "udev-utils.h"
 #include "process.h"
 #include "buffer.h"
@@ -315,8 +316,13 @@ ni_udev_netdev_update_name(ni_netdev_t *dev)
 	if (ni_string_empty(ifname))
 		return -1; /* device seems to be gone */
 
-	if (!ni_string_eq(dev->name, ifname))
+	if (!ni_string_eq(dev->name, ifname)) {
+		ni_netconfig_t *nc = ni_global_state_handle(0);
+
 		ni_string_dup(&dev->name, ifname);
+		if (nc)
+			ni_netconfig_device_index_update(nc, dev);
+	}
 
 	return 0;
 }
@@ -26,7 +26,11 @@
 #endif
 
 #include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <wicked/xml.h>
 #include <wicked/logging.h>
@@ -63,12 +67,20 @@ typedef struct xml_reader {
 
 	unsigned int		no_close : 1;
 
+	/* Regular files are mmap'ed instead of read via stdio */
+	void *			map;
+	size_t			map_len;
+
 	char *			doctype;
 
 	/* This pointer must be unsigned char, else 0xFF would
 	 * be expanded to EOF */
 	unsigned char *		pos;
 
+	/* End of the data when parsing from memory (a mmap'ed
+	 * file or an in_buffer); NULL when reading via stdio */
+	unsigned char *		end;
+
 	xml_parser_state_t	state;
 	unsigned int		lineCount;
 
@@ -103,6 +115,8 @@ static int		xml_reader_open(xml_reader_t *xr, const char *filename);
 static int		xml_reader_destroy(xml_reader_t *xr);
 static int		xml_getc(xml_reader_t *xr);
 static void		xml_ungetc(xml_reader_t *xr, int cc);
+static void		xml_get_run(xml_reader_t *xr, ni_stringbuf_t *res, int stop1, int stop2);
+static ni_bool_t	xml_skip_to(xml_reader_t *xr, const char *marker);
 
 /*
  * Document reader implementation
@@ -181,7 +195,7 @@ xml_process_document(xml_reader_t *xr)
 	xml_document_t *doc;
 	xml_node_t *root;
 
-	doc = xml_document_new();
+	doc = xml_document_new_arena();
 
 	root = xml_document_root(doc);
 	if (xr->shared_location)
@@ -193,6 +207,7 @@ xml_process_document(xml_reader_t *xr)
 		xml_document_free(doc);
 		return NULL;
 	}
+	xml_node_arena_seal(root);
 	return doc;
 }
 
@@ -200,11 +215,13 @@ xml_node_t *
 xml_node_scan(FILE *fp, const char *location)
 {
 	xml_reader_t reader;
-	xml_node_t *root = xml_node_new(NULL, NULL);
+	xml_node_t *root;
 
 	if (xml_reader_init_file(&reader, fp, location) < 0)
 		return NULL;
 
+	root = xml_node_new_arena(NULL);
+
 	if (reader.shared_location)
 		root->location = xml_location_new(reader.shared_location, reader.lineCount);
 
@@ -219,6 +236,7 @@ xml_node_scan(FILE *fp, const char *location)
 		xml_node_free(root);
 		return NULL;
 	}
+	xml_node_arena_seal(root);
 	return root;
 }
 
@@ -573,6 +591,7 @@ restart:
 				return None;
 		} else {
 			ni_stringbuf_putc(res, cc);
+			xml_get_run(xr, res, '<', '&');
 		}
 
 		cc = xml_getc(xr);
@@ -628,6 +647,18 @@ xml_get_token_tag(xml_reader_t *xr, ni_stringbuf_t *res)
 	case 'A' ... 'Z':
 	case '_':
 	case '!':
+		if (xr->end) {
+			unsigned char *p;
+
+			for (p = xr->pos; p < xr->end; ++p) {
+				if (!isalnum(*p) && *p != '_' && *p != '!' && *p != ':' && *p != '-')
+					break;
+			}
+			ni_stringbuf_put(res, (const char *) xr->pos, p - xr->pos);
+			xr->pos = p;
+			return Identifier;
+		}
+
 		while ((cc = xml_getc(xr)) != EOF) {
 			if (!isalnum(cc) && cc != '_' && cc != '!' && cc != ':' && cc != '-') {
 				xml_ungetc(xr, cc);
@@ -642,6 +673,7 @@ xml_get_token_tag(xml_reader_t *xr, ni_stringbuf_t *res)
 		ni_stringbuf_clear(res);
 		oc = cc;
 		while (1) {
+			xml_get_run(xr, res, oc, oc);
 			cc = xml_getc(xr);
 			if (cc == EOF) {
 				xml_parse_error(xr, "Unexpected EOF while parsing quoted string");
@@ -675,6 +707,11 @@ xml_skip_comment(xml_reader_t *xr)
 		return None;
 	}
 
+	if (xr->end) {
+		if (xml_skip_to(xr, "-->"))
+			return Comment;
+	}
+
 	while ((cc = xml_getc(xr)) != EOF) {
 		if (cc == '-') {
 			match++;
@@ -757,6 +794,19 @@ xml_skip_space(xml_reader_t *xr, ni_stringbuf_t *result)
 {
 	int cc;
 
+	if (xr->end) {
+		unsigned char *p;
+
+		for (p = xr->pos; p < xr->end && isspace(*p); ++p) {
+			if (*p == '\n')
+				xr->lineCount++;
+		}
+		if (result)
+			ni_stringbuf_put(result, (const char *) xr->pos, p - xr->pos);
+		xr->pos = p;
+		return;
+	}
+
 	while ((cc = xml_getc(xr)) != EOF) {
 		if (!isspace(cc)) {
 			xml_ungetc(xr, cc);
@@ -1009,11 +1059,47 @@ xml_location_free(xml_location_t *loc)
 /*
  * XML Reader object
  */
+static ni_bool_t
+xml_reader_map(xml_reader_t *xr, const char *filename)
+{
+	struct stat stb;
+	void *map;
+	int fd;
+
+	if ((fd = open(filename, O_RDONLY | O_CLOEXEC)) < 0)
+		return FALSE;
+
+	/* Files in /proc and /sys claim to be empty; use stdio for them */
+	if (fstat(fd, &stb) < 0 || !S_ISREG(stb.st_mode) || stb.st_size <= 0) {
+		close(fd);
+		return FALSE;
+	}
+
+	map = mmap(NULL, stb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return FALSE;
+
+	madvise(map, stb.st_size, MADV_SEQUENTIAL);
+	xr->map = map;
+	xr->map_len = stb.st_size;
+	xr->pos = map;
+	xr->end = xr->pos + xr->map_len;
+	return TRUE;
+}
+
 static int
 xml_reader_open(xml_reader_t *xr, const char *filename)
 {
 	memset(xr, 0, sizeof(*xr));
 	xr->filename = filename;
+	xr->state = Initial;
+	xr->lineCount = 1;
+
+	if (xml_reader_map(xr, filename)) {
+		xr->shared_location = xml_location_shared_new(filename);
+		return 0;
+	}
 
 	xr->file = fopen(filename, "r");
 	if (xr->file == NULL) {
@@ -1058,6 +1144,13 @@ xml_reader_init_buffer(xml_reader_t *xr, ni_buffer_t *buf, const char *location)
 	xr->in_buffer = buf;
 	xr->no_close = 1;
 
+	/* Parse the buffer data in place; xml_reader_destroy
+	 * consumes what we've parsed from the buffer */
+	if (buf->base) {
+		xr->pos = buf->base + buf->head;
+		xr->end = buf->base + buf->tail;
+	}
+
 	xr->state = Initial;
 	xr->lineCount = 1;
 	xr->shared_location = xml_location_shared_new(location);
@@ -1080,6 +1173,15 @@ xml_reader_destroy(xml_reader_t *xr)
 		free(xr->buffer);
 		xr->buffer = NULL;
 	}
+	if (xr->in_buffer && xr->end) {
+		xr->in_buffer->head = xr->pos - xr->in_buffer->base;
+		xr->in_buffer = NULL;
+	}
+	if (xr->map) {
+		munmap(xr->map, xr->map_len);
+		xr->map = NULL;
+	}
+	xr->pos = xr->end = NULL;
 
 	if (xr->shared_location) {
 		xml_location_shared_release(xr->shared_location);
@@ -1093,6 +1195,15 @@ xml_getc(xml_reader_t *xr)
 {
 	int cc;
 
+	if (xr->end) {
+		if (xr->pos >= xr->end)
+			return EOF;
+		cc = *xr->pos++;
+		if (cc == '\n')
+			xr->lineCount++;
+		return cc;
+	}
+
 	if (xr->in_buffer) {
 		cc = ni_buffer_getc(xr->in_buffer);
 		if (cc == '\n')
@@ -1127,6 +1238,19 @@ xml_getc(xml_reader_t *xr)
 void
 xml_ungetc(xml_reader_t *xr, int cc)
 {
+	if (xr->end) {
+		if (cc == EOF)
+			return;
+		if (xr->pos == NULL || xr->pos[-1] != cc) {
+			ni_error("xml_ungetc: cannot put back");
+			return;
+		}
+		if (cc == '\n')
+			xr->lineCount--;
+		xr->pos--;
+		return;
+	}
+
 	if (xr->in_buffer) {
 		if (ni_buffer_ungetc(xr->in_buffer, cc) < 0)
 			ni_error("xml_ungetc: cannot put back");
@@ -1151,3 +1275,46 @@ xml_ungetc(xml_reader_t *xr, int cc)
 	xr->pos--;
 }
 
+
+/*
+ * When parsing from memory, move everything up to (but not including)
+ * the next @stop1 or @stop2 character to @res in one go.
+ */
+static void
+xml_get_run(xml_reader_t *xr, ni_stringbuf_t *res, int stop1, int stop2)
+{
+	unsigned char *p, *q, *nl;
+
+	if (!xr->end || xr->pos >= xr->end)
+		return;
+
+	if (!(p = memchr(xr->pos, stop1, xr->end - xr->pos)))
+		p = xr->end;
+	if (stop2 != stop1 && (q = memchr(xr->pos, stop2, p - xr->pos)))
+		p = q;
+
+	for (nl = xr->pos; (nl = memchr(nl, '\n', p - nl)) != NULL; ++nl)
+		xr->lineCount++;
+
+	ni_stringbuf_put(res, (const char *) xr->pos, p - xr->pos);
+	xr->pos = p;
+}
+
+/*
+ * When parsing from memory, skip past the next occurrence of @marker
+ */
+static ni_bool_t
+xml_skip_to(xml_reader_t *xr, const char *marker)
+{
+	size_t len = strlen(marker);
+	unsigned char *p, *nl;
+
+	if (!xr->end || !(p = memmem(xr->pos, xr->end - xr->pos, marker, len)))
+		return FALSE;
+
+	p += len;
+	for (nl = xr->pos; (nl = memchr(nl, '\n', p - nl)) != NULL; ++nl)
+		xr->lineCount++;
+	xr->pos = p;
+	return TRUE;
+}
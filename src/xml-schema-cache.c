@@ -0,0 +1,1248 @@
+/*
+ *	Compiled cache of the xml schema.
+ *
+ *	Processing the schema xml files is a noticeable part of the startup
+ *	of every wicked program. The scope tree built from them is stored in
+ *	a binary image in the state directory, which is mmap'ed and decoded
+ *	by later processes instead of parsing and processing the xml again.
+ *
+ *	The image is used only when it has been written by the same wicked
+ *	version, the checksum of its data matches, and none of the schema
+ *	files it was built from has changed since.
+ *
+ *	Copyright (C) 2016 SUSE Linux GmbH, Nuernberg, Germany.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <limits.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <wicked/logging.h>
+#include <wicked/util.h>
+#include <wicked/xml.h>
+#include "xml-schema.h"
+#include "util_priv.h"
+#include "buffer.h"
+
+#define NI_XS_CACHE_MAGIC	0x57584353	/* "WXCS" */
+#define NI_XS_CACHE_VERSION	1
+#define NI_XS_CACHE_DIGEST_LEN	20		/* sha1 */
+#define NI_XS_CACHE_CHUNK	65536
+
+typedef struct ni_xs_cache_header {
+	uint32_t		magic;
+	uint32_t		version;
+	uint32_t		length;
+	unsigned char		digest[NI_XS_CACHE_DIGEST_LEN];
+} ni_xs_cache_header_t;
+
+/*
+ * Maps the objects shared in the scope graph (types, groups, constraint
+ * maps and ranges) to the index they're stored at in the image.
+ */
+typedef struct ni_xs_cache_table {
+	unsigned int		count;
+	const void **		data;
+
+	unsigned int		hsize;
+	unsigned int *		hash;		/* index + 1 */
+} ni_xs_cache_table_t;
+
+typedef struct ni_xs_cache_writer {
+	ni_buffer_t		buf;
+
+	const ni_xs_scope_t *	root;
+	unsigned int		nbuiltin;
+
+	ni_xs_cache_table_t	scopes;
+	ni_xs_cache_table_t	types;
+	ni_xs_cache_table_t	groups;
+	ni_xs_cache_table_t	maps;
+	ni_xs_cache_table_t	ranges;
+} ni_xs_cache_writer_t;
+
+typedef struct ni_xs_cache_reader {
+	ni_buffer_t		buf;
+	ni_bool_t		error;
+
+	ni_xs_scope_t *		root;
+	unsigned int		nbuiltin;
+
+	unsigned int		nscopes;
+	ni_xs_scope_t **	scopes;
+	unsigned int		ntypes;
+	ni_xs_type_t **		types;
+	unsigned int		ngroups;
+	ni_xs_group_t **	groups;
+	unsigned int		nmaps;
+	ni_xs_intmap_t **	maps;
+	unsigned int		nranges;
+	ni_xs_range_t **	ranges;
+} ni_xs_cache_reader_t;
+
+/*
+ * Object tables
+ */
+static inline unsigned int
+ni_xs_cache_table_slot(const ni_xs_cache_table_t *table, const void *ptr)
+{
+	return ((uintptr_t) ptr >> 4) * 2654435761U & (table->hsize - 1);
+}
+
+static unsigned int
+ni_xs_cache_table_find(const ni_xs_cache_table_t *table, const void *ptr)
+{
+	unsigned int slot, idx;
+
+	if (!table->hsize)
+		return 0;
+
+	slot = ni_xs_cache_table_slot(table, ptr);
+	while ((idx = table->hash[slot]) != 0) {
+		if (table->data[idx - 1] == ptr)
+			return idx;
+		slot = (slot + 1) & (table->hsize - 1);
+	}
+	return 0;
+}
+
+static void
+ni_xs_cache_table_rehash(ni_xs_cache_table_t *table)
+{
+	unsigned int i, slot;
+
+	free(table->hash);
+	table->hsize = table->hsize ? table->hsize * 2 : 256;
+	table->hash = xcalloc(table->hsize, sizeof(table->hash[0]));
+
+	for (i = 0; i < table->count; ++i) {
+		slot = ni_xs_cache_table_slot(table, table->data[i]);
+		while (table->hash[slot])
+			slot = (slot + 1) & (table->hsize - 1);
+		table->hash[slot] = i + 1;
+	}
+}
+
+/*
+ * Add an object unless it is already known; returns TRUE if it was new
+ */
+static ni_bool_t
+ni_xs_cache_table_add(ni_xs_cache_table_t *table, const void *ptr)
+{
+	unsigned int slot;
+
+	if (ni_xs_cache_table_find(table, ptr))
+		return FALSE;
+
+	if ((table->count % 64) == 0)
+		table->data = xrealloc(table->data, (table->count + 64) * sizeof(table->data[0]));
+	table->data[table->count++] = ptr;
+
+	if (2 * table->count > table->hsize) {
+		ni_xs_cache_table_rehash(table);
+	} else {
+		slot = ni_xs_cache_table_slot(table, ptr);
+		while (table->hash[slot])
+			slot = (slot + 1) & (table->hsize - 1);
+		table->hash[slot] = table->count;
+	}
+	return TRUE;
+}
+
+static void
+ni_xs_cache_table_destroy(ni_xs_cache_table_t *table)
+{
+	free(table->data);
+	free(table->hash);
+	memset(table, 0, sizeof(*table));
+}
+
+/*
+ * Collect all objects reachable from the scope tree
+ */
+static void	ni_xs_cache_collect_type(ni_xs_cache_writer_t *, const ni_xs_type_t *);
+
+static void
+ni_xs_cache_collect_name_types(ni_xs_cache_writer_t *w, const ni_xs_name_type_array_t *array)
+{
+	unsigned int i;
+
+	for (i = 0; i < array->count; ++i)
+		ni_xs_cache_collect_type(w, array->data[i].type);
+}
+
+static void
+ni_xs_cache_collect_group(ni_xs_cache_writer_t *w, const ni_xs_group_t *group)
+{
+	if (group)
+		ni_xs_cache_table_add(&w->groups, group);
+}
+
+void
+ni_xs_cache_collect_type(ni_xs_cache_writer_t *w, const ni_xs_type_t *type)
+{
+	ni_xs_scalar_info_t *scalar_info;
+	unsigned int i;
+
+	if (type == NULL || !ni_xs_cache_table_add(&w->types, type))
+		return;
+
+	ni_xs_cache_collect_group(w, type->constraint.group);
+	switch (type->class) {
+	case NI_XS_TYPE_SCALAR:
+		scalar_info = type->u.scalar_info;
+		if (scalar_info->constraint.enums)
+			ni_xs_cache_table_add(&w->maps, scalar_info->constraint.enums);
+		if (scalar_info->constraint.bitmap)
+			ni_xs_cache_table_add(&w->maps, scalar_info->constraint.bitmap);
+		if (scalar_info->constraint.bitmask)
+			ni_xs_cache_table_add(&w->maps, scalar_info->constraint.bitmask);
+		if (scalar_info->constraint.range)
+			ni_xs_cache_table_add(&w->ranges, scalar_info->constraint.range);
+		break;
+
+	case NI_XS_TYPE_DICT:
+		ni_xs_cache_collect_name_types(w, &type->u.dict_info->children);
+		for (i = 0; i < type->u.dict_info->groups.count; ++i)
+			ni_xs_cache_collect_group(w, type->u.dict_info->groups.data[i]);
+		break;
+
+	case NI_XS_TYPE_STRUCT:
+		ni_xs_cache_collect_name_types(w, &type->u.struct_info->children);
+		break;
+
+	case NI_XS_TYPE_UNION:
+		ni_xs_cache_collect_name_types(w, &type->u.union_info->children);
+		break;
+
+	case NI_XS_TYPE_ARRAY:
+		ni_xs_cache_collect_type(w, type->u.array_info->element_type);
+		break;
+	}
+}
+
+static void
+ni_xs_cache_collect_methods(ni_xs_cache_writer_t *w, const ni_xs_method_t *method)
+{
+	for (; method; method = method->next) {
+		ni_xs_cache_collect_name_types(w, &method->arguments);
+		ni_xs_cache_collect_type(w, method->retval);
+	}
+}
+
+static void
+ni_xs_cache_collect_scope(ni_xs_cache_writer_t *w, const ni_xs_scope_t *scope)
+{
+	const ni_xs_service_t *service;
+	const ni_xs_scope_t *child;
+
+	ni_xs_cache_table_add(&w->scopes, scope);
+	ni_xs_cache_collect_name_types(w, &scope->types);
+	for (service = scope->services; service; service = service->next) {
+		ni_xs_cache_collect_methods(w, service->methods);
+		ni_xs_cache_collect_methods(w, service->signals);
+	}
+	for (child = scope->children; child; child = child->next)
+		ni_xs_cache_collect_scope(w, child);
+}
+
+/*
+ * Encoding primitives
+ */
+static void
+ni_xs_cache_put(ni_xs_cache_writer_t *w, const void *data, size_t len)
+{
+	if (ni_buffer_tailroom(&w->buf) < len)
+		ni_buffer_ensure_tailroom(&w->buf, max_t(size_t, len, NI_XS_CACHE_CHUNK));
+	ni_buffer_put(&w->buf, data, len);
+}
+
+static inline void
+ni_xs_cache_put_uint(ni_xs_cache_writer_t *w, uint32_t value)
+{
+	ni_xs_cache_put(w, &value, sizeof(value));
+}
+
+static inline void
+ni_xs_cache_put_ulong(ni_xs_cache_writer_t *w, uint64_t value)
+{
+	ni_xs_cache_put(w, &value, sizeof(value));
+}
+
+static void
+ni_xs_cache_put_string(ni_xs_cache_writer_t *w, const char *string)
+{
+	size_t len = string ? strlen(string) + 1 : 0;
+
+	ni_xs_cache_put_uint(w, len);
+	if (len)
+		ni_xs_cache_put(w, string, len);
+}
+
+static inline void
+ni_xs_cache_put_ref(ni_xs_cache_writer_t *w, const ni_xs_cache_table_t *table, const void *ptr)
+{
+	ni_xs_cache_put_uint(w, ptr ? ni_xs_cache_table_find(table, ptr) : 0);
+}
+
+static void
+ni_xs_cache_put_vars(ni_xs_cache_writer_t *w, const ni_var_array_t *vars)
+{
+	unsigned int i;
+
+	ni_xs_cache_put_uint(w, vars->count);
+	for (i = 0; i < vars->count; ++i) {
+		ni_xs_cache_put_string(w, vars->data[i].name);
+		ni_xs_cache_put_string(w, vars->data[i].value);
+	}
+}
+
+static void
+ni_xs_cache_put_xml(ni_xs_cache_writer_t *w, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int count = 0;
+
+	if (node == NULL) {
+		ni_xs_cache_put_uint(w, 0);
+		return;
+	}
+
+	ni_xs_cache_put_uint(w, 1);
+	ni_xs_cache_put_string(w, node->name);
+	ni_xs_cache_put_string(w, node->cdata);
+	ni_xs_cache_put_vars(w, &node->attrs);
+
+	for (child = node->children; child; child = child->next)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+	for (child = node->children; child; child = child->next)
+		ni_xs_cache_put_xml(w, child);
+}
+
+static void
+ni_xs_cache_put_name_types(ni_xs_cache_writer_t *w, const ni_xs_name_type_array_t *array, unsigned int start)
+{
+	const ni_xs_name_type_t *def;
+	unsigned int i;
+
+	ni_xs_cache_put_uint(w, array->count - start);
+	for (i = start, def = array->data + start; i < array->count; ++i, ++def) {
+		ni_xs_cache_put_string(w, def->name);
+		ni_xs_cache_put_ref(w, &w->types, def->type);
+		ni_xs_cache_put_string(w, def->description);
+	}
+}
+
+/*
+ * Encode the objects and the scope tree
+ */
+static void
+ni_xs_cache_put_type(ni_xs_cache_writer_t *w, const ni_xs_type_t *type)
+{
+	const ni_xs_scalar_info_t *scalar_info;
+	const ni_xs_array_info_t *array_info;
+	const ni_xs_dict_info_t *dict_info;
+	unsigned int i;
+
+	ni_xs_cache_put_string(w, type->name);
+	ni_xs_cache_put_string(w, type->description);
+	ni_xs_cache_put_uint(w, type->constraint.mandatory);
+	ni_xs_cache_put_ref(w, &w->groups, type->constraint.group);
+	ni_xs_cache_put_xml(w, type->meta);
+
+	switch (type->class) {
+	case NI_XS_TYPE_SCALAR:
+		scalar_info = type->u.scalar_info;
+		ni_xs_cache_put_string(w, scalar_info->basic_name);
+		ni_xs_cache_put_uint(w, scalar_info->type);
+		ni_xs_cache_put_ref(w, &w->maps, scalar_info->constraint.enums);
+		ni_xs_cache_put_ref(w, &w->ranges, scalar_info->constraint.range);
+		ni_xs_cache_put_ref(w, &w->maps, scalar_info->constraint.bitmap);
+		ni_xs_cache_put_ref(w, &w->maps, scalar_info->constraint.bitmask);
+		break;
+
+	case NI_XS_TYPE_DICT:
+		dict_info = type->u.dict_info;
+		ni_xs_cache_put_name_types(w, &dict_info->children, 0);
+		ni_xs_cache_put_uint(w, dict_info->groups.count);
+		for (i = 0; i < dict_info->groups.count; ++i)
+			ni_xs_cache_put_ref(w, &w->groups, dict_info->groups.data[i]);
+		break;
+
+	case NI_XS_TYPE_STRUCT:
+		ni_xs_cache_put_name_types(w, &type->u.struct_info->children, 0);
+		break;
+
+	case NI_XS_TYPE_UNION:
+		ni_xs_cache_put_string(w, type->u.union_info->discriminant);
+		ni_xs_cache_put_name_types(w, &type->u.union_info->children, 0);
+		break;
+
+	case NI_XS_TYPE_ARRAY:
+		array_info = type->u.array_info;
+		ni_xs_cache_put_ref(w, &w->types, array_info->element_type);
+		ni_xs_cache_put_string(w, array_info->element_name);
+		ni_xs_cache_put_ulong(w, array_info->minlen);
+		ni_xs_cache_put_ulong(w, array_info->maxlen);
+		ni_xs_cache_put_string(w, array_info->notation ? array_info->notation->name : NULL);
+		break;
+	}
+}
+
+static void
+ni_xs_cache_put_methods(ni_xs_cache_writer_t *w, const ni_xs_method_t *list)
+{
+	const ni_xs_method_t *method;
+	unsigned int count = 0;
+
+	for (method = list; method; method = method->next)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+
+	for (method = list; method; method = method->next) {
+		ni_xs_cache_put_string(w, method->name);
+		ni_xs_cache_put_string(w, method->description);
+		ni_xs_cache_put_name_types(w, &method->arguments, 0);
+		ni_xs_cache_put_ref(w, &w->types, method->retval);
+		ni_xs_cache_put_xml(w, method->meta);
+	}
+}
+
+static void
+ni_xs_cache_put_scope(ni_xs_cache_writer_t *w, const ni_xs_scope_t *scope)
+{
+	const ni_xs_service_t *service;
+	const ni_xs_class_t *class;
+	const ni_xs_scope_t *child;
+	unsigned int count, index;
+
+	ni_xs_cache_put_string(w, scope->name);
+	ni_xs_cache_put_name_types(w, &scope->types, scope == w->root ? w->nbuiltin : 0);
+	ni_xs_cache_put_vars(w, &scope->constants);
+
+	for (count = 0, class = scope->classes; class; class = class->next)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+	for (class = scope->classes; class; class = class->next) {
+		ni_xs_cache_put_string(w, class->name);
+		ni_xs_cache_put_string(w, class->base_name);
+	}
+
+	for (count = 0, service = scope->services; service; service = service->next)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+	for (service = scope->services; service; service = service->next) {
+		ni_xs_cache_put_string(w, service->name);
+		ni_xs_cache_put_string(w, service->interface);
+		ni_xs_cache_put_string(w, service->description);
+		ni_xs_cache_put_vars(w, &service->attributes);
+		ni_xs_cache_put_methods(w, service->methods);
+		ni_xs_cache_put_methods(w, service->signals);
+	}
+
+	/* the defining service lives in the parent scope */
+	index = 0;
+	if (scope->defined_by.service && scope->parent) {
+		for (count = 1, service = scope->parent->services; service; service = service->next, ++count) {
+			if (service == scope->defined_by.service) {
+				index = count;
+				break;
+			}
+		}
+	}
+	ni_xs_cache_put_uint(w, index);
+
+	for (count = 0, child = scope->children; child; child = child->next)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+	for (child = scope->children; child; child = child->next)
+		ni_xs_cache_put_scope(w, child);
+}
+
+/*
+ * The original definition of a type is referenced by the scope and the
+ * index of the name in the scope types. Types defined in temporary scopes
+ * that are gone already do not get one.
+ */
+static void
+ni_xs_cache_put_origdef(ni_xs_cache_writer_t *w, const ni_xs_type_t *type)
+{
+	const ni_xs_scope_t *scope = type->origdef.scope;
+	unsigned int id = 0, index = 0, i;
+
+	if (scope && type->origdef.name && (id = ni_xs_cache_table_find(&w->scopes, scope))) {
+		for (i = 0; i < scope->types.count; ++i) {
+			if (scope->types.data[i].name == type->origdef.name)
+				break;
+		}
+		if (i < scope->types.count)
+			index = i;
+		else
+			id = 0;
+	}
+	ni_xs_cache_put_uint(w, id);
+	ni_xs_cache_put_uint(w, index);
+}
+
+static void
+ni_xs_cache_encode(ni_xs_cache_writer_t *w, const char *filename, const ni_string_array_t *files)
+{
+	const ni_xs_intmap_t *map;
+	const ni_xs_range_t *range;
+	const ni_xs_group_t *group;
+	const ni_intmap_t *bits;
+	struct stat stb;
+	unsigned int i, count;
+
+	ni_xs_cache_put_string(w, PACKAGE_VERSION);
+	ni_xs_cache_put_string(w, filename);
+
+	ni_xs_cache_put_uint(w, files->count);
+	for (i = 0; i < files->count; ++i) {
+		if (stat(files->data[i], &stb) < 0)
+			memset(&stb, 0, sizeof(stb));
+		ni_xs_cache_put_string(w, files->data[i]);
+		ni_xs_cache_put_ulong(w, stb.st_ino);
+		ni_xs_cache_put_ulong(w, stb.st_size);
+		ni_xs_cache_put_ulong(w, stb.st_mtim.tv_sec);
+		ni_xs_cache_put_ulong(w, stb.st_mtim.tv_nsec);
+	}
+
+	/* The builtin types are not stored, but referenced by index */
+	ni_xs_cache_put_uint(w, w->nbuiltin);
+	for (i = 0; i < w->nbuiltin; ++i) {
+		ni_xs_cache_put_string(w, w->root->types.data[i].name);
+		ni_xs_cache_table_add(&w->types, w->root->types.data[i].type);
+	}
+	ni_xs_cache_collect_scope(w, w->root);
+
+	ni_xs_cache_put_uint(w, w->groups.count);
+	for (i = 0; i < w->groups.count; ++i) {
+		group = w->groups.data[i];
+		ni_xs_cache_put_uint(w, group->relation);
+		ni_xs_cache_put_string(w, group->name);
+	}
+
+	ni_xs_cache_put_uint(w, w->maps.count);
+	for (i = 0; i < w->maps.count; ++i) {
+		map = w->maps.data[i];
+		for (count = 0, bits = map->bits; bits && bits->name; ++bits)
+			count++;
+		ni_xs_cache_put_uint(w, count);
+		for (bits = map->bits; bits && bits->name; ++bits) {
+			ni_xs_cache_put_string(w, bits->name);
+			ni_xs_cache_put_uint(w, bits->value);
+		}
+	}
+
+	ni_xs_cache_put_uint(w, w->ranges.count);
+	for (i = 0; i < w->ranges.count; ++i) {
+		range = w->ranges.data[i];
+		ni_xs_cache_put_ulong(w, range->min);
+		ni_xs_cache_put_ulong(w, range->max);
+	}
+
+	/* First the classes, so that the types can be allocated up front */
+	ni_xs_cache_put_uint(w, w->types.count);
+	for (i = w->nbuiltin; i < w->types.count; ++i)
+		ni_xs_cache_put_uint(w, ((const ni_xs_type_t *) w->types.data[i])->class);
+	for (i = w->nbuiltin; i < w->types.count; ++i)
+		ni_xs_cache_put_type(w, w->types.data[i]);
+
+	ni_xs_cache_put_scope(w, w->root);
+
+	for (i = w->nbuiltin; i < w->types.count; ++i)
+		ni_xs_cache_put_origdef(w, w->types.data[i]);
+}
+
+static ni_bool_t
+ni_xs_cache_digest(const void *data, size_t len, unsigned char *digest)
+{
+	ni_hashctx_t *ctx;
+	ni_bool_t rv;
+
+	if (!(ctx = ni_hashctx_new(NI_HASHCTX_SHA1)))
+		return FALSE;
+
+	ni_hashctx_put(ctx, data, len);
+	ni_hashctx_finish(ctx);
+	rv = ni_hashctx_get_digest(ctx, digest, NI_XS_CACHE_DIGEST_LEN) == NI_XS_CACHE_DIGEST_LEN;
+	ni_hashctx_free(ctx);
+	return rv;
+}
+
+/*
+ * Write the cache image for the schema built from @filename and @files
+ * (the file and all files it includes). The root scope starts with
+ * @nbuiltin types that have not been defined by the schema files.
+ */
+int
+ni_xs_cache_save(const char *cachefile, const char *filename, const ni_string_array_t *files,
+		const ni_xs_scope_t *scope, unsigned int nbuiltin)
+{
+	ni_xs_cache_writer_t w;
+	ni_xs_cache_header_t hdr;
+	char tempname[PATH_MAX];
+	int fd, rv = -1;
+
+	if (nbuiltin > scope->types.count)
+		return -1;
+
+	memset(&w, 0, sizeof(w));
+	ni_buffer_init_dynamic(&w.buf, NI_XS_CACHE_CHUNK);
+	w.root = scope;
+	w.nbuiltin = nbuiltin;
+
+	ni_xs_cache_encode(&w, filename, files);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = NI_XS_CACHE_MAGIC;
+	hdr.version = NI_XS_CACHE_VERSION;
+	hdr.length = ni_buffer_count(&w.buf);
+	if (w.buf.overflow || !ni_xs_cache_digest(ni_buffer_head(&w.buf), hdr.length, hdr.digest))
+		goto out;
+
+	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", cachefile);
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_debug_xml("cannot create schema cache %s: %m", tempname);
+		goto out;
+	}
+
+	/* non-root clients may use the cache as well */
+	if (fchmod(fd, 0644) < 0
+	 || write(fd, &hdr, sizeof(hdr)) != sizeof(hdr)
+	 || write(fd, ni_buffer_head(&w.buf), hdr.length) != (ssize_t) hdr.length) {
+		ni_debug_xml("cannot write schema cache %s: %m", tempname);
+		close(fd);
+		unlink(tempname);
+		goto out;
+	}
+	close(fd);
+
+	if (rename(tempname, cachefile) < 0) {
+		ni_debug_xml("cannot rename schema cache %s to %s: %m", tempname, cachefile);
+		unlink(tempname);
+		goto out;
+	}
+
+	ni_debug_xml("wrote schema cache %s (%u types, %u bytes)",
+			cachefile, w.types.count - nbuiltin, hdr.length);
+	rv = 0;
+
+out:
+	ni_xs_cache_table_destroy(&w.scopes);
+	ni_xs_cache_table_destroy(&w.types);
+	ni_xs_cache_table_destroy(&w.groups);
+	ni_xs_cache_table_destroy(&w.maps);
+	ni_xs_cache_table_destroy(&w.ranges);
+	ni_buffer_destroy(&w.buf);
+	return rv;
+}
+
+/*
+ * Decoding primitives. Any error is sticky, and turns all further
+ * reads into zero or NULL values.
+ */
+static void
+ni_xs_cache_get(ni_xs_cache_reader_t *r, void *data, size_t len)
+{
+	if (r->error || ni_buffer_get(&r->buf, data, len) < 0) {
+		r->error = TRUE;
+		memset(data, 0, len);
+	}
+}
+
+static inline uint32_t
+ni_xs_cache_get_uint(ni_xs_cache_reader_t *r)
+{
+	uint32_t value;
+
+	ni_xs_cache_get(r, &value, sizeof(value));
+	return value;
+}
+
+static inline uint64_t
+ni_xs_cache_get_ulong(ni_xs_cache_reader_t *r)
+{
+	uint64_t value;
+
+	ni_xs_cache_get(r, &value, sizeof(value));
+	return value;
+}
+
+/*
+ * Returns a string pointing into the image
+ */
+static const char *
+ni_xs_cache_get_string(ni_xs_cache_reader_t *r)
+{
+	uint32_t len = ni_xs_cache_get_uint(r);
+	const char *string;
+
+	if (r->error || len == 0)
+		return NULL;
+
+	string = ni_buffer_pull_head(&r->buf, len);
+	if (string == NULL || string[len - 1] != '\0') {
+		r->error = TRUE;
+		return NULL;
+	}
+	return string;
+}
+
+static inline char *
+ni_xs_cache_dup_string(ni_xs_cache_reader_t *r)
+{
+	return xstrdup(ni_xs_cache_get_string(r));
+}
+
+/*
+ * Validate a count against the data left in the image; every
+ * element takes at least @min_size bytes.
+ */
+static unsigned int
+ni_xs_cache_get_count(ni_xs_cache_reader_t *r, size_t min_size)
+{
+	uint32_t count = ni_xs_cache_get_uint(r);
+
+	if (count > ni_buffer_count(&r->buf) / min_size) {
+		r->error = TRUE;
+		return 0;
+	}
+	return count;
+}
+
+static ni_xs_type_t *
+ni_xs_cache_get_type_ref(ni_xs_cache_reader_t *r)
+{
+	uint32_t id = ni_xs_cache_get_uint(r);
+
+	if (id == 0)
+		return NULL;
+	if (id > r->ntypes) {
+		r->error = TRUE;
+		return NULL;
+	}
+	return ni_xs_type_hold(r->types[id - 1]);
+}
+
+static ni_xs_group_t *
+ni_xs_cache_get_group_ref(ni_xs_cache_reader_t *r)
+{
+	uint32_t id = ni_xs_cache_get_uint(r);
+
+	if (id == 0)
+		return NULL;
+	if (id > r->ngroups) {
+		r->error = TRUE;
+		return NULL;
+	}
+	r->groups[id - 1]->refcount++;
+	return r->groups[id - 1];
+}
+
+static ni_xs_intmap_t *
+ni_xs_cache_get_map_ref(ni_xs_cache_reader_t *r)
+{
+	uint32_t id = ni_xs_cache_get_uint(r);
+
+	if (id == 0)
+		return NULL;
+	if (id > r->nmaps) {
+		r->error = TRUE;
+		return NULL;
+	}
+	r->maps[id - 1]->refcount++;
+	return r->maps[id - 1];
+}
+
+static ni_xs_range_t *
+ni_xs_cache_get_range_ref(ni_xs_cache_reader_t *r)
+{
+	uint32_t id = ni_xs_cache_get_uint(r);
+
+	if (id == 0)
+		return NULL;
+	if (id > r->nranges) {
+		r->error = TRUE;
+		return NULL;
+	}
+	r->ranges[id - 1]->refcount++;
+	return r->ranges[id - 1];
+}
+
+static void
+ni_xs_cache_get_vars(ni_xs_cache_reader_t *r, ni_var_array_t *vars)
+{
+	unsigned int i, count;
+	const char *name;
+
+	count = ni_xs_cache_get_count(r, 8);
+	for (i = 0; i < count && !r->error; ++i) {
+		name = ni_xs_cache_get_string(r);
+		ni_var_array_append(vars, name, ni_xs_cache_get_string(r));
+	}
+}
+
+static xml_node_t *
+ni_xs_cache_get_xml(ni_xs_cache_reader_t *r, xml_node_t *parent)
+{
+	unsigned int i, count;
+	xml_node_t *node;
+
+	if (ni_xs_cache_get_uint(r) == 0 || r->error)
+		return NULL;
+
+	node = xml_node_new(ni_xs_cache_get_string(r), parent);
+	xml_node_set_cdata(node, ni_xs_cache_get_string(r));
+	ni_xs_cache_get_vars(r, &node->attrs);
+
+	count = ni_xs_cache_get_count(r, 4);
+	for (i = 0; i < count && !r->error; ++i)
+		ni_xs_cache_get_xml(r, node);
+	return node;
+}
+
+static void
+ni_xs_cache_get_name_types(ni_xs_cache_reader_t *r, ni_xs_name_type_array_t *array)
+{
+	ni_xs_name_type_t *def;
+	unsigned int i, count;
+
+	count = ni_xs_cache_get_count(r, 12);
+	if (!count)
+		return;
+
+	/* same allocation chunks as ni_xs_name_type_array_append */
+	array->data = xrealloc(array->data, (array->count + count + 31) / 32 * 32 * sizeof(array->data[0]));
+	for (i = 0; i < count && !r->error; ++i) {
+		def = &array->data[array->count++];
+		def->name = ni_xs_cache_dup_string(r);
+		def->type = ni_xs_cache_get_type_ref(r);
+		def->description = ni_xs_cache_dup_string(r);
+	}
+}
+
+/*
+ * Scalar types keep a pointer to the static name of the basic type
+ */
+static const char *
+ni_xs_cache_basic_name(ni_xs_cache_reader_t *r, const char *name)
+{
+	ni_xs_type_t *type;
+	unsigned int i;
+
+	if (name == NULL)
+		return NULL;
+
+	for (i = 0; i < r->nbuiltin; ++i) {
+		type = r->types[i];
+		if (type->class == NI_XS_TYPE_SCALAR
+		 && ni_string_eq(type->u.scalar_info->basic_name, name))
+			return type->u.scalar_info->basic_name;
+	}
+	r->error = TRUE;
+	return NULL;
+}
+
+static ni_xs_type_t *
+ni_xs_cache_new_type(unsigned int class)
+{
+	ni_xs_type_t *type;
+
+	switch (class) {
+	case NI_XS_TYPE_VOID:
+		type = xcalloc(1, sizeof(*type));
+		type->refcount = 1;
+		type->class = class;
+		return type;
+	case NI_XS_TYPE_SCALAR:
+		return ni_xs_scalar_new(NULL, 0);
+	case NI_XS_TYPE_DICT:
+		return ni_xs_dict_new(NULL);
+	case NI_XS_TYPE_STRUCT:
+		return ni_xs_struct_new(NULL);
+	case NI_XS_TYPE_UNION:
+		return ni_xs_union_new(NULL, NULL);
+	case NI_XS_TYPE_ARRAY:
+		return ni_xs_array_new(NULL, NULL, 0, 0);
+	}
+	return NULL;
+}
+
+static void
+ni_xs_cache_get_type(ni_xs_cache_reader_t *r, ni_xs_type_t *type)
+{
+	ni_xs_scalar_info_t *scalar_info;
+	ni_xs_array_info_t *array_info;
+	ni_xs_dict_info_t *dict_info;
+	unsigned int i, count;
+	const char *name;
+
+	type->name = ni_xs_cache_dup_string(r);
+	type->description = ni_xs_cache_dup_string(r);
+	type->constraint.mandatory = !!ni_xs_cache_get_uint(r);
+	type->constraint.group = ni_xs_cache_get_group_ref(r);
+	type->meta = ni_xs_cache_get_xml(r, NULL);
+
+	switch (type->class) {
+	case NI_XS_TYPE_SCALAR:
+		scalar_info = type->u.scalar_info;
+		scalar_info->basic_name = ni_xs_cache_basic_name(r, ni_xs_cache_get_string(r));
+		scalar_info->type = ni_xs_cache_get_uint(r);
+		scalar_info->constraint.enums = ni_xs_cache_get_map_ref(r);
+		scalar_info->constraint.range = ni_xs_cache_get_range_ref(r);
+		scalar_info->constraint.bitmap = ni_xs_cache_get_map_ref(r);
+		scalar_info->constraint.bitmask = ni_xs_cache_get_map_ref(r);
+		break;
+
+	case NI_XS_TYPE_DICT:
+		dict_info = type->u.dict_info;
+		ni_xs_cache_get_name_types(r, &dict_info->children);
+		count = ni_xs_cache_get_count(r, 4);
+		if (count)
+			dict_info->groups.data = xcalloc(count, sizeof(dict_info->groups.data[0]));
+		for (i = 0; i < count && !r->error; ++i)
+			dict_info->groups.data[dict_info->groups.count++] = ni_xs_cache_get_group_ref(r);
+		break;
+
+	case NI_XS_TYPE_STRUCT:
+		ni_xs_cache_get_name_types(r, &type->u.struct_info->children);
+		break;
+
+	case NI_XS_TYPE_UNION:
+		type->u.union_info->discriminant = ni_xs_cache_dup_string(r);
+		ni_xs_cache_get_name_types(r, &type->u.union_info->children);
+		break;
+
+	case NI_XS_TYPE_ARRAY:
+		array_info = type->u.array_info;
+		array_info->element_type = ni_xs_cache_get_type_ref(r);
+		ni_string_free(&array_info->element_name);
+		array_info->element_name = ni_xs_cache_dup_string(r);
+		array_info->minlen = ni_xs_cache_get_ulong(r);
+		array_info->maxlen = ni_xs_cache_get_ulong(r);
+		if ((name = ni_xs_cache_get_string(r)) != NULL
+		 && !(array_info->notation = ni_xs_get_array_notation(name)))
+			r->error = TRUE;
+		if (array_info->element_type == NULL)
+			r->error = TRUE;
+		break;
+	}
+}
+
+static void
+ni_xs_cache_get_methods(ni_xs_cache_reader_t *r, ni_xs_method_t **list)
+{
+	ni_xs_method_t *method;
+	unsigned int i, count;
+
+	count = ni_xs_cache_get_count(r, 16);
+	for (i = 0; i < count && !r->error; ++i) {
+		method = xcalloc(1, sizeof(*method));
+		*list = method;
+		list = &method->next;
+
+		method->name = ni_xs_cache_dup_string(r);
+		method->description = ni_xs_cache_dup_string(r);
+		ni_xs_cache_get_name_types(r, &method->arguments);
+		method->retval = ni_xs_cache_get_type_ref(r);
+		method->meta = ni_xs_cache_get_xml(r, NULL);
+	}
+}
+
+static void
+ni_xs_cache_get_scope(ni_xs_cache_reader_t *r, ni_xs_scope_t *scope)
+{
+	ni_xs_service_t *service, **services;
+	ni_xs_class_t *class, **classes;
+	unsigned int i, count, index;
+
+	r->scopes = xrealloc(r->scopes, (r->nscopes + 1) * sizeof(r->scopes[0]));
+	r->scopes[r->nscopes++] = scope;
+
+	ni_xs_cache_get_name_types(r, &scope->types);
+	ni_xs_cache_get_vars(r, &scope->constants);
+
+	for (classes = &scope->classes; *classes; classes = &(*classes)->next)
+		;
+	count = ni_xs_cache_get_count(r, 8);
+	for (i = 0; i < count && !r->error; ++i) {
+		class = xcalloc(1, sizeof(*class));
+		class->name = ni_xs_cache_dup_string(r);
+		class->base_name = ni_xs_cache_dup_string(r);
+		*classes = class;
+		classes = &class->next;
+	}
+
+	for (services = &scope->services; *services; services = &(*services)->next)
+		;
+	count = ni_xs_cache_get_count(r, 20);
+	for (i = 0; i < count && !r->error; ++i) {
+		service = xcalloc(1, sizeof(*service));
+		*services = service;
+		services = &service->next;
+
+		service->name = ni_xs_cache_dup_string(r);
+		service->interface = ni_xs_cache_dup_string(r);
+		service->description = ni_xs_cache_dup_string(r);
+		ni_xs_cache_get_vars(r, &service->attributes);
+		ni_xs_cache_get_methods(r, &service->methods);
+		ni_xs_cache_get_methods(r, &service->signals);
+	}
+
+	if ((index = ni_xs_cache_get_uint(r)) != 0 && scope->parent) {
+		for (service = scope->parent->services; service && --index; service = service->next)
+			;
+		scope->defined_by.service = service;
+	}
+
+	count = ni_xs_cache_get_count(r, 24);
+	for (i = 0; i < count && !r->error; ++i)
+		ni_xs_cache_get_scope(r, ni_xs_scope_new(scope, ni_xs_cache_get_string(r)));
+}
+
+static ni_bool_t
+ni_xs_cache_check_files(ni_xs_cache_reader_t *r, const char *filename)
+{
+	const char *path;
+	unsigned int i, count;
+	struct stat stb;
+
+	if (!ni_string_eq(ni_xs_cache_get_string(r), PACKAGE_VERSION)
+	 || !ni_string_eq(ni_xs_cache_get_string(r), filename))
+		return FALSE;
+
+	count = ni_xs_cache_get_count(r, 36);
+	for (i = 0; i < count && !r->error; ++i) {
+		if (!(path = ni_xs_cache_get_string(r)) || stat(path, &stb) < 0)
+			return FALSE;
+		if (ni_xs_cache_get_ulong(r) != (uint64_t) stb.st_ino
+		 || ni_xs_cache_get_ulong(r) != (uint64_t) stb.st_size
+		 || ni_xs_cache_get_ulong(r) != (uint64_t) stb.st_mtim.tv_sec
+		 || ni_xs_cache_get_ulong(r) != (uint64_t) stb.st_mtim.tv_nsec) {
+			ni_debug_xml("schema cache is outdated: %s changed", path);
+			return FALSE;
+		}
+	}
+	return count && !r->error;
+}
+
+static ni_bool_t
+ni_xs_cache_check_builtins(ni_xs_cache_reader_t *r)
+{
+	unsigned int i;
+
+	r->nbuiltin = ni_xs_cache_get_uint(r);
+	if (r->nbuiltin > r->root->types.count)
+		return FALSE;
+
+	for (i = 0; i < r->nbuiltin; ++i) {
+		if (!ni_string_eq(ni_xs_cache_get_string(r), r->root->types.data[i].name))
+			return FALSE;
+	}
+	return !r->error;
+}
+
+static void
+ni_xs_cache_decode(ni_xs_cache_reader_t *r)
+{
+	ni_xs_type_t *type;
+	ni_intmap_t *bits;
+	unsigned int i, j, count;
+	uint32_t id, index;
+
+	r->ngroups = ni_xs_cache_get_count(r, 8);
+	r->groups = xcalloc(r->ngroups + 1, sizeof(r->groups[0]));
+	for (i = 0; i < r->ngroups && !r->error; ++i) {
+		r->groups[i] = xcalloc(1, sizeof(ni_xs_group_t));
+		r->groups[i]->refcount = 1;
+		r->groups[i]->relation = ni_xs_cache_get_uint(r);
+		r->groups[i]->name = ni_xs_cache_dup_string(r);
+	}
+
+	r->nmaps = ni_xs_cache_get_count(r, 4);
+	r->maps = xcalloc(r->nmaps + 1, sizeof(r->maps[0]));
+	for (i = 0; i < r->nmaps && !r->error; ++i) {
+		count = ni_xs_cache_get_count(r, 8);
+		bits = xcalloc(count + 1, sizeof(ni_intmap_t));
+		for (j = 0; j < count && !r->error; ++j) {
+			bits[j].name = ni_xs_cache_dup_string(r);
+			bits[j].value = ni_xs_cache_get_uint(r);
+		}
+		r->maps[i] = xcalloc(1, sizeof(ni_xs_intmap_t));
+		r->maps[i]->refcount = 1;
+		r->maps[i]->bits = bits;
+	}
+
+	r->nranges = ni_xs_cache_get_count(r, 16);
+	r->ranges = xcalloc(r->nranges + 1, sizeof(r->ranges[0]));
+	for (i = 0; i < r->nranges && !r->error; ++i) {
+		r->ranges[i] = xcalloc(1, sizeof(ni_xs_range_t));
+		r->ranges[i]->refcount = 1;
+		r->ranges[i]->min = ni_xs_cache_get_ulong(r);
+		r->ranges[i]->max = ni_xs_cache_get_ulong(r);
+	}
+
+	r->ntypes = ni_xs_cache_get_uint(r);
+	if (r->error || r->ntypes < r->nbuiltin
+	 || r->ntypes - r->nbuiltin > ni_buffer_count(&r->buf) / 4) {
+		r->error = TRUE;
+		return;
+	}
+	r->types = xcalloc(r->ntypes + 1, sizeof(r->types[0]));
+	for (i = 0; i < r->nbuiltin; ++i)
+		r->types[i] = ni_xs_type_hold(r->root->types.data[i].type);
+	for (; i < r->ntypes; ++i) {
+		if (!(r->types[i] = ni_xs_cache_new_type(ni_xs_cache_get_uint(r)))) {
+			r->error = TRUE;
+			return;
+		}
+	}
+	for (i = r->nbuiltin; i < r->ntypes && !r->error; ++i)
+		ni_xs_cache_get_type(r, r->types[i]);
+
+	if (r->error)
+		return;
+	ni_xs_cache_get_string(r);	/* the root scope keeps its name */
+	ni_xs_cache_get_scope(r, r->root);
+
+	for (i = r->nbuiltin; i < r->ntypes && !r->error; ++i) {
+		type = r->types[i];
+		id = ni_xs_cache_get_uint(r);
+		index = ni_xs_cache_get_uint(r);
+		if (id == 0)
+			continue;
+		if (id > r->nscopes || index >= r->scopes[id - 1]->types.count) {
+			r->error = TRUE;
+			break;
+		}
+		type->origdef.scope = r->scopes[id - 1];
+		type->origdef.name = r->scopes[id - 1]->types.data[index].name;
+	}
+}
+
+/*
+ * Drop the references held by the reader's object tables; all objects
+ * not used by the scope tree are freed.
+ */
+static void
+ni_xs_cache_reader_destroy(ni_xs_cache_reader_t *r)
+{
+	unsigned int i;
+
+	for (i = 0; i < r->ntypes; ++i)
+		ni_xs_type_release(r->types[i]);
+	for (i = 0; i < r->ngroups; ++i) {
+		if (r->groups[i] && --(r->groups[i]->refcount) == 0) {
+			ni_string_free(&r->groups[i]->name);
+			free(r->groups[i]);
+		}
+	}
+	for (i = 0; i < r->nmaps; ++i) {
+		if (r->maps[i] && --(r->maps[i]->refcount) == 0) {
+			ni_intmap_t *bits;
+
+			for (bits = r->maps[i]->bits; bits->name; ++bits)
+				free((char *) bits->name);
+			free(r->maps[i]->bits);
+			free(r->maps[i]);
+		}
+	}
+	for (i = 0; i < r->nranges; ++i) {
+		if (r->ranges[i] && --(r->ranges[i]->refcount) == 0)
+			free(r->ranges[i]);
+	}
+	free(r->types);
+	free(r->groups);
+	free(r->maps);
+	free(r->ranges);
+	free(r->scopes);
+	memset(r, 0, sizeof(*r));
+}
+
+/*
+ * Load the schema cache image into @scope, which has to be freshly
+ * initialized with the builtin types only.
+ * Returns 0 on success; when the cache is missing or outdated, -1 is
+ * returned and the scope is unchanged. When the image turns out to be
+ * corrupt while decoding, -2 is returned and the scope must be discarded.
+ */
+int
+ni_xs_cache_load(const char *cachefile, const char *filename, ni_xs_scope_t *scope)
+{
+	const ni_xs_cache_header_t *hdr;
+	unsigned char digest[NI_XS_CACHE_DIGEST_LEN];
+	ni_xs_cache_reader_t r;
+	struct stat stb;
+	void *map;
+	int fd, rv = -1;
+
+	if ((fd = open(cachefile, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+
+	if (fstat(fd, &stb) < 0 || !S_ISREG(stb.st_mode)
+	 || (size_t) stb.st_size < sizeof(*hdr)) {
+		close(fd);
+		return -1;
+	}
+
+	map = mmap(NULL, stb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -1;
+
+	hdr = map;
+	if (hdr->magic != NI_XS_CACHE_MAGIC || hdr->version != NI_XS_CACHE_VERSION
+	 || hdr->length != stb.st_size - sizeof(*hdr)) {
+		ni_debug_xml("ignoring schema cache %s: bad header", cachefile);
+		goto out;
+	}
+
+	if (!ni_xs_cache_digest(hdr + 1, hdr->length, digest)
+	 || memcmp(digest, hdr->digest, sizeof(digest))) {
+		ni_debug_xml("ignoring schema cache %s: checksum mismatch", cachefile);
+		goto out;
+	}
+
+	memset(&r, 0, sizeof(r));
+	ni_buffer_init_reader(&r.buf, (void *) (hdr + 1), hdr->length);
+	r.root = scope;
+	if (!ni_xs_cache_check_files(&r, filename) || !ni_xs_cache_check_builtins(&r))
+		goto out;
+
+	ni_xs_cache_decode(&r);
+	if (r.error || ni_buffer_count(&r.buf) != 0) {
+		ni_error("unable to decode schema cache %s", cachefile);
+		rv = -2;
+	} else {
+		ni_debug_xml("loaded schema cache %s (%u types)",
+				cachefile, r.ntypes - r.nbuiltin);
+		rv = 0;
+	}
+	ni_xs_cache_reader_destroy(&r);
+
+out:
+	munmap(map, stb.st_size);
+	return rv;
+}
@@ -609,6 +609,8 @@ ni_xs_is_reserved_name(const char *name)
 /*
  * Parse an XML schema file and process it
  */
+static ni_string_array_t *	ni_xs_schema_files;
+
 int
 ni_xs_process_schema_file(const char *filename, ni_xs_scope_t *scope)
 {
@@ -622,6 +624,9 @@ ni_xs_process_schema_file(const char *filename, ni_xs_scope_t *scope)
 		return -1;
 	}
 
+	if (ni_xs_schema_files)
+		ni_string_array_append(ni_xs_schema_files, filename);
+
 	doc = xml_document_read(filename);
 	if (doc == NULL) {
 		ni_error("cannot parse schema file \"%s\"", filename);
@@ -638,6 +643,21 @@ ni_xs_process_schema_file(const char *filename, ni_xs_scope_t *scope)
 	return 0;
 }
 
+/*
+ * Same as above, but record the names of the file and of all files
+ * it includes in @files.
+ */
+int
+ni_xs_process_schema_file_tracked(const char *filename, ni_xs_scope_t *scope, ni_string_array_t *files)
+{
+	int rv;
+
+	ni_xs_schema_files = files;
+	rv = ni_xs_process_schema_file(filename, scope);
+	ni_xs_schema_files = NULL;
+	return rv;
+}
+
 /*
  * Process a schema.
  * For now, this is nothing but a sequence of <define> elements
@@ -792,14 +812,12 @@ ni_xs_process_method(xml_node_t *node, ni_xs_service_t *service, ni_xs_scope_t *
 			ni_string_dup(&method->description, child->cdata);
 		} else
 		if (ni_string_eq(child->name, "meta")) {
-			xml_node_detach(child);
-			method->meta = child;
+			method->meta = xml_node_clone(child, NULL);
 		} else
 		if (!strncmp(child->name, "meta:", 5)) {
 			if (method->meta == NULL)
 				method->meta = xml_node_new("meta", NULL);
-			xml_node_reparent(method->meta, child);
-			ni_string_dup(&child->name, child->name + 5);
+			xml_node_set_name(xml_node_clone(child, method->meta), child->name + 5);
 		}
 	}
 
@@ -1278,8 +1296,9 @@ ni_xs_build_simple_type(xml_node_t *node, const char *typeName, ni_xs_scope_t *s
 	}
 
 	/* If we find any <meta> type inside a scalar type definition,
-	 * detach it from the schema xml tree and store it in the scalar
-	 * type node for later use.
+	 * copy it from the schema xml tree and store it in the scalar
+	 * type node for later use. It is copied rather than detached,
+	 * so it does not keep the arena of the schema document alive.
 	 * <meta:foobar> is a shorthand for <foobar> nested inside <meta>.
 	 */
 	meta = NULL;
@@ -1289,15 +1308,13 @@ ni_xs_build_simple_type(xml_node_t *node, const char *typeName, ni_xs_scope_t *s
 			if (meta) {
 				ni_error("%s: duplicate <meta> elements", xml_node_location(node));
 			} else {
-				xml_node_detach(child);
-				meta = child;
+				meta = xml_node_clone(child, NULL);
 			}
 		} else
 		if (!strncasecmp(child->name, "meta:", 5)) {
 			if (meta == NULL)
 				meta = xml_node_new("meta", NULL);
-			xml_node_reparent(meta, child);
-			ni_string_dup(&child->name, child->name + 5);
+			xml_node_set_name(xml_node_clone(child, meta), child->name + 5);
 		}
 	}
 	if (meta) {
@@ -1836,8 +1853,11 @@ static unsigned int		num_array_notations;
 void
 ni_xs_register_array_notation(const ni_xs_notation_t *notation)
 {
-	ni_assert(num_array_notations < NI_XS_NOTATIONS_MAX);
 	ni_assert(notation->name != NULL);
+	if (ni_xs_get_array_notation(notation->name) == notation)
+		return;
+
+	ni_assert(num_array_notations < NI_XS_NOTATIONS_MAX);
 	array_notations[num_array_notations++] = notation;
 }
 
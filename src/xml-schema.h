@@ -351,9 +351,19 @@ extern ni_xs_type_t *	ni_xs_scope_lookup(const ni_xs_scope_t *, const char *);
 extern ni_xs_type_t *	ni_xs_scope_lookup_local(const ni_xs_scope_t *, const char *);
 
 extern int		ni_xs_process_schema_file(const char *, ni_xs_scope_t *);
+extern int		ni_xs_process_schema_file_tracked(const char *, ni_xs_scope_t *,
+				ni_string_array_t *);
 extern int		ni_xs_process_schema(xml_node_t *, ni_xs_scope_t *);
 
+extern int		ni_xs_cache_load(const char *, const char *, ni_xs_scope_t *);
+extern int		ni_xs_cache_save(const char *, const char *, const ni_string_array_t *,
+				const ni_xs_scope_t *, unsigned int);
+
 extern ni_xs_type_t *	ni_xs_scalar_new(const char *, unsigned int);
+extern ni_xs_type_t *	ni_xs_struct_new(ni_xs_name_type_array_t *);
+extern ni_xs_type_t *	ni_xs_union_new(ni_xs_name_type_array_t *, const char *);
+extern ni_xs_type_t *	ni_xs_dict_new(ni_xs_name_type_array_t *);
+extern ni_xs_type_t *	ni_xs_array_new(ni_xs_type_t *, const char *, unsigned long, unsigned long);
 extern int		ni_xs_scope_typedef(ni_xs_scope_t *, const char *, ni_xs_type_t *, const char *);
 extern void		ni_xs_type_free(ni_xs_type_t *type);
 
@@ -31,6 +31,199 @@
 #define XML_DOCUMENTARRAY_CHUNK		1
 #define XML_NODEARRAY_CHUNK		8
 
+#define XML_ARENA_CHUNK_SIZE		(16 * 1024)
+#define XML_ARENA_ALIGN			sizeof(uint64_t)
+#define XML_ARENA_NAMES_INIT		64
+#define XML_ARENA_ATTRS_CHUNK		4
+
+/*
+ * Arena allocation of xml trees.
+ *
+ * Nodes, element and attribute names, attribute values and cdata of
+ * documents we parse are carved out of a few large chunks instead of
+ * being allocated one by one. Names are interned per arena, as most
+ * documents use a small set of element and attribute names over and
+ * over again.
+ *
+ * Nodes are still refcounted and may be detached, reparented or kept
+ * after the document has been freed, so the arena itself is refcounted
+ * by the nodes allocated from it and all of its memory is released in
+ * one go when the last of them is freed.
+ *
+ * An arena is open while the tree is being built; new children of its
+ * nodes are then allocated from it as well. Once it has been sealed,
+ * later modifications of the tree use the heap, so that long-lived
+ * trees which are modified over and over do not make the arena grow.
+ */
+typedef struct xml_arena_chunk	xml_arena_chunk_t;
+struct xml_arena_chunk {
+	xml_arena_chunk_t *	next;
+};
+
+struct xml_arena {
+	unsigned int		refcount;
+	ni_bool_t		open;
+
+	xml_arena_chunk_t *	chunks;
+	char *			pos;
+	size_t			avail;
+
+	unsigned int		names_count;
+	unsigned int		names_size;
+	const char **		names;
+};
+
+static xml_arena_t *
+xml_arena_new(void)
+{
+	xml_arena_t *arena;
+
+	arena = xcalloc(1, sizeof(*arena));
+	arena->open = TRUE;
+	return arena;
+}
+
+static void
+xml_arena_free(xml_arena_t *arena)
+{
+	xml_arena_chunk_t *chunk;
+
+	while ((chunk = arena->chunks) != NULL) {
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+	free(arena->names);
+	free(arena);
+}
+
+static inline void
+xml_arena_release(xml_arena_t *arena)
+{
+	ni_assert(arena->refcount);
+	if (--(arena->refcount) == 0)
+		xml_arena_free(arena);
+}
+
+static void *
+xml_arena_alloc(xml_arena_t *arena, size_t size)
+{
+	const size_t hdrlen = (sizeof(xml_arena_chunk_t) + XML_ARENA_ALIGN - 1) & ~(XML_ARENA_ALIGN - 1);
+	xml_arena_chunk_t *chunk;
+	void *ptr;
+
+	size = (size + XML_ARENA_ALIGN - 1) & ~(XML_ARENA_ALIGN - 1);
+	if (size <= arena->avail) {
+		ptr = arena->pos;
+		arena->pos += size;
+		arena->avail -= size;
+		return ptr;
+	}
+
+	if (size > XML_ARENA_CHUNK_SIZE / 4) {
+		/* Large strings get a chunk of their own, behind the
+		 * current one, so we do not waste what is left in it */
+		chunk = xmalloc(hdrlen + size);
+		if (arena->chunks) {
+			chunk->next = arena->chunks->next;
+			arena->chunks->next = chunk;
+		} else {
+			chunk->next = NULL;
+			arena->chunks = chunk;
+		}
+		return (char *) chunk + hdrlen;
+	}
+
+	chunk = xmalloc(hdrlen + XML_ARENA_CHUNK_SIZE);
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+
+	ptr = (char *) chunk + hdrlen;
+	arena->pos = (char *) ptr + size;
+	arena->avail = XML_ARENA_CHUNK_SIZE - size;
+	return ptr;
+}
+
+static char *
+xml_arena_strdup(xml_arena_t *arena, const char *string)
+{
+	size_t len;
+	char *copy;
+
+	if (string == NULL)
+		return NULL;
+
+	len = strlen(string) + 1;
+	copy = xml_arena_alloc(arena, len);
+	memcpy(copy, string, len);
+	return copy;
+}
+
+static inline unsigned int
+xml_arena_name_hash(const char *name)
+{
+	unsigned int hash = 2166136261U;
+
+	while (*name)
+		hash = (hash ^ (unsigned char) *name++) * 16777619U;
+	return hash;
+}
+
+static void
+xml_arena_names_grow(xml_arena_t *arena)
+{
+	unsigned int size, i, slot;
+	const char **names;
+
+	size = arena->names_size ? arena->names_size * 2 : XML_ARENA_NAMES_INIT;
+	names = xcalloc(size, sizeof(names[0]));
+
+	for (i = 0; i < arena->names_size; ++i) {
+		const char *name = arena->names[i];
+
+		if (name == NULL)
+			continue;
+		slot = xml_arena_name_hash(name) & (size - 1);
+		while (names[slot])
+			slot = (slot + 1) & (size - 1);
+		names[slot] = name;
+	}
+
+	free(arena->names);
+	arena->names = names;
+	arena->names_size = size;
+}
+
+static const char *
+xml_arena_intern(xml_arena_t *arena, const char *name)
+{
+	unsigned int slot;
+	const char *entry;
+
+	if (name == NULL)
+		return NULL;
+
+	if (2 * (arena->names_count + 1) > arena->names_size)
+		xml_arena_names_grow(arena);
+
+	slot = xml_arena_name_hash(name) & (arena->names_size - 1);
+	while ((entry = arena->names[slot]) != NULL) {
+		if (!strcmp(entry, name))
+			return entry;
+		slot = (slot + 1) & (arena->names_size - 1);
+	}
+
+	entry = xml_arena_strdup(arena, name);
+	arena->names[slot] = entry;
+	arena->names_count++;
+	return entry;
+}
+
+static inline xml_arena_t *
+xml_node_open_arena(const xml_node_t *node)
+{
+	return node && node->arena && node->arena->open ? node->arena : NULL;
+}
+
 xml_document_t *
 xml_document_new()
 {
@@ -41,6 +234,20 @@ xml_document_new()
 	return doc;
 }
 
+/*
+ * Create a document with a tree allocated from an arena.
+ * Call xml_node_arena_seal on the root when done building it.
+ */
+xml_document_t *
+xml_document_new_arena(void)
+{
+	xml_document_t *doc;
+
+	doc = xcalloc(1, sizeof(*doc));
+	doc->root = xml_node_new_arena(NULL);
+	return doc;
+}
+
 xml_node_t *
 xml_document_root(xml_document_t *doc)
 {
@@ -139,11 +346,37 @@ xml_node_add_child(xml_node_t *parent, xml_node_t *child)
 	__xml_node_list_insert(tail, child, parent);
 }
 
+static xml_node_t *
+__xml_arena_node_new(xml_arena_t *arena, const char *ident, xml_node_t *parent)
+{
+	xml_node_t *node;
+
+	node = xml_arena_alloc(arena, sizeof(xml_node_t));
+	memset(node, 0, sizeof(*node));
+	node->arena = arena;
+	arena->refcount++;
+
+	if (ident) {
+		node->name = (char *) xml_arena_intern(arena, ident);
+		node->shared_name = 1;
+	}
+
+	if (parent)
+		xml_node_add_child(parent, node);
+	node->refcount = 1;
+
+	return node;
+}
+
 xml_node_t *
 xml_node_new(const char *ident, xml_node_t *parent)
 {
+	xml_arena_t *arena;
 	xml_node_t *node;
 
+	if ((arena = xml_node_open_arena(parent)) != NULL)
+		return __xml_arena_node_new(arena, ident, parent);
+
 	node = xcalloc(1, sizeof(xml_node_t));
 	if (ident)
 		node->name = xstrdup(ident);
@@ -155,6 +388,31 @@ xml_node_new(const char *ident, xml_node_t *parent)
 	return node;
 }
 
+/*
+ * Create a (root) node using a new arena. All nodes added below
+ * it are allocated from the same arena until it is sealed.
+ */
+xml_node_t *
+xml_node_new_arena(const char *ident)
+{
+	return __xml_arena_node_new(xml_arena_new(), ident, NULL);
+}
+
+void
+xml_node_arena_seal(xml_node_t *node)
+{
+	xml_arena_t *arena;
+
+	if (!node || !(arena = node->arena))
+		return;
+
+	/* no more names will be interned */
+	arena->open = FALSE;
+	free(arena->names);
+	arena->names = NULL;
+	arena->names_count = arena->names_size = 0;
+}
+
 xml_node_t *
 xml_node_new_element(const char *ident, xml_node_t *parent, const char *cdata)
 {
@@ -227,7 +485,7 @@ xml_node_clone(const xml_node_t *src, xml_node_t *parent)
 		return NULL;
 
 	dst = xml_node_new(src->name, parent);
-	ni_string_dup(&dst->cdata, src->cdata);
+	xml_node_set_cdata(dst, src->cdata);
 
 	for (i = 0, attr = src->attrs.data; i < src->attrs.count; ++i, ++attr)
 		xml_node_add_attr(dst, attr->name, attr->value);
@@ -302,16 +560,55 @@ xml_node_free(xml_node_t *node)
 	if (node->location)
 		xml_location_free(node->location);
 
-	ni_var_array_destroy(&node->attrs);
-	free(node->cdata);
-	free(node->name);
-	free(node);
+	if (!node->shared_attrs)
+		ni_var_array_destroy(&node->attrs);
+	if (!node->shared_cdata)
+		free(node->cdata);
+	if (!node->shared_name)
+		free(node->name);
+
+	if (node->arena)
+		xml_arena_release(node->arena);
+	else
+		free(node);
+}
+
+void
+xml_node_set_name(xml_node_t *node, const char *name)
+{
+	xml_arena_t *arena;
+	char *old = node->name;
+
+	if ((arena = xml_node_open_arena(node)) != NULL) {
+		node->name = (char *) xml_arena_intern(arena, name);
+		if (!node->shared_name)
+			free(old);
+		node->shared_name = 1;
+	} else if (node->shared_name) {
+		node->name = xstrdup(name);
+		node->shared_name = 0;
+	} else {
+		ni_string_dup(&node->name, name);
+	}
 }
 
 void
 xml_node_set_cdata(xml_node_t *node, const char *cdata)
 {
-	ni_string_dup(&node->cdata, cdata);
+	xml_arena_t *arena;
+	char *old = node->cdata;
+
+	if ((arena = xml_node_open_arena(node)) != NULL) {
+		node->cdata = xml_arena_strdup(arena, cdata);
+		if (!node->shared_cdata)
+			free(old);
+		node->shared_cdata = 1;
+	} else if (node->shared_cdata) {
+		node->cdata = xstrdup(cdata);
+		node->shared_cdata = 0;
+	} else {
+		ni_string_dup(&node->cdata, cdata);
+	}
 }
 
 void
@@ -320,7 +617,7 @@ xml_node_set_int(xml_node_t *node, int value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%d", value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -329,7 +626,7 @@ xml_node_set_int64(xml_node_t *node, int64_t value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%"PRId64, value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -338,7 +635,7 @@ xml_node_set_uint(xml_node_t *node, unsigned int value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%u", value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -347,7 +644,7 @@ xml_node_set_uint64(xml_node_t *node, uint64_t value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%"PRIu64, value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -356,31 +653,88 @@ xml_node_set_uint_hex(xml_node_t *node, unsigned int value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "0x%x", value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
+}
+
+/*
+ * The attribute array of an arena node is either owned by the arena
+ * together with all its strings, or allocated on the heap. Once the
+ * arena has been sealed, it is copied to the heap before modification.
+ */
+static void
+xml_node_attrs_unshare(xml_node_t *node)
+{
+	ni_var_array_t attrs = NI_VAR_ARRAY_INIT;
+	unsigned int i;
+	ni_var_t *attr;
+
+	if (!node->shared_attrs)
+		return;
+
+	for (i = 0, attr = node->attrs.data; i < node->attrs.count; ++i, ++attr)
+		ni_var_array_append(&attrs, attr->name, attr->value);
+
+	node->attrs.count = attrs.count;
+	node->attrs.data = attrs.data;
+	node->shared_attrs = 0;
 }
 
 void
 xml_node_add_attr(xml_node_t *node, const char *name, const char *value)
 {
+	xml_arena_t *arena;
+	ni_var_t *attr;
+
+	if ((arena = xml_node_open_arena(node)) != NULL
+	 && (node->shared_attrs || node->attrs.data == NULL)) {
+		if ((attr = ni_var_array_get(&node->attrs, name)) == NULL) {
+			unsigned int count = node->attrs.count;
+
+			if ((count % XML_ARENA_ATTRS_CHUNK) == 0) {
+				ni_var_t *data;
+
+				data = xml_arena_alloc(arena, (count + XML_ARENA_ATTRS_CHUNK) * sizeof(*data));
+				if (count)
+					memcpy(data, node->attrs.data, count * sizeof(*data));
+				node->attrs.data = data;
+			}
+			attr = &node->attrs.data[node->attrs.count++];
+			attr->name = (char *) xml_arena_intern(arena, name);
+		}
+		attr->value = xml_arena_strdup(arena, value);
+		node->shared_attrs = 1;
+		return;
+	}
+
+	xml_node_attrs_unshare(node);
 	ni_var_array_set(&node->attrs, name, value);
 }
 
 void
 xml_node_add_attr_uint(xml_node_t *node, const char *name, unsigned int value)
 {
-	ni_var_array_set_uint(&node->attrs, name, value);
+	char buffer[32];
+
+	snprintf(buffer, sizeof(buffer), "%u", value);
+	xml_node_add_attr(node, name, buffer);
 }
 
 void
 xml_node_add_attr_ulong(xml_node_t *node, const char *name, unsigned long value)
 {
-	ni_var_array_set_ulong(&node->attrs, name, value);
+	char buffer[32];
+
+	snprintf(buffer, sizeof(buffer), "%lu", value);
+	xml_node_add_attr(node, name, buffer);
 }
 
 void
 xml_node_add_attr_double(xml_node_t *node, const char *name, double value)
 {
-	ni_var_array_set_double(&node->attrs, name, value);
+	char buffer[32];
+
+	snprintf(buffer, sizeof(buffer), "%g", value);
+	xml_node_add_attr(node, name, buffer);
 }
 
 const ni_var_t *
@@ -408,7 +762,11 @@ xml_node_get_attr(const xml_node_t *node, const char *name)
 ni_bool_t
 xml_node_del_attr(xml_node_t *node, const char *name)
 {
-	return node ? ni_var_array_remove(&node->attrs, name) : FALSE;
+	if (!node || !ni_var_array_get(&node->attrs, name))
+		return FALSE;
+
+	xml_node_attrs_unshare(node);
+	return ni_var_array_remove(&node->attrs, name);
 }
 
 ni_bool_t
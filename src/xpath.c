@@ -74,6 +74,8 @@ static xpath_operator_t	__xpath_operator_getattr;
 static xpath_operator_t	__xpath_operator_predicate;
 static xpath_operator_t	__xpath_operator_stringconst;
 static xpath_operator_t	__xpath_operator_intconst;
+static xpath_operator_t	__xpath_operator_true;
+static xpath_operator_t	__xpath_operator_false;
 static xpath_operator_t *xpath_get_axis_ops(const char *);
 static xpath_operator_t *xpath_get_comparison_ops(const char **);
 static xpath_operator_t *xpath_get_infix_ops(const char *);
@@ -83,6 +85,7 @@ static xpath_result_t *	__xpath_expression_eval(const xpath_enode_t *, xpath_res
 static xpath_result_t *	__xpath_build_boolean(int);
 
 static xpath_enode_t *	__xpath_build_expr(const char **, char, int infixprio);
+static xpath_enode_t *	__xpath_expression_fold(xpath_enode_t *);
 static int		__xpath_enode_assert_element(xpath_enode_t **);
 static const char *	__xpath_next_identifier(const char **);
 static void		__xpath_skipws(const char **);
@@ -122,7 +125,7 @@ xpath_expression_parse(const char *expr)
 	if (*expr)
 		goto failed;
 
-	return tree;
+	return __xpath_expression_fold(tree);
 
 failed:
 	ni_error("unable to parse XPATH expression \"%s\"", orig_expr);
@@ -131,6 +134,95 @@ failed:
 	return NULL;
 }
 
+/*
+ * Cache of compiled XPATH expressions.
+ * The schema metadata uses a small set of expressions over and over
+ * again, e.g. for every interface brought up. The entries are kept
+ * in most recently used order, and the least recently used one is
+ * dropped when the cache is full.
+ */
+#define XPATH_EXPRESSION_CACHE_MAX	64
+
+typedef struct xpath_expression_cache_entry {
+	unsigned int		hash;
+	char *			expr;
+	xpath_enode_t *		tree;
+} xpath_expression_cache_entry_t;
+
+static struct xpath_expression_cache {
+	unsigned int		count;
+	xpath_expression_cache_entry_t entry[XPATH_EXPRESSION_CACHE_MAX];
+} xpath_expression_cache;
+
+static unsigned int
+xpath_expression_hash(const char *expr)
+{
+	unsigned int hash = 2166136261U;
+
+	while (*expr)
+		hash = (hash ^ (unsigned char) *expr++) * 16777619U;
+	return hash;
+}
+
+/*
+ * Look up a compiled XPATH expression, parsing it on a cache miss.
+ * The tree is owned by the cache; it must not be freed by the caller,
+ * nor be used after further lookups, which may evict it.
+ */
+const xpath_enode_t *
+xpath_expression_lookup(const char *expr)
+{
+	struct xpath_expression_cache *cache = &xpath_expression_cache;
+	xpath_expression_cache_entry_t found;
+	unsigned int i, hash;
+
+	if (!expr)
+		return NULL;
+
+	hash = xpath_expression_hash(expr);
+	for (i = 0; i < cache->count; ++i) {
+		xpath_expression_cache_entry_t *entry = &cache->entry[i];
+
+		if (entry->hash == hash && !strcmp(entry->expr, expr))
+			break;
+	}
+
+	if (i < cache->count) {
+		found = cache->entry[i];
+	} else {
+		if (!(found.tree = xpath_expression_parse(expr)))
+			return NULL;
+		found.expr = xstrdup(expr);
+		found.hash = hash;
+
+		if (cache->count < XPATH_EXPRESSION_CACHE_MAX) {
+			i = cache->count++;
+		} else {
+			i = cache->count - 1;
+			free(cache->entry[i].expr);
+			xpath_expression_free(cache->entry[i].tree);
+		}
+	}
+
+	/* move the entry to the front */
+	memmove(&cache->entry[1], &cache->entry[0], i * sizeof(cache->entry[0]));
+	cache->entry[0] = found;
+	return found.tree;
+}
+
+void
+xpath_expression_cache_flush(void)
+{
+	struct xpath_expression_cache *cache = &xpath_expression_cache;
+	unsigned int i;
+
+	for (i = 0; i < cache->count; ++i) {
+		free(cache->entry[i].expr);
+		xpath_expression_free(cache->entry[i].tree);
+	}
+	memset(cache, 0, sizeof(*cache));
+}
+
 /*
  * Evaluate a parsed XPATH expression
  */
@@ -174,16 +266,15 @@ xpath_expression_free(xpath_enode_t *enode)
 char *
 xml_xpath_eval_string(xml_document_t *doc, xml_node_t *xn, const char *expr)
 {
+	const xpath_enode_t *expr_tree;
 	xpath_result_t *xresult;
-	xpath_enode_t *expr_tree;
 	char *result = NULL;
 
-	expr_tree = xpath_expression_parse(expr);
+	expr_tree = xpath_expression_lookup(expr);
 	if (!expr_tree)
 		return NULL;
 
 	xresult = xpath_expression_eval(expr_tree, xn);
-	xpath_expression_free(expr_tree);
 
 	if (!xresult)
 		return NULL;
@@ -860,6 +951,79 @@ __xpath_expression_constant(const xpath_enode_t *enode)
 	return constant;
 }
 
+/*
+ * Check if an expression is pure, i.e. does not depend on its input at
+ * all. Note that "constant" expressions may still depend on the input
+ * node set, like last().
+ */
+static int
+__xpath_expression_pure(const xpath_enode_t *enode)
+{
+	if (enode->left == NULL)
+		return enode->ops->constant && enode->ops->intype == XPATH_VOID;
+
+	if (!__xpath_expression_pure(enode->left))
+		return 0;
+	return enode->right == NULL || __xpath_expression_pure(enode->right);
+}
+
+/*
+ * Constant folding: replace pure sub-expressions by their value,
+ * e.g. "(2+4) div 3" by the integer constant 2.
+ */
+static xpath_enode_t *
+__xpath_expression_fold(xpath_enode_t *enode)
+{
+	xpath_result_t *in, *result;
+	xpath_enode_t *folded = NULL;
+
+	if (enode == NULL)
+		return NULL;
+
+	enode->left = __xpath_expression_fold(enode->left);
+	enode->right = __xpath_expression_fold(enode->right);
+	if (enode->left == NULL || !__xpath_expression_pure(enode))
+		return enode;
+
+	in = xpath_result_new(XPATH_VOID);
+	result = __xpath_expression_eval(enode, in);
+	xpath_result_free(in);
+	if (result == NULL)
+		return enode;
+
+	switch (result->type) {
+	case XPATH_STRING:
+		if (result->count == 1) {
+			folded = xpath_enode_new(&__xpath_operator_stringconst);
+			folded->identifier = xstrdup(result->node[0].value.string);
+		}
+		break;
+
+	case XPATH_INTEGER:
+		if (result->count == 1) {
+			folded = xpath_enode_new(&__xpath_operator_intconst);
+			folded->integer = result->node[0].value.integer;
+		}
+		break;
+
+	case XPATH_BOOLEAN:
+		folded = xpath_enode_new(__xpath_test_boolean(result) ?
+				&__xpath_operator_true : &__xpath_operator_false);
+		break;
+
+	default:
+		break;
+	}
+	xpath_result_free(result);
+
+	if (folded == NULL)
+		return enode;
+
+	xtrace("folded constant expression %s", enode->ops->name);
+	xpath_expression_free(enode);
+	return folded;
+}
+
 /*
  * node()
  */
@@ -0,0 +1,249 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+#include <wicked/netinfo.h>
+#include <wicked/dbus.h>
+#include <wicked/dbus-service.h>
+#include <wicked/dbus-errors.h>
+
+#include "netinfo_priv.h"
+#include "dbus-common.h"
+#include "dbus-server.h"
+
+/*
+ * GetManagedObjectsSince check: a method call on one object refreshing
+ * another device (as e.g. a link change does with its master) has to
+ * make the refreshed object visible to the next incremental query,
+ * while objects not touched stay out of the reply.
+ *
+ * Uses the loopback device and needs a session bus, run it using:
+ *	dbus-run-session -- ./dbus-since-test
+ */
+#define TEST_BUS_NAME		"org.opensuse.Network.SinceTest"
+#define TEST_ROOT_PATH		"/org/opensuse/Network/SinceTest"
+#define TEST_DEVICE_INTERFACE	TEST_BUS_NAME ".Device"
+
+static ni_dbus_server_t *	test_server;
+static ni_netdev_t *		test_peer;
+
+static const ni_dbus_class_t	test_device_class = {
+	.name		= "since-test-device",
+};
+
+static dbus_bool_t
+test_device_get_name(const ni_dbus_object_t *object, const ni_dbus_property_t *property,
+			ni_dbus_variant_t *result, DBusError *error)
+{
+	ni_netdev_t *dev = object->handle;
+
+	ni_dbus_variant_set_string(result, dev->name);
+	return TRUE;
+}
+
+static dbus_bool_t
+test_device_refresh_peer(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+
+	if (!nc || __ni_system_refresh_interface(nc, test_peer) < 0) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "unable to refresh %s",
+				test_peer->name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static const ni_dbus_property_t	test_device_properties[] = {
+	{ .name = "name", .signature = DBUS_TYPE_STRING_AS_STRING,
+	  .get = test_device_get_name },
+	{ NULL }
+};
+
+static const ni_dbus_method_t	test_device_methods[] = {
+	{ "refreshPeer",	"",	.handler = test_device_refresh_peer },
+	{ NULL }
+};
+
+static const ni_dbus_service_t	test_device_service = {
+	.name		= TEST_DEVICE_INTERFACE,
+	.compatible	= &test_device_class,
+	.methods	= test_device_methods,
+	.properties	= test_device_properties,
+};
+
+static void
+test_device_modified(ni_netdev_t *dev)
+{
+	ni_dbus_server_object_modified(ni_dbus_server_find_object_by_handle(test_server, dev));
+}
+
+static void
+test_device_register(const char *path, ni_netdev_t *dev)
+{
+	ni_dbus_object_t *object;
+
+	object = ni_dbus_server_register_object(test_server, path, &test_device_class, dev);
+	if (!object)
+		ni_fatal("cannot register %s object", path);
+	ni_dbus_object_register_service(object, &test_device_service);
+}
+
+static void
+run_server(int ready)
+{
+	ni_netconfig_t *nc;
+
+	if (!(nc = ni_global_state_handle(1)))
+		ni_fatal("cannot refresh global state!");
+	if (!(test_peer = ni_netdev_by_name(nc, "lo")))
+		ni_fatal("cannot find the loopback device");
+
+	if (!(test_server = ni_dbus_server_open("session", TEST_BUS_NAME, NULL)))
+		ni_fatal("cannot open dbus server");
+
+	ni_server_listen_interface_changes(test_device_modified);
+
+	/* caller, refreshed peer and an object nobody touches */
+	test_device_register("Device/0", ni_netdev_new("caller0", 0));
+	test_device_register("Device/1", test_peer);
+	test_device_register("Device/2", ni_netdev_new("other0", 0));
+
+	if (write(ready, "", 1) != 1)
+		ni_fatal("cannot signal readiness: %m");
+	close(ready);
+
+	while (ni_socket_wait(ni_timer_next_timeout()) >= 0)
+		ni_dbus_objects_garbage_collect();
+	exit(1);
+}
+
+static ni_bool_t
+get_managed_objects_since(ni_dbus_object_t *root, uint32_t since,
+				uint32_t *generation, ni_dbus_variant_t *objects)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_variant_t args[2], res[3];
+	unsigned int i;
+	ni_bool_t rv;
+
+	memset(args, 0, sizeof(args));
+	memset(res, 0, sizeof(res));
+	ni_dbus_variant_set_uint32(&args[0], since);
+	ni_dbus_variant_init_string_array(&args[1]);
+
+	rv = ni_dbus_object_call_variant(root, NI_DBUS_INTERFACE ".ObjectManager",
+			"GetManagedObjectsSince", 2, args, 3, res, &error);
+	if (!rv) {
+		ni_dbus_print_error(&error, "GetManagedObjectsSince failed");
+		dbus_error_free(&error);
+	} else {
+		rv = ni_dbus_variant_get_uint32(&res[0], generation);
+		/* hand the dict over to the caller */
+		*objects = res[1];
+		memset(&res[1], 0, sizeof(res[1]));
+	}
+
+	for (i = 0; i < 2; ++i)
+		ni_dbus_variant_destroy(&args[i]);
+	for (i = 0; i < 3; ++i)
+		ni_dbus_variant_destroy(&res[i]);
+	return rv;
+}
+
+static ni_bool_t
+check_objects(const ni_dbus_variant_t *objects, const char *path, ni_bool_t expected)
+{
+	ni_bool_t found = ni_dbus_dict_get(objects, path) != NULL;
+
+	printf("  %-40s %-12s %s\n", path, found ? "returned" : "not returned",
+			found == expected ? "ok" : "FAILED");
+	return found == expected;
+}
+
+static int
+run_client(void)
+{
+	ni_dbus_variant_t objects = NI_DBUS_VARIANT_INIT;
+	ni_dbus_object_t *root, *caller;
+	ni_dbus_client_t *client;
+	uint32_t generation = 0, since;
+	int failed = 0;
+
+	if (!(client = ni_dbus_client_open("session", TEST_BUS_NAME)))
+		return 1;
+
+	root = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class,
+			TEST_ROOT_PATH, NULL, NULL);
+	caller = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class,
+			TEST_ROOT_PATH "/Device/0", TEST_DEVICE_INTERFACE, NULL);
+
+	if (!get_managed_objects_since(root, 0, &generation, &objects))
+		return 1;
+	ni_dbus_variant_destroy(&objects);
+	since = generation;
+
+	if (ni_dbus_object_call_simple(caller, NULL, "refreshPeer",
+				DBUS_TYPE_INVALID, NULL, DBUS_TYPE_INVALID, NULL) < 0) {
+		ni_error("refreshPeer call failed");
+		return 1;
+	}
+
+	if (!get_managed_objects_since(root, since, &generation, &objects))
+		return 1;
+
+	printf("objects changed since generation %u (now %u):\n", since, generation);
+	failed |= !check_objects(&objects, TEST_ROOT_PATH "/Device/0", TRUE);
+	failed |= !check_objects(&objects, TEST_ROOT_PATH "/Device/1", TRUE);
+	failed |= !check_objects(&objects, TEST_ROOT_PATH "/Device/2", FALSE);
+	ni_dbus_variant_destroy(&objects);
+
+	ni_dbus_object_free(caller);
+	ni_dbus_object_free(root);
+	ni_dbus_client_free(client);
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	int ready[2], status;
+	char byte;
+	pid_t pid;
+	int rv;
+
+	if (ni_init(ni_basename(argv[0])) < 0)
+		return 1;
+
+	if (pipe(ready) < 0)
+		ni_fatal("pipe: %m");
+
+	if ((pid = fork()) < 0)
+		ni_fatal("fork: %m");
+	if (pid == 0) {
+		close(ready[0]);
+		run_server(ready[1]);
+	}
+
+	close(ready[1]);
+	if (read(ready[0], &byte, 1) != 1) {
+		ni_error("dbus server failed to start");
+		rv = 1;
+	} else {
+		rv = run_client();
+	}
+	close(ready[0]);
+
+	kill(pid, SIGTERM);
+	waitpid(pid, &status, 0);
+	return rv;
+}
@@ -0,0 +1,1003 @@
+/*
+ * DHCPv4/DHCPv6 supplicant load benchmark
+ *
+ *   dhcp-bench responder [-4|-6] -p prefix -n count
+ *	minimal DHCP server answering on the interfaces prefix0 up
+ *	to prefix<count-1>; the client on each link gets the server
+ *	address + 1 (v4) or fd00:0:0:<ifindex>::2 (v6).
+ *
+ *   dhcp-bench run [-4|-6] -p prefix -n count [-P pid] [-t sec] [-w window]
+ *	drives acquire, renew (re-acquire) and release of a lease on
+ *	all count interfaces through the wickedd-dhcp4/6 dbus API and
+ *	reports latency percentiles per phase as well as the cpu time
+ *	and memory used by the supplicant with the given pid.
+ *
+ * See scripts/dhcp-bench.sh to run both in network namespaces.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <time.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/netinfo.h>
+#include <wicked/socket.h>
+#include <wicked/dbus.h>
+#include <wicked/addrconf.h>
+#include <wicked/objectmodel.h>
+
+#include "socket_priv.h"
+#include "dhcp4/protocol.h"
+#include "dhcp6/dhcp6.h"
+#include "dhcp6/device.h"
+#include "dhcp6/protocol.h"
+#include "dhcp6/options.h"
+
+static struct {
+	int			family;
+	const char *		prefix;
+	unsigned int		count;
+	unsigned int		timeout;	/* per phase, in sec */
+	unsigned int		window;		/* max. requests in flight */
+	pid_t			pid;		/* supplicant to account */
+} opt = {
+	.family		= AF_INET,
+	.count		= 1,
+	.timeout	= 60,
+};
+
+static double
+elapsed_msec(const struct timeval *beg, const struct timeval *end)
+{
+	return (end->tv_sec - beg->tv_sec) * 1000.0 +
+		(end->tv_usec - beg->tv_usec) / 1000.0;
+}
+
+/*
+ * Responder side
+ */
+typedef struct bench_link {
+	char			name[IFNAMSIZ];
+	unsigned int		ifindex;
+	struct in_addr		addr;		/* v4 server address */
+	struct in_addr		mask;
+	struct in6_addr		lease6;		/* v6 address handed out */
+	unsigned char		duid[10];	/* v6 server DUID-LL */
+} bench_link_t;
+
+static bench_link_t *		links;
+
+static bench_link_t *
+bench_link_by_index(unsigned int ifindex)
+{
+	unsigned int i;
+
+	for (i = 0; i < opt.count; ++i) {
+		if (links[i].ifindex == ifindex)
+			return &links[i];
+	}
+	return NULL;
+}
+
+static ni_bool_t
+bench_link_init(bench_link_t *link, unsigned int index, int fd)
+{
+	struct ifreq ifr;
+
+	snprintf(link->name, sizeof(link->name), "%s%u", opt.prefix, index);
+	if (!(link->ifindex = if_nametoindex(link->name))) {
+		ni_error("%s: unknown interface", link->name);
+		return FALSE;
+	}
+
+	if (opt.family == AF_INET) {
+		memset(&ifr, 0, sizeof(ifr));
+		memcpy(ifr.ifr_name, link->name, sizeof(ifr.ifr_name));
+		if (ioctl(fd, SIOCGIFADDR, &ifr) < 0) {
+			ni_error("%s: no ipv4 address: %m", link->name);
+			return FALSE;
+		}
+		link->addr = ((struct sockaddr_in *)&ifr.ifr_addr)->sin_addr;
+		if (ioctl(fd, SIOCGIFNETMASK, &ifr) < 0) {
+			ni_error("%s: no ipv4 netmask: %m", link->name);
+			return FALSE;
+		}
+		link->mask = ((struct sockaddr_in *)&ifr.ifr_addr)->sin_addr;
+	} else {
+		link->lease6.s6_addr[0]  = 0xfd;
+		link->lease6.s6_addr[6]  = (link->ifindex >> 8) & 0xff;
+		link->lease6.s6_addr[7]  = link->ifindex & 0xff;
+		link->lease6.s6_addr[15] = 2;
+
+		/* DUID-LL, ethernet, 02:00:00:00:<ifindex> */
+		link->duid[1] = 3;
+		link->duid[3] = 1;
+		link->duid[4] = 0x02;
+		link->duid[8] = (link->ifindex >> 8) & 0xff;
+		link->duid[9] = link->ifindex & 0xff;
+	}
+	return TRUE;
+}
+
+static const unsigned char *
+dhcp4_option_find(const unsigned char *ptr, const unsigned char *end,
+		unsigned int code, unsigned int *len)
+{
+	while (ptr < end && *ptr != 255) {
+		if (*ptr == 0) {
+			ptr++;
+			continue;
+		}
+		if (ptr + 2 > end || ptr + 2 + ptr[1] > end)
+			break;
+		if (*ptr == code) {
+			*len = ptr[1];
+			return ptr + 2;
+		}
+		ptr += 2 + ptr[1];
+	}
+	return NULL;
+}
+
+static unsigned char *
+dhcp4_option_put(unsigned char *ptr, unsigned int code, const void *data, unsigned int len)
+{
+	*ptr++ = code;
+	*ptr++ = len;
+	memcpy(ptr, data, len);
+	return ptr + len;
+}
+
+static unsigned char *
+dhcp4_option_put_u32(unsigned char *ptr, unsigned int code, uint32_t value)
+{
+	value = htonl(value);
+	return dhcp4_option_put(ptr, code, &value, sizeof(value));
+}
+
+static void
+dhcp4_respond(int fd, const bench_link_t *link, const unsigned char *buf, size_t len)
+{
+	const struct ni_dhcp4_message *req = (const struct ni_dhcp4_message *)buf;
+	unsigned char out[MTU_MAX], cbuf[CMSG_SPACE(sizeof(struct in_pktinfo))];
+	struct ni_dhcp4_message *msg = (struct ni_dhcp4_message *)out;
+	const unsigned char *opts = buf + sizeof(*req), *end = buf + len, *data;
+	struct sockaddr_in dst;
+	struct in_addr yiaddr;
+	struct iovec iov;
+	struct msghdr mh;
+	struct cmsghdr *cm;
+	struct in_pktinfo *pi;
+	unsigned int olen, type;
+	unsigned char *ptr;
+	uint32_t requested;
+
+	if (req->op != DHCP4_BOOTREQUEST || req->cookie != htonl(MAGIC_COOKIE))
+		return;
+	if (!(data = dhcp4_option_find(opts, end, 53, &olen)) || olen != 1)
+		return;
+
+	yiaddr.s_addr = htonl(ntohl(link->addr.s_addr) + 1);
+	switch (*data) {
+	case DHCP4_DISCOVER:
+		type = DHCP4_OFFER;
+		break;
+	case DHCP4_REQUEST:
+		requested = req->ciaddr;
+		if ((data = dhcp4_option_find(opts, end, 50, &olen)) && olen == 4)
+			memcpy(&requested, data, 4);
+		type = requested == yiaddr.s_addr ? DHCP4_ACK : DHCP4_NAK;
+		break;
+	case DHCP4_INFORM:
+		type = DHCP4_ACK;
+		yiaddr.s_addr = 0;
+		break;
+	default:
+		/* release, decline */
+		return;
+	}
+
+	memset(out, 0, sizeof(out));
+	msg->op = DHCP4_BOOTREPLY;
+	msg->hwtype = req->hwtype;
+	msg->hwlen = req->hwlen;
+	msg->xid = req->xid;
+	msg->flags = req->flags;
+	msg->giaddr = req->giaddr;
+	memcpy(msg->chaddr, req->chaddr, sizeof(msg->chaddr));
+	msg->cookie = htonl(MAGIC_COOKIE);
+	if (type != DHCP4_NAK) {
+		msg->ciaddr = req->ciaddr;
+		msg->yiaddr = yiaddr.s_addr;
+		msg->siaddr = link->addr.s_addr;
+	}
+
+	ptr = out + sizeof(*msg);
+	*ptr++ = 53; *ptr++ = 1; *ptr++ = type;
+	ptr = dhcp4_option_put(ptr, 54, &link->addr, 4);
+	if (type != DHCP4_NAK && yiaddr.s_addr) {
+		ptr = dhcp4_option_put_u32(ptr, 51, DHCP4_DEFAULT_LEASETIME);
+		ptr = dhcp4_option_put_u32(ptr, 58, DHCP4_DEFAULT_LEASETIME / 2);
+		ptr = dhcp4_option_put_u32(ptr, 59, DHCP4_DEFAULT_LEASETIME * 7 / 8);
+	}
+	if (type != DHCP4_NAK)
+		ptr = dhcp4_option_put(ptr, 1, &link->mask, 4);
+	*ptr++ = 255;
+	if (ptr - out < BOOTP_MESSAGE_LENGTH_MIN)
+		ptr = out + BOOTP_MESSAGE_LENGTH_MIN;
+
+	memset(&dst, 0, sizeof(dst));
+	dst.sin_family = AF_INET;
+	dst.sin_port = htons(DHCP4_CLIENT_PORT);
+	dst.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+
+	iov.iov_base = out;
+	iov.iov_len = ptr - out;
+	memset(&mh, 0, sizeof(mh));
+	memset(cbuf, 0, sizeof(cbuf));
+	mh.msg_name = &dst;
+	mh.msg_namelen = sizeof(dst);
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_control = cbuf;
+	mh.msg_controllen = sizeof(cbuf);
+
+	cm = CMSG_FIRSTHDR(&mh);
+	cm->cmsg_level = IPPROTO_IP;
+	cm->cmsg_type = IP_PKTINFO;
+	cm->cmsg_len = CMSG_LEN(sizeof(*pi));
+	pi = (struct in_pktinfo *)CMSG_DATA(cm);
+	pi->ipi_ifindex = link->ifindex;
+	pi->ipi_spec_dst = link->addr;
+
+	if (sendmsg(fd, &mh, 0) < 0)
+		ni_warn("%s: unable to send dhcp4 reply: %m", link->name);
+}
+
+static void
+dhcp4_responder_recv(ni_socket_t *sock)
+{
+	unsigned char buf[MTU_MAX], cbuf[CMSG_SPACE(sizeof(struct in_pktinfo))];
+	const bench_link_t *link;
+	struct in_pktinfo *pi;
+	struct cmsghdr *cm;
+	struct iovec iov;
+	struct msghdr mh;
+	ssize_t len;
+
+	/* drain, the socket loop may be edge triggered */
+	for (;;) {
+		iov.iov_base = buf;
+		iov.iov_len = sizeof(buf);
+		memset(&mh, 0, sizeof(mh));
+		mh.msg_iov = &iov;
+		mh.msg_iovlen = 1;
+		mh.msg_control = cbuf;
+		mh.msg_controllen = sizeof(cbuf);
+
+		if ((len = recvmsg(sock->__fd, &mh, MSG_DONTWAIT)) < 0)
+			break;
+		if (len < (ssize_t)sizeof(struct ni_dhcp4_message))
+			continue;
+
+		link = NULL;
+		for (cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+			if (cm->cmsg_level != IPPROTO_IP || cm->cmsg_type != IP_PKTINFO)
+				continue;
+			pi = (struct in_pktinfo *)CMSG_DATA(cm);
+			link = bench_link_by_index(pi->ipi_ifindex);
+		}
+		if (link)
+			dhcp4_respond(sock->__fd, link, buf, len);
+	}
+}
+
+static ni_bool_t
+dhcp4_responder_open(void)
+{
+	struct sockaddr_in sin;
+	ni_socket_t *sock;
+	int fd, on = 1;
+
+	if ((fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0) {
+		ni_error("unable to create dhcp4 socket: %m");
+		return FALSE;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+	setsockopt(fd, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on));
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(DHCP4_SERVER_PORT);
+	if (bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+		ni_error("unable to bind dhcp4 server port: %m");
+		close(fd);
+		return FALSE;
+	}
+
+	if (!(sock = ni_socket_wrap(fd, SOCK_DGRAM)))
+		return FALSE;
+	sock->receive = dhcp4_responder_recv;
+	return ni_socket_activate(sock);
+}
+
+static unsigned char *
+dhcp6_option_put(unsigned char *ptr, unsigned int code, const void *data, unsigned int len)
+{
+	*ptr++ = code >> 8;
+	*ptr++ = code & 0xff;
+	*ptr++ = len >> 8;
+	*ptr++ = len & 0xff;
+	if (len)
+		memcpy(ptr, data, len);
+	return ptr + len;
+}
+
+static void
+dhcp6_put_u32(unsigned char *ptr, uint32_t value)
+{
+	value = htonl(value);
+	memcpy(ptr, &value, sizeof(value));
+}
+
+static void
+dhcp6_respond(int fd, const bench_link_t *link, const unsigned char *buf, size_t len,
+		const struct sockaddr_in6 *from)
+{
+	const unsigned char *ptr = buf + 4, *end = buf + len;
+	const unsigned char *clientid = NULL, *iaid = NULL;
+	unsigned int clientid_len = 0, code, olen, type;
+	unsigned char out[512], ia[12 + 4 + 24], *optr;
+	static const unsigned char status[] = { 0, NI_DHCP6_STATUS_SUCCESS, 's', 'u', 'c', 'c', 'e', 's', 's' };
+	ni_bool_t rapid = FALSE, lease = FALSE;
+
+	while (ptr + 4 <= end) {
+		code = (ptr[0] << 8) | ptr[1];
+		olen = (ptr[2] << 8) | ptr[3];
+		if (ptr + 4 + olen > end)
+			return;
+		switch (code) {
+		case NI_DHCP6_OPTION_CLIENTID:
+			clientid = ptr + 4;
+			clientid_len = olen;
+			break;
+		case NI_DHCP6_OPTION_IA_NA:
+			if (olen >= 12 && !iaid)
+				iaid = ptr + 4;
+			break;
+		case NI_DHCP6_OPTION_RAPID_COMMIT:
+			rapid = TRUE;
+			break;
+		}
+		ptr += 4 + olen;
+	}
+	if (!clientid)
+		return;
+
+	switch (buf[0]) {
+	case NI_DHCP6_SOLICIT:
+		type = rapid ? NI_DHCP6_REPLY : NI_DHCP6_ADVERTISE;
+		lease = TRUE;
+		break;
+	case NI_DHCP6_REQUEST:
+	case NI_DHCP6_RENEW:
+	case NI_DHCP6_REBIND:
+		type = NI_DHCP6_REPLY;
+		lease = TRUE;
+		break;
+	case NI_DHCP6_CONFIRM:
+	case NI_DHCP6_RELEASE:
+	case NI_DHCP6_DECLINE:
+	case NI_DHCP6_INFO_REQUEST:
+		type = NI_DHCP6_REPLY;
+		break;
+	default:
+		return;
+	}
+	if (clientid_len > 128)
+		return;
+
+	out[0] = type;
+	memcpy(out + 1, buf + 1, 3);
+	optr = dhcp6_option_put(out + 4, NI_DHCP6_OPTION_CLIENTID, clientid, clientid_len);
+	optr = dhcp6_option_put(optr, NI_DHCP6_OPTION_SERVERID, link->duid, sizeof(link->duid));
+	if (type == NI_DHCP6_ADVERTISE) {
+		unsigned char preference = 255;
+
+		optr = dhcp6_option_put(optr, NI_DHCP6_OPTION_PREFERENCE, &preference, 1);
+	} else if (buf[0] == NI_DHCP6_SOLICIT) {
+		optr = dhcp6_option_put(optr, NI_DHCP6_OPTION_RAPID_COMMIT, NULL, 0);
+	}
+
+	if (lease && iaid) {
+		/* IA_NA: iaid, T1, T2, IAADDR: address, preferred, valid */
+		memcpy(ia, iaid, 4);
+		dhcp6_put_u32(ia + 4, DHCP4_DEFAULT_LEASETIME / 2);
+		dhcp6_put_u32(ia + 8, DHCP4_DEFAULT_LEASETIME * 4 / 5);
+		ia[12] = NI_DHCP6_OPTION_IA_ADDRESS >> 8;
+		ia[13] = NI_DHCP6_OPTION_IA_ADDRESS & 0xff;
+		ia[14] = 0;
+		ia[15] = 24;
+		memcpy(ia + 16, &link->lease6, 16);
+		dhcp6_put_u32(ia + 32, DHCP4_DEFAULT_LEASETIME);
+		dhcp6_put_u32(ia + 36, DHCP4_DEFAULT_LEASETIME * 2);
+		optr = dhcp6_option_put(optr, NI_DHCP6_OPTION_IA_NA, ia, sizeof(ia));
+	} else if (!lease) {
+		optr = dhcp6_option_put(optr, NI_DHCP6_OPTION_STATUS_CODE, status, sizeof(status));
+	}
+
+	if (sendto(fd, out, optr - out, 0, (const struct sockaddr *)from, sizeof(*from)) < 0)
+		ni_warn("%s: unable to send dhcp6 reply: %m", link->name);
+}
+
+static void
+dhcp6_responder_recv(ni_socket_t *sock)
+{
+	const bench_link_t *link = sock->user_data;
+	unsigned char buf[MTU_MAX];
+	struct sockaddr_in6 from;
+	socklen_t alen;
+	ssize_t len;
+
+	for (;;) {
+		alen = sizeof(from);
+		len = recvfrom(sock->__fd, buf, sizeof(buf), MSG_DONTWAIT,
+				(struct sockaddr *)&from, &alen);
+		if (len < 0)
+			break;
+		if (len >= 4 && alen == sizeof(from))
+			dhcp6_respond(sock->__fd, link, buf, len, &from);
+	}
+}
+
+static ni_bool_t
+dhcp6_responder_open(bench_link_t *link)
+{
+	struct sockaddr_in6 sin6;
+	struct ipv6_mreq mreq;
+	ni_socket_t *sock;
+	int fd, on = 1;
+
+	if ((fd = socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0) {
+		ni_error("unable to create dhcp6 socket: %m");
+		return FALSE;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on));
+	if (setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, link->name, strlen(link->name)) < 0) {
+		ni_error("%s: unable to bind dhcp6 socket to device: %m", link->name);
+		goto failed;
+	}
+
+	memset(&sin6, 0, sizeof(sin6));
+	sin6.sin6_family = AF_INET6;
+	sin6.sin6_port = htons(NI_DHCP6_SERVER_PORT);
+	if (bind(fd, (struct sockaddr *)&sin6, sizeof(sin6)) < 0) {
+		ni_error("%s: unable to bind dhcp6 server port: %m", link->name);
+		goto failed;
+	}
+
+	memset(&mreq, 0, sizeof(mreq));
+	inet_pton(AF_INET6, NI_DHCP6_ALL_RAGENTS, &mreq.ipv6mr_multiaddr);
+	mreq.ipv6mr_interface = link->ifindex;
+	if (setsockopt(fd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq, sizeof(mreq)) < 0) {
+		ni_error("%s: unable to join %s: %m", link->name, NI_DHCP6_ALL_RAGENTS);
+		goto failed;
+	}
+
+	if (!(sock = ni_socket_wrap(fd, SOCK_DGRAM)))
+		return FALSE;
+	sock->receive = dhcp6_responder_recv;
+	sock->user_data = link;
+	return ni_socket_activate(sock);
+
+failed:
+	close(fd);
+	return FALSE;
+}
+
+static int
+bench_responder(void)
+{
+	unsigned int i;
+	int fd;
+
+	if ((fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0)
+		return 1;
+	links = xcalloc(opt.count, sizeof(*links));
+	for (i = 0; i < opt.count; ++i) {
+		if (!bench_link_init(&links[i], i, fd)) {
+			close(fd);
+			return 1;
+		}
+		if (opt.family == AF_INET6 && !dhcp6_responder_open(&links[i])) {
+			close(fd);
+			return 1;
+		}
+	}
+	close(fd);
+
+	if (opt.family == AF_INET && !dhcp4_responder_open())
+		return 1;
+
+	ni_note("responding on %u %s links", opt.count, opt.prefix);
+	for (;;) {
+		long timeout = ni_timer_next_timeout();
+
+		if (ni_socket_wait(timeout) < 0)
+			ni_fatal("ni_socket_wait failed");
+	}
+	return 0;
+}
+
+/*
+ * Driver side
+ */
+enum {
+	BENCH_IDLE,
+	BENCH_CALLING,		/* method call not yet answered */
+	BENCH_WAITING,		/* waiting for the lease signal */
+	BENCH_DONE,
+	BENCH_FAILED,
+};
+
+typedef struct bench_device {
+	char			name[IFNAMSIZ];
+	unsigned int		ifindex;
+	ni_dbus_object_t *	proxy;
+	ni_uuid_t		uuid;
+
+	int			state;
+	struct timeval		started;
+	double			latency;	/* of the current phase, msec */
+	const ni_timer_t *	retry;
+} bench_device_t;
+
+typedef struct bench_phase {
+	const char *		name;
+	const char *		method;
+	const char *		signal;
+} bench_phase_t;
+
+/* renew re-acquires with the same uuid, confirming the bound lease */
+static const bench_phase_t	bench_phases[] = {
+	{ "acquire",	"acquire",	NI_OBJECTMODEL_LEASE_ACQUIRED_SIGNAL	},
+	{ "renew",	"acquire",	NI_OBJECTMODEL_LEASE_ACQUIRED_SIGNAL	},
+	{ "release",	"drop",		NI_OBJECTMODEL_LEASE_RELEASED_SIGNAL	},
+};
+
+typedef struct bench_usage {
+	double			cpu;		/* user + system, msec */
+	unsigned long		rss;		/* kB */
+	unsigned long		hwm;		/* kB */
+} bench_usage_t;
+
+static ni_dbus_class_t		bench_device_class = {
+	.name		= "dhcp-bench-device",
+};
+
+static struct {
+	const char *		interface;
+	const bench_phase_t *	phase;
+	struct timeval		deadline;
+
+	bench_device_t *	devs;
+	unsigned int		next;		/* next device to start */
+	unsigned int		inflight;
+	unsigned int		finished;
+	unsigned int		failed;
+} bench;
+
+static void			bench_device_start(bench_device_t *);
+
+static bench_device_t *
+bench_device_by_path(const char *path)
+{
+	const char *base;
+	unsigned int ifindex, i;
+
+	if (!path || !(base = strrchr(path, '/')))
+		return NULL;
+	if (ni_parse_uint(base + 1, &ifindex, 10) < 0)
+		return NULL;
+
+	for (i = 0; i < opt.count; ++i) {
+		if (bench.devs[i].ifindex == ifindex)
+			return &bench.devs[i];
+	}
+	return NULL;
+}
+
+static void
+bench_device_finish(bench_device_t *dev, ni_bool_t success)
+{
+	struct timeval now;
+
+	if (dev->state != BENCH_CALLING && dev->state != BENCH_WAITING)
+		return;
+
+	ni_timer_get_time(&now);
+	dev->latency = elapsed_msec(&dev->started, &now);
+	dev->state = success ? BENCH_DONE : BENCH_FAILED;
+	if (success)
+		bench.finished++;
+	else
+		bench.failed++;
+	bench.inflight--;
+
+	while (bench.next < opt.count && (!opt.window || bench.inflight < opt.window))
+		bench_device_start(&bench.devs[bench.next++]);
+}
+
+static void
+bench_device_retry(void *user_data, const ni_timer_t *timer)
+{
+	bench_device_t *dev = user_data;
+
+	if (dev->retry != timer)
+		return;
+	dev->retry = NULL;
+	bench.inflight--;
+	if (bench.phase && dev->state == BENCH_IDLE)
+		bench_device_start(dev);
+}
+
+static void
+bench_call_done(ni_dbus_object_t *proxy, ni_dbus_message_t *reply)
+{
+	bench_device_t *dev = proxy->handle;
+	struct timeval now;
+	DBusError error;
+
+	if (dev->state != BENCH_CALLING)
+		return;
+
+	dbus_error_init(&error);
+	if (!dbus_set_error_from_message(&error, reply)) {
+		dev->state = BENCH_WAITING;
+		return;
+	}
+
+	/* the supplicant is not (yet) on the bus or the device not yet known */
+	ni_timer_get_time(&now);
+	if ((dbus_error_has_name(&error, DBUS_ERROR_SERVICE_UNKNOWN) ||
+	     dbus_error_has_name(&error, DBUS_ERROR_UNKNOWN_METHOD) ||
+	     dbus_error_has_name(&error, "org.freedesktop.DBus.Error.UnknownObject")) &&
+	    timercmp(&now, &bench.deadline, <)) {
+		dev->state = BENCH_IDLE;
+		dev->retry = ni_timer_register(100, bench_device_retry, dev);
+	} else {
+		ni_error("%s: %s failed: %s", dev->name, bench.phase->method, error.message);
+		bench_device_finish(dev, FALSE);
+	}
+	dbus_error_free(&error);
+}
+
+static void
+bench_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg, void *user_data)
+{
+	const char *member = dbus_message_get_member(msg);
+	bench_device_t *dev;
+
+	(void)conn;
+	(void)user_data;
+	if (!bench.phase || !(dev = bench_device_by_path(dbus_message_get_path(msg))))
+		return;
+
+	if (ni_string_eq(member, bench.phase->signal))
+		bench_device_finish(dev, TRUE);
+	else if (ni_string_eq(member, NI_OBJECTMODEL_LEASE_LOST_SIGNAL))
+		bench_device_finish(dev, FALSE);
+}
+
+static void
+bench_device_start(bench_device_t *dev)
+{
+	ni_dbus_variant_t argv[2];
+	unsigned int argc = 0;
+	int rv;
+
+	memset(argv, 0, sizeof(argv));
+	ni_dbus_variant_set_uuid(&argv[argc++], &dev->uuid);
+	if (ni_string_eq(bench.phase->method, "acquire")) {
+		ni_dbus_variant_t *dict = &argv[argc++];
+
+		ni_dbus_variant_init_dict(dict);
+		ni_dbus_dict_add_bool(dict, "enabled", TRUE);
+		ni_dbus_dict_add_uuid(dict, "uuid", &dev->uuid);
+		ni_dbus_dict_add_bool(dict, "recover-lease", FALSE);
+		ni_dbus_dict_add_bool(dict, "release-lease", TRUE);
+		if (opt.family == AF_INET6)
+			ni_dbus_dict_add_uint32(dict, "mode", NI_BIT(NI_DHCP6_MODE_MANAGED));
+	}
+
+	bench.inflight++;
+	dev->state = BENCH_CALLING;
+	ni_timer_get_time(&dev->started);
+	rv = ni_dbus_object_call_variant_async(dev->proxy, bench.interface,
+			bench.phase->method, argc, argv, bench_call_done, NULL);
+	ni_dbus_variant_destroy(&argv[0]);
+	if (argc > 1)
+		ni_dbus_variant_destroy(&argv[1]);
+
+	if (rv < 0) {
+		ni_error("%s: unable to call %s: %s", dev->name,
+				bench.phase->method, ni_strerror(rv));
+		bench_device_finish(dev, FALSE);
+	}
+}
+
+static ni_bool_t
+bench_usage_get(pid_t pid, bench_usage_t *usage)
+{
+	unsigned long utime, stime;
+	char path[64], line[256], *p;
+	FILE *fp;
+
+	memset(usage, 0, sizeof(*usage));
+	if (!pid)
+		return FALSE;
+
+	snprintf(path, sizeof(path), "/proc/%ld/stat", (long)pid);
+	if (!(fp = fopen(path, "r")))
+		return FALSE;
+	/* comm may contain blanks, fields continue after the last ')' */
+	if (!fgets(line, sizeof(line), fp) || !(p = strrchr(line, ')')) ||
+	    sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+		    &utime, &stime) != 2) {
+		fclose(fp);
+		return FALSE;
+	}
+	fclose(fp);
+	usage->cpu = (utime + stime) * 1000.0 / sysconf(_SC_CLK_TCK);
+
+	snprintf(path, sizeof(path), "/proc/%ld/status", (long)pid);
+	if (!(fp = fopen(path, "r")))
+		return FALSE;
+	while (fgets(line, sizeof(line), fp)) {
+		if (!strncmp(line, "VmRSS:", 6))
+			usage->rss = strtoul(line + 6, NULL, 10);
+		else if (!strncmp(line, "VmHWM:", 6))
+			usage->hwm = strtoul(line + 6, NULL, 10);
+	}
+	fclose(fp);
+	return TRUE;
+}
+
+static int
+bench_latency_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double
+bench_percentile(const double *sorted, unsigned int count, unsigned int pct)
+{
+	unsigned int idx;
+
+	if (!count)
+		return 0;
+	idx = (count * pct + 99) / 100;
+	return sorted[idx ? idx - 1 : 0];
+}
+
+static void
+bench_report(const bench_phase_t *phase, double wall,
+		const bench_usage_t *beg, const bench_usage_t *end)
+{
+	double *latency;
+	unsigned int i, n = 0;
+
+	latency = xcalloc(opt.count, sizeof(*latency));
+	for (i = 0; i < opt.count; ++i) {
+		if (bench.devs[i].state == BENCH_DONE)
+			latency[n++] = bench.devs[i].latency;
+	}
+	qsort(latency, n, sizeof(*latency), bench_latency_cmp);
+
+	printf("%-8s %6u %6u %9.2f %9.2f %9.2f %9.2f %9.1f %9.1f %8lu %8lu\n",
+			phase->name, n, opt.count - n,
+			bench_percentile(latency, n, 50),
+			bench_percentile(latency, n, 90),
+			bench_percentile(latency, n, 99),
+			n ? latency[n - 1] : 0.0, wall,
+			end->cpu - beg->cpu, end->rss, end->hwm);
+	fflush(stdout);
+	free(latency);
+}
+
+static void
+bench_run_phase(const bench_phase_t *phase)
+{
+	bench_usage_t beg, end;
+	struct timeval start, now;
+	unsigned int i;
+	long timeout, remain;
+
+	bench_usage_get(opt.pid, &beg);
+	ni_timer_get_time(&start);
+	bench.deadline = start;
+	bench.deadline.tv_sec += opt.timeout;
+
+	bench.phase = phase;
+	bench.next = bench.inflight = bench.finished = bench.failed = 0;
+	for (i = 0; i < opt.count; ++i) {
+		bench_device_t *dev = &bench.devs[i];
+
+		/* a retry left over from the previous phase would start it twice */
+		if (dev->retry) {
+			ni_timer_cancel(dev->retry);
+			dev->retry = NULL;
+		}
+		dev->state = BENCH_IDLE;
+	}
+
+	while (bench.next < opt.count && (!opt.window || bench.inflight < opt.window))
+		bench_device_start(&bench.devs[bench.next++]);
+
+	while (bench.finished + bench.failed < opt.count) {
+		ni_timer_get_time(&now);
+		if ((remain = elapsed_msec(&now, &bench.deadline)) <= 0)
+			break;
+
+		timeout = ni_timer_next_timeout();
+		if (timeout < 0 || timeout > remain)
+			timeout = remain;
+		if (ni_socket_wait(timeout) < 0)
+			ni_fatal("ni_socket_wait failed");
+	}
+
+	for (i = 0; i < opt.count; ++i) {
+		if (bench.devs[i].state != BENCH_DONE && bench.devs[i].state != BENCH_FAILED)
+			ni_error("%s: %s timed out", bench.devs[i].name, phase->name);
+	}
+	ni_timer_get_time(&now);
+	bench_usage_get(opt.pid, &end);
+	bench_report(phase, elapsed_msec(&start, &now), &beg, &end);
+	bench.phase = NULL;
+}
+
+static int
+bench_run(void)
+{
+	const char *busname, *objpath;
+	ni_dbus_client_t *client;
+	char path[256];
+	unsigned int i;
+
+	if (opt.family == AF_INET) {
+		busname = NI_OBJECTMODEL_DBUS_BUS_NAME_DHCP4;
+		objpath = NI_OBJECTMODEL_OBJECT_PATH "/DHCP4/Interface";
+		bench.interface = NI_OBJECTMODEL_DHCP4_INTERFACE;
+	} else {
+		busname = NI_OBJECTMODEL_DBUS_BUS_NAME_DHCP6;
+		objpath = NI_OBJECTMODEL_OBJECT_PATH "/DHCP6/Interface";
+		bench.interface = NI_OBJECTMODEL_DHCP6_INTERFACE;
+	}
+
+	if (!(client = ni_dbus_client_open("system", busname))) {
+		ni_error("unable to connect to %s", busname);
+		return 1;
+	}
+	ni_dbus_client_add_signal_handler(client, NULL, NULL,
+			NI_OBJECTMODEL_ADDRCONF_INTERFACE, bench_signal, NULL);
+
+	bench.devs = xcalloc(opt.count, sizeof(*bench.devs));
+	for (i = 0; i < opt.count; ++i) {
+		bench_device_t *dev = &bench.devs[i];
+
+		snprintf(dev->name, sizeof(dev->name), "%s%u", opt.prefix, i);
+		if (!(dev->ifindex = if_nametoindex(dev->name))) {
+			ni_error("%s: unknown interface", dev->name);
+			return 1;
+		}
+		snprintf(path, sizeof(path), "%s/%u", objpath, dev->ifindex);
+		dev->proxy = ni_dbus_client_object_new(client, &bench_device_class,
+				path, bench.interface, dev);
+		ni_uuid_generate(&dev->uuid);
+	}
+
+	printf("%s, %u devices, window %u\n", busname, opt.count, opt.window);
+	printf("%-8s %6s %6s %9s %9s %9s %9s %9s %9s %8s %8s\n",
+			"phase", "ok", "failed", "p50 ms", "p90 ms", "p99 ms",
+			"max ms", "wall ms", "cpu ms", "rss kB", "hwm kB");
+	for (i = 0; i < sizeof(bench_phases) / sizeof(bench_phases[0]); ++i)
+		bench_run_phase(&bench_phases[i]);
+
+	ni_dbus_client_free(client);
+	return 0;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+		"Usage: dhcp-bench responder [-4|-6] -p prefix -n count\n"
+		"       dhcp-bench run [-4|-6] -p prefix -n count [-P pid] [-t timeout] [-w window]\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *mode;
+	unsigned int pid;
+	int c;
+
+	if (argc < 2) {
+		usage();
+		return 1;
+	}
+	mode = argv[1];
+	argv++;
+	argc--;
+
+	while ((c = getopt(argc, argv, "46p:n:P:t:w:d:")) != -1) {
+		switch (c) {
+		case '4':
+			opt.family = AF_INET;
+			break;
+		case '6':
+			opt.family = AF_INET6;
+			break;
+		case 'p':
+			opt.prefix = optarg;
+			break;
+		case 'n':
+			if (ni_parse_uint(optarg, &opt.count, 10) < 0 || !opt.count)
+				goto bad;
+			break;
+		case 'P':
+			if (ni_parse_uint(optarg, &pid, 10) < 0)
+				goto bad;
+			opt.pid = pid;
+			break;
+		case 't':
+			if (ni_parse_uint(optarg, &opt.timeout, 10) < 0)
+				goto bad;
+			break;
+		case 'w':
+			if (ni_parse_uint(optarg, &opt.window, 10) < 0)
+				goto bad;
+			break;
+		case 'd':
+			if (ni_enable_debug(optarg) < 0)
+				goto bad;
+			break;
+		default:
+		bad:
+			usage();
+			return 1;
+		}
+	}
+	if (!opt.prefix || optind != argc) {
+		usage();
+		return 1;
+	}
+	ni_log_destination("dhcp-bench", "stderr");
+
+	if (ni_string_eq(mode, "responder"))
+		return bench_responder();
+	if (ni_string_eq(mode, "run"))
+		return bench_run();
+
+	usage();
+	return 1;
+}
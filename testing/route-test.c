@@ -0,0 +1,159 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/rtnetlink.h>
+
+#include <wicked/util.h>
+#include <wicked/address.h>
+#include <wicked/route.h>
+
+/*
+ * Route table micro benchmark: cpu time to load a large number
+ * of routes (1000000 by default) into a route table the way the
+ * rtnetlink refresh is doing it, to find and to delete them.
+ */
+static double
+elapsed(const struct timespec *beg)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	return (end.tv_sec - beg->tv_sec) * 1000.0 +
+		(end.tv_nsec - beg->tv_nsec) / 1000000.0;
+}
+
+static ni_route_t *
+route_new(unsigned int index)
+{
+	struct in_addr addr;
+	ni_route_t *rp;
+
+	if (!(rp = ni_route_new()))
+		return NULL;
+
+	rp->family = AF_INET;
+	rp->type = RTN_UNICAST;
+	rp->table = RT_TABLE_MAIN;
+	rp->scope = RT_SCOPE_UNIVERSE;
+	rp->protocol = RTPROT_BOOT;
+	rp->prefixlen = 24;
+
+	/* 1.0.0.0/24, 1.0.1.0/24, ... */
+	addr.s_addr = htonl((1U << 24) + (index << 8));
+	ni_sockaddr_set_ipv4(&rp->destination, addr, 0);
+
+	addr.s_addr = htonl(0xc0a80001);	/* 192.168.0.1 */
+	ni_sockaddr_set_ipv4(&rp->nh.gateway, addr, 0);
+	rp->nh.device.index = 1;
+	return rp;
+}
+
+/*
+ * Routes deleted from the table array directly (as e.g. the addrconf
+ * lease handling does) followed by an add must not leave the index
+ * referring to the freed route nor missing the added one.
+ */
+static int
+check_array_modification(unsigned int count)
+{
+	ni_route_table_t *tables = NULL;
+	ni_route_t *rp, *added;
+	int failed = 0;
+	unsigned int i;
+
+	for (i = 0; i < count; ++i) {
+		if (!(rp = route_new(i)) || !ni_route_tables_add_route(&tables, rp))
+			return 1;
+	}
+	/* build the index */
+	if (!(rp = route_new(0)) || !ni_route_tables_find_match(tables, rp, ni_route_equal))
+		failed++;
+	ni_route_free(rp);
+
+	if (!ni_route_array_delete(&tables->routes, 0))
+		failed++;
+	if (!(added = route_new(count)) || !ni_route_tables_add_route(&tables, added))
+		return 1;
+
+	if (!(rp = route_new(0)) || ni_route_tables_find_match(tables, rp, ni_route_equal))
+		failed++;
+	ni_route_free(rp);
+	if (!(rp = route_new(count)) || ni_route_tables_find_match(tables, rp, ni_route_equal) != added)
+		failed++;
+	ni_route_free(rp);
+
+	ni_route_tables_destroy(&tables);
+	printf("array  modification check: %s\n", failed ? "failed" : "ok");
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i, count = 1000000, found = 0, missed = 0, deleted = 0;
+	ni_route_table_t *tables = NULL;
+	ni_route_t **routes, *rp;
+	struct timespec beg;
+
+	if (argc > 1 && (ni_parse_uint(argv[1], &count, 10) < 0 ||
+			count > (1U << 22))) {
+		fprintf(stderr, "Usage: %s [count]\n", argv[0]);
+		return 1;
+	}
+
+	routes = calloc(count, sizeof(routes[0]));
+	if (!count || !routes)
+		return 1;
+
+	for (i = 0; i < count; ++i) {
+		if (!(routes[i] = route_new(i)))
+			return 1;
+	}
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &beg);
+	for (i = 0; i < count; ++i) {
+		if (ni_route_tables_find_match(tables, routes[i], ni_route_equal))
+			continue;
+		if (!ni_route_tables_add_route(&tables, ni_route_ref(routes[i])))
+			return 1;
+	}
+	printf("load   %u routes: %10.3f msec\n", count, elapsed(&beg));
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &beg);
+	for (i = 0; i < count; ++i) {
+		if (ni_route_tables_find_match(tables, routes[i], ni_route_equal))
+			found++;
+	}
+	printf("lookup %u routes: %10.3f msec (%u found)\n", count, elapsed(&beg), found);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &beg);
+	for (i = 0; i < count; ++i) {
+		if (!(rp = route_new(count + i)))
+			return 1;
+		if (!ni_route_tables_find_match(tables, rp, ni_route_equal_destination))
+			missed++;
+		ni_route_free(rp);
+	}
+	printf("miss   %u routes: %10.3f msec (%u missed)\n", count, elapsed(&beg), missed);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &beg);
+	for (i = count; i-- > 0; ) {
+		if (ni_route_tables_del_route(tables, routes[i]))
+			deleted++;
+	}
+	printf("delete %u routes: %10.3f msec (%u deleted)\n", count, elapsed(&beg), deleted);
+
+	ni_route_tables_destroy(&tables);
+	for (i = 0; i < count; ++i)
+		ni_route_free(routes[i]);
+	free(routes);
+
+	if (check_array_modification(count < 64 ? 64 : count))
+		return 1;
+
+	return found == count && missed == count && deleted == count ? 0 : 1;
+}
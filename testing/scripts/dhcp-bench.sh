@@ -0,0 +1,144 @@
+#!/bin/bash
+#
+# Run the dhcp-bench supplicant load benchmark:
+#
+#  - creates count veth pairs between a client and a server network
+#    namespace, wbc<N> for the supplicant and wbs<N> for the responder,
+#  - starts a private dbus system bus, wickedd-dhcp4 or wickedd-dhcp6
+#    in the client and the dhcp-bench responder in the server namespace,
+#  - runs the acquire, renew and release phases through the dbus api.
+#
+# Needs root; does not touch the host network configuration.
+#
+
+family=4
+count=100
+window=0
+timeout=60
+bindir=
+configdir=/etc/wicked
+debug=
+
+usage()
+{
+	cat <<-EOT >&2
+	Usage: ${0##*/} [-4|-6] [-n count] [-w window] [-t timeout] [-b bindir] [-c configdir] [-d debug]
+
+	  -4|-6         benchmark wickedd-dhcp4 (default) or wickedd-dhcp6
+	  -n count      number of interfaces (default: $count)
+	  -w window     max. requests in flight, 0 for all (default: $window)
+	  -t timeout    timeout per phase in seconds (default: $timeout)
+	  -b bindir     directory containing wickedd-dhcp4/6 (default: build tree)
+	  -c configdir  wicked config directory (default: $configdir)
+	  -d debug      supplicant debug facilities
+	EOT
+	exit 1
+}
+
+while getopts "46n:w:t:b:c:d:h" opt ; do
+	case $opt in
+	4|6)	family=$opt ;;
+	n)	count=$OPTARG ;;
+	w)	window=$OPTARG ;;
+	t)	timeout=$OPTARG ;;
+	b)	bindir=$OPTARG ;;
+	c)	configdir=$OPTARG ;;
+	d)	debug=$OPTARG ;;
+	*)	usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+test $# -eq 0 || usage
+
+testdir=$(cd "${0%/*}/.." && pwd)
+test -n "$bindir" || bindir="$testdir/.."
+bench="$testdir/dhcp-bench"
+daemon="$bindir/wickedd-dhcp$family"
+for prog in "$bench" "$daemon" ; do
+	test -x "$prog" || { echo "$prog: not found" >&2 ; exit 1 ; }
+done
+
+cns=wb-client
+sns=wb-server
+tmpdir=$(mktemp -d /tmp/dhcp-bench.XXXXXX) || exit 1
+pids=()
+
+cleanup()
+{
+	for pid in "${pids[@]}" ; do
+		kill "$pid" 2>/dev/null
+	done
+	wait 2>/dev/null
+	ip netns del $cns 2>/dev/null
+	ip netns del $sns 2>/dev/null
+	rm -rf "$tmpdir"
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+ip netns add $cns || exit 1
+ip netns add $sns || exit 1
+for ns in $cns $sns ; do
+	ip -n $ns link set lo up
+	ip netns exec $ns sysctl -qw net.ipv6.conf.default.accept_dad=0
+	ip netns exec $ns sysctl -qw net.ipv6.conf.all.accept_dad=0
+done
+
+echo "Creating $count veth pairs"
+for ((i = 0; i < count; i++)) ; do
+	ip link add wbc$i netns $cns type veth peer name wbs$i netns $sns || exit 1
+	ip -n $sns addr add 10.$((i >> 8)).$((i & 255)).1/24 dev wbs$i
+	ip -n $sns link set wbs$i up
+	ip -n $cns link set wbc$i up
+done
+
+# private system bus, reachable from both namespaces via a path socket
+cat > "$tmpdir/bus.conf" <<-EOT
+	<!DOCTYPE busconfig PUBLIC "-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN"
+	 "http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd">
+	<busconfig>
+	  <type>system</type>
+	  <listen>unix:path=$tmpdir/bus</listen>
+	  <auth>EXTERNAL</auth>
+	  <policy context="default">
+	    <allow user="*"/>
+	    <allow own="*"/>
+	    <allow send_type="method_call"/>
+	    <allow send_type="method_return"/>
+	    <allow send_type="error"/>
+	    <allow send_type="signal"/>
+	    <allow receive_type="method_call"/>
+	    <allow receive_type="method_return"/>
+	    <allow receive_type="error"/>
+	    <allow receive_type="signal"/>
+	  </policy>
+	</busconfig>
+EOT
+dbus-daemon --config-file="$tmpdir/bus.conf" --nofork --nopidfile &
+pids+=($!)
+export DBUS_SYSTEM_BUS_ADDRESS="unix:path=$tmpdir/bus"
+for ((i = 0; i < 50; i++)) ; do
+	test -S "$tmpdir/bus" && break
+	sleep 0.1
+done
+
+mkdir -p "$tmpdir/run" "$tmpdir/state" "$tmpdir/store"
+cat > "$tmpdir/config.xml" <<-EOT
+	<config>
+	  <include name="$configdir/server.xml"/>
+	  <piddir path="$tmpdir/run" mode="0755"/>
+	  <statedir path="$tmpdir/state" mode="0755"/>
+	  <storedir path="$tmpdir/store" mode="0755"/>
+	</config>
+EOT
+
+ip netns exec $sns "$bench" responder -$family -p wbs -n $count &
+pids+=($!)
+
+ip netns exec $cns "$daemon" --foreground --config "$tmpdir/config.xml" \
+	${debug:+--debug "$debug"} --log-target stderr &
+daemon_pid=$!
+pids+=($daemon_pid)
+
+ip netns exec $cns "$bench" run -$family -p wbc -n $count \
+	-P $daemon_pid -t $timeout -w $window
@@ -0,0 +1,109 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include <wicked/util.h>
+#include <wicked/socket.h>
+
+/*
+ * Timer micro benchmark: cpu time to arm, rearm, cancel and
+ * expire a large number of timers (100000 by default).
+ */
+struct timer_data {
+	unsigned int		index;
+	unsigned int		slot;
+};
+
+static unsigned int	expired;
+static unsigned int	unordered;
+static const struct timer_data *last;
+
+static double
+elapsed(const struct timespec *beg)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	return (end.tv_sec - beg->tv_sec) * 1000.0 +
+		(end.tv_nsec - beg->tv_nsec) / 1000000.0;
+}
+
+/*
+ * Timers are expiring ordered by their slot, within the
+ * same slot in the order they've been armed (index).
+ */
+static void
+timeout_cb(void *user_data, const ni_timer_t *timer)
+{
+	const struct timer_data *data = user_data;
+
+	if (last && (data->slot < last->slot ||
+		    (data->slot == last->slot && data->index < last->index)))
+		unordered++;
+	last = data;
+	expired++;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i, count = 100000, cancelled = 0;
+	const ni_timer_t **timers;
+	struct timer_data *data;
+	struct timespec beg;
+	unsigned long tmo;
+	long timeout;
+
+	if (argc > 1 && ni_parse_uint(argv[1], &count, 10) < 0) {
+		fprintf(stderr, "Usage: %s [count]\n", argv[0]);
+		return 1;
+	}
+
+	timers = calloc(count, sizeof(timers[0]));
+	data = calloc(count, sizeof(data[0]));
+	if (!count || !timers || !data)
+		return 1;
+
+	srandom(count);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &beg);
+	for (i = 0; i < count; ++i) {
+		tmo = 3600000 + random() % 3600000;
+		data[i].index = i;
+		timers[i] = ni_timer_register(tmo, timeout_cb, &data[i]);
+	}
+	printf("register %u timers: %10.3f msec\n", count, elapsed(&beg));
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &beg);
+	for (i = 0; i < count; ++i) {
+		tmo = 3600000 + random() % 3600000;
+		timers[i] = ni_timer_rearm(timers[i], tmo);
+	}
+	printf("rearm    %u timers: %10.3f msec\n", count, elapsed(&beg));
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &beg);
+	for (i = 0; i < count; i += 2) {
+		ni_timer_cancel(timers[i]);
+		cancelled++;
+	}
+	printf("cancel   %u timers: %10.3f msec\n", cancelled, elapsed(&beg));
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &beg);
+	for (i = 1; i < count; i += 2) {
+		data[i].slot = random() % 10;
+		tmo = data[i].slot * 100;
+		timers[i] = ni_timer_rearm(timers[i], tmo);
+	}
+	while ((timeout = ni_timer_next_timeout()) >= 0)
+		usleep(timeout * 1000);
+	printf("expire   %u timers: %10.3f msec (%u out of order)\n",
+			expired, elapsed(&beg), unordered);
+
+	free(data);
+	free(timers);
+	return expired == count - cancelled && !unordered ? 0 : 1;
+}
@@ -7,17 +7,86 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wicked/util.h>
 #include <wicked/xml.h>
 
+/*
+ * Reader micro benchmark: cpu time to parse the given files
+ * (e.g. the schema files) count times (100 by default) from a file
+ * mapped into memory and via stdio.
+ */
+static double
+elapsed(const struct timespec *beg)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	return (end.tv_sec - beg->tv_sec) * 1000.0 +
+		(end.tv_nsec - beg->tv_nsec) / 1000000.0;
+}
+
+static xml_document_t *
+read_stdio(const char *filename)
+{
+	xml_document_t *doc;
+	FILE *fp;
+
+	if (!(fp = fopen(filename, "r")))
+		return NULL;
+	doc = xml_document_scan(fp, filename);
+	fclose(fp);
+	return doc;
+}
+
+static int
+benchmark(unsigned int count, int nfiles, char **files)
+{
+	xml_document_t *(*readers[])(const char *) = {
+		xml_document_read, read_stdio
+	};
+	const char *names[] = { "mmap", "stdio" };
+	struct timespec beg;
+	xml_document_t *doc;
+	unsigned int i, r;
+	int n;
+
+	for (r = 0; r < 2; ++r) {
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &beg);
+		for (i = 0; i < count; ++i) {
+			for (n = 0; n < nfiles; ++n) {
+				if (!(doc = readers[r](files[n]))) {
+					fprintf(stderr, "Error parsing %s\n", files[n]);
+					return 1;
+				}
+				xml_document_free(doc);
+			}
+		}
+		printf("%-5s %u x %d files: %10.3f msec\n", names[r],
+				count, nfiles, elapsed(&beg));
+	}
+	return 0;
+}
+
 int
 main(int argc, char **argv)
 {
 	const char *filename;
+	unsigned int count = 100;
 	xml_document_t *doc;
 
+	if (argc > 2 && !strcmp(argv[1], "-b")) {
+		if (argc > 3 && ni_parse_uint(argv[2], &count, 10) == 0)
+			return benchmark(count, argc - 3, argv + 3);
+		return benchmark(count, argc - 2, argv + 2);
+	}
+
 	if (argc != 2) {
-		fprintf(stderr, "Usage: xml-test filename\n");
+		fprintf(stderr, "Usage: xml-test filename\n"
+				"       xml-test -b [count] filename ...\n");
 		return 1;
 	}
 	filename = argv[1];
@@ -32,4 +101,3 @@ main(int argc, char **argv)
 	xml_document_free(doc);
 	return 0;
 }
-